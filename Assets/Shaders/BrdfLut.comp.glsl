@@ -0,0 +1,64 @@
+#version 450 core
+
+// Integrates the GGX specular BRDF over the hemisphere for the split-sum approximation, as a scale and a bias to F0 for
+// each view angle (X) and roughness (Y). The result does not depend on the environment, so it is only built once.
+
+layout(local_size_x = 8, local_size_y = 8) in;
+
+layout(set = 0, binding = 0, rg16f) uniform writeonly image2D brdfLut;
+
+layout(push_constant) uniform PushConstant {
+	uint Size;
+	uint SampleCount;
+} PC;
+
+const float Pi = 3.141592;
+
+vec2 Hammersley(uint i, uint count) {
+	return vec2(float(i) / float(count), float(bitfieldReverse(i)) * 2.3283064365386963e-10);
+}
+
+// Returns a half vector around +Z, distributed like the GGX normal distribution.
+vec3 ImportanceSampleGGX(vec2 xi, float alpha) {
+	const float phi      = 2.0 * Pi * xi.x;
+	const float cosTheta = sqrt((1.0 - xi.y) / (1.0 + (alpha * alpha - 1.0) * xi.y));
+	const float sinTheta = sqrt(1.0 - cosTheta * cosTheta);
+
+	return vec3(cos(phi) * sinTheta, sin(phi) * sinTheta, cosTheta);
+}
+
+float GaSchlickG1(float cosTheta, float k) {
+	return cosTheta / (cosTheta * (1.0 - k) + k);
+}
+
+void main() {
+	const uvec2 texel = gl_GlobalInvocationID.xy;
+	if (texel.x >= PC.Size || texel.y >= PC.Size) { return; }
+
+	const float NdotV     = (float(texel.x) + 0.5) / float(PC.Size);
+	const float roughness = (float(texel.y) + 0.5) / float(PC.Size);
+	const float alpha     = roughness * roughness;
+	// Image-based lighting uses a different remapping of roughness for the geometry term than direct lights do.
+	const float k = alpha / 2.0;
+
+	const vec3 V = vec3(sqrt(1.0 - NdotV * NdotV), 0.0, NdotV);
+	float scale  = 0.0;
+	float bias   = 0.0;
+	for (uint i = 0; i < PC.SampleCount; ++i) {
+		const vec3 H      = ImportanceSampleGGX(Hammersley(i, PC.SampleCount), alpha);
+		const vec3 L      = 2.0 * dot(V, H) * H - V;
+		const float NdotL = L.z;
+		if (NdotL <= 0.0) { continue; }
+
+		const float NdotH = max(H.z, 0.0);
+		const float VdotH = max(dot(V, H), 0.0);
+		const float G     = GaSchlickG1(NdotL, k) * GaSchlickG1(NdotV, k);
+		const float Gvis  = G * VdotH / max(NdotH * NdotV, 0.0001);
+		const float Fc    = pow(1.0 - VdotH, 5.0);
+
+		scale += (1.0 - Fc) * Gvis;
+		bias += Fc * Gvis;
+	}
+
+	imageStore(brdfLut, ivec2(texel), vec4(scale, bias, 0.0, 0.0) / float(PC.SampleCount));
+}
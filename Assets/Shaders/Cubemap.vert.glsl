@@ -1,53 +0,0 @@
-#version 450 core
-
-const vec3 CubePositions[36] = vec3[36](
-	vec3(-1.0f, -1.0f, -1.0f),
-	vec3( 1.0f,  1.0f, -1.0f),
-	vec3( 1.0f, -1.0f, -1.0f),
-	vec3( 1.0f,  1.0f, -1.0f),
-	vec3(-1.0f, -1.0f, -1.0f),
-	vec3(-1.0f,  1.0f, -1.0f),
-	vec3(-1.0f, -1.0f,  1.0f),
-	vec3( 1.0f, -1.0f,  1.0f),
-	vec3( 1.0f,  1.0f,  1.0f),
-	vec3( 1.0f,  1.0f,  1.0f),
-	vec3(-1.0f,  1.0f,  1.0f),
-	vec3(-1.0f, -1.0f,  1.0f),
-	vec3(-1.0f,  1.0f,  1.0f),
-	vec3(-1.0f,  1.0f, -1.0f),
-	vec3(-1.0f, -1.0f, -1.0f),
-	vec3(-1.0f, -1.0f, -1.0f),
-	vec3(-1.0f, -1.0f,  1.0f),
-	vec3(-1.0f,  1.0f,  1.0f),
-	vec3( 1.0f,  1.0f,  1.0f),
-	vec3( 1.0f, -1.0f, -1.0f),
-	vec3( 1.0f,  1.0f, -1.0f),
-	vec3( 1.0f, -1.0f, -1.0f),
-	vec3( 1.0f,  1.0f,  1.0f),
-	vec3( 1.0f, -1.0f,  1.0f),
-	vec3(-1.0f, -1.0f, -1.0f),
-	vec3( 1.0f, -1.0f, -1.0f),
-	vec3( 1.0f, -1.0f,  1.0f),
-	vec3( 1.0f, -1.0f,  1.0f),
-	vec3(-1.0f, -1.0f,  1.0f),
-	vec3(-1.0f, -1.0f, -1.0f),
-	vec3(-1.0f,  1.0f, -1.0f),
-	vec3( 1.0f,  1.0f , 1.0f),
-	vec3( 1.0f,  1.0f, -1.0f),
-	vec3( 1.0f,  1.0f,  1.0f),
-	vec3(-1.0f,  1.0f, -1.0f),
-	vec3(-1.0f,  1.0f,  1.0f)
-);
-
-layout(push_constant) uniform PushConstant {
-	mat4 ViewProj;
-} PC;
-
-layout(location = 0) out vec3 outLocalPos;
-
-void main() {
-	const int face = int(gl_VertexIndex) / int(36);
-	const vec3 position = CubePositions[gl_VertexIndex % 36];
-	outLocalPos = position;
-	gl_Position = PC.ViewProj * vec4(position, 1.0);
-}
@@ -26,15 +26,22 @@ layout(set = 0, binding = 0) uniform SceneData {
 	bool ShowCascades;
 } Scene;
 
+layout(set = 0, binding = 2, std430) readonly buffer InstanceData {
+	mat4 Models[];
+} Instances;
+
 layout(push_constant) uniform PushConstant {
-	mat4 Model;
+	vec4 PositionOffset;
+	vec4 PositionScale;
 } PC;
 
 layout(location = 0) out vec2 outUV0;
 
 void main() {
+	mat4 model = Instances.Models[gl_InstanceIndex];
+	vec3 position = PC.PositionOffset.xyz + inPosition * PC.PositionScale.xyz;
 	vec4 locPos;
-	locPos = PC.Model * vec4(inPosition, 1.0);
+	locPos = model * vec4(position, 1.0);
 	vec3 worldPos = locPos.xyz / locPos.w;
 
 	outUV0 = inUV0;
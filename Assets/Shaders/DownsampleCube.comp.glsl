@@ -0,0 +1,55 @@
+#version 450 core
+
+// Averages a cubemap mip level down into the next five levels. Every face is written by the same dispatch, with the
+// face taken from the Z dimension. Each workgroup reads a 32x32 tile of the source level, two by two texels per
+// invocation, and halves it through shared memory level by level, the way EquirectToCube.comp.glsl fills the first
+// levels.
+
+layout(local_size_x = 16, local_size_y = 16) in;
+
+layout(set = 0, binding = 0, rgba16f) uniform readonly image2DArray source;
+layout(set = 0, binding = 1, rgba16f) uniform writeonly image2DArray mip0;
+layout(set = 0, binding = 2, rgba16f) uniform writeonly image2DArray mip1;
+layout(set = 0, binding = 3, rgba16f) uniform writeonly image2DArray mip2;
+layout(set = 0, binding = 4, rgba16f) uniform writeonly image2DArray mip3;
+layout(set = 0, binding = 5, rgba16f) uniform writeonly image2DArray mip4;
+
+shared vec3 tile[16][16];
+
+// Averages the 2x2 block of the tile that a texel of the next smaller level covers, then stores that level in the tile.
+// Every invocation takes part in the barriers, but only the first size x size of them have a texel.
+vec3 Reduce(uvec2 local, uint size) {
+	barrier();
+	vec3 color = vec3(0.0);
+	if (local.x < size && local.y < size) {
+		const uvec2 src = local * 2;
+		color = (tile[src.y][src.x] + tile[src.y][src.x + 1] + tile[src.y + 1][src.x] + tile[src.y + 1][src.x + 1]) * 0.25;
+	}
+	barrier();
+	if (local.x < size && local.y < size) { tile[local.y][local.x] = color; }
+
+	return color;
+}
+
+void main() {
+	const uvec2 local = gl_LocalInvocationID.xy;
+	const uvec2 group = gl_WorkGroupID.xy;
+	const uint face   = gl_WorkGroupID.z;
+
+	vec3 sum = vec3(0.0);
+	for (uint i = 0; i < 4; ++i) {
+		const uvec2 texel = gl_GlobalInvocationID.xy * 2 + uvec2(i & 1, i >> 1);
+		sum += imageLoad(source, ivec3(texel, face)).rgb;
+	}
+	tile[local.y][local.x] = sum * 0.25;
+	imageStore(mip0, ivec3(gl_GlobalInvocationID.xy, face), vec4(sum * 0.25, 1.0));
+
+	vec3 color = Reduce(local, 8);
+	if (all(lessThan(local, uvec2(8)))) { imageStore(mip1, ivec3(group * 8 + local, face), vec4(color, 1.0)); }
+	color = Reduce(local, 4);
+	if (all(lessThan(local, uvec2(4)))) { imageStore(mip2, ivec3(group * 4 + local, face), vec4(color, 1.0)); }
+	color = Reduce(local, 2);
+	if (all(lessThan(local, uvec2(2)))) { imageStore(mip3, ivec3(group * 2 + local, face), vec4(color, 1.0)); }
+	color = Reduce(local, 1);
+	if (all(lessThan(local, uvec2(1)))) { imageStore(mip4, ivec3(group + local, face), vec4(color, 1.0)); }
+}
@@ -0,0 +1,108 @@
+#version 450 core
+
+// Culls the meshlets of each job against the camera frustum and their normal cone, and appends the indices of the
+// survivors to the job's range of the output index buffer. The job's indirect draw counts the indices written. The
+// camera is given by the renderer rather than read from the scene data, so that a frozen debug frustum applies here
+// the same as it does to the culling done on the CPU.
+
+layout(local_size_x = 64) in;
+
+struct Meshlet {
+	vec3 Center;
+	float Radius;
+	vec3 ConeAxis;
+	float ConeCutoff;
+	uint FirstIndex;
+	uint IndexCount;
+	uvec2 Padding;
+};
+
+struct CullJob {
+	uint FirstMeshlet;
+	uint MeshletCount;
+	uint Instance;
+	uint Draw;
+	uint OutputOffset;
+	uint ConeCull;
+	uvec2 Padding;
+};
+
+struct DrawIndexedIndirectCommand {
+	uint IndexCount;
+	uint InstanceCount;
+	uint FirstIndex;
+	int VertexOffset;
+	uint FirstInstance;
+};
+
+layout(set = 0, binding = 2, std430) readonly buffer InstanceData {
+	mat4 Models[];
+} Instances;
+
+layout(set = 0, binding = 3, std430) readonly buffer CullJobs {
+	CullJob Jobs[];
+};
+
+layout(set = 0, binding = 4, std430) readonly buffer MeshletData {
+	Meshlet Meshlets[];
+};
+
+layout(set = 0, binding = 5, std430) readonly buffer SourceIndices {
+	uint Indices[];
+} Source;
+
+layout(set = 0, binding = 6, std430) writeonly buffer CulledIndices {
+	uint Indices[];
+} Culled;
+
+layout(set = 0, binding = 7, std430) buffer CulledDraws {
+	DrawIndexedIndirectCommand Draws[];
+};
+
+layout(push_constant) uniform PushConstant {
+	mat4 ViewProjection;
+	vec4 CameraPosition;
+	uint FirstJob;
+	uint ShortIndices;
+} PC;
+
+uint ReadIndex(uint i) {
+	if (PC.ShortIndices != 0) { return (Source.Indices[i >> 1] >> ((i & 1) * 16)) & 0xffff; }
+
+	return Source.Indices[i];
+}
+
+bool SphereVisible(vec3 center, float radius) {
+	// Planes are taken from the rows of the view-projection matrix. The near plane assumes a -w..w depth range, which
+	// lies behind the near plane of a 0..w range and is therefore still conservative.
+	mat4 m = transpose(PC.ViewProjection);
+	vec4 planes[6] = vec4[6](m[3] + m[0], m[3] - m[0], m[3] + m[1], m[3] - m[1], m[3] + m[2], m[3] - m[2]);
+	for (int i = 0; i < 6; ++i) {
+		if (dot(planes[i].xyz, center) + planes[i].w < -radius * length(planes[i].xyz)) { return false; }
+	}
+
+	return true;
+}
+
+void main() {
+	CullJob job = Jobs[PC.FirstJob + gl_WorkGroupID.x];
+	mat4 model = Instances.Models[job.Instance];
+	float scale = max(length(model[0].xyz), max(length(model[1].xyz), length(model[2].xyz)));
+
+	for (uint m = gl_LocalInvocationID.x; m < job.MeshletCount; m += gl_WorkGroupSize.x) {
+		Meshlet meshlet = Meshlets[job.FirstMeshlet + m];
+		vec3 center = (model * vec4(meshlet.Center, 1.0)).xyz;
+		float radius = meshlet.Radius * scale;
+		if (!SphereVisible(center, radius)) { continue; }
+
+		// The whole cluster faces away from the camera if the camera lies inside the cone's negative space.
+		if (job.ConeCull != 0 && meshlet.ConeCutoff < 1.0) {
+			vec3 axis = normalize(mat3(model) * meshlet.ConeAxis);
+			vec3 view = center - PC.CameraPosition.xyz;
+			if (dot(view, axis) >= meshlet.ConeCutoff * length(view) + radius) { continue; }
+		}
+
+		uint offset = job.OutputOffset + atomicAdd(Draws[job.Draw].IndexCount, meshlet.IndexCount);
+		for (uint i = 0; i < meshlet.IndexCount; ++i) { Culled.Indices[offset + i] = ReadIndex(meshlet.FirstIndex + i); }
+	}
+}
@@ -58,6 +58,7 @@ layout(set = 0, binding = 0) uniform SceneData {
 	bool CastShadows;
 	bool SoftShadows;
 	bool ShowCascades;
+	vec4 IrradianceSH[9];
 } Scene;
 layout(set = 0, binding = 1) uniform sampler2DArray TexShadowMap;
 
@@ -78,6 +79,10 @@ layout(set = 1, binding = 2) uniform sampler2D TexNormal;
 layout(set = 1, binding = 3) uniform sampler2D TexPBR;
 layout(set = 1, binding = 4) uniform sampler2D TexEmissive;
 
+// The environment prefiltered for increasing roughness in each mip level, and the split-sum BRDF scale and bias.
+layout(set = 2, binding = 0) uniform samplerCube TexSpecular;
+layout(set = 2, binding = 1) uniform sampler2D TexBrdfLut;
+
 layout(location = 0) out vec4 outColor;
 
 struct PBRInfo {
@@ -90,7 +95,7 @@ struct PBRInfo {
 } PBR;
 
 vec3 FresnelSchlickRoughness(vec3 F0, float cosTheta, float roughness) {
-	return F0 + (max(vec3(1.0 - roughness), F0), - F0) * pow(1.0 - cosTheta, 5.0);
+	return F0 + (max(vec3(1.0 - roughness), F0) - F0) * pow(1.0 - cosTheta, 5.0);
 }
 
 float GaSchlickG1(float cosTheta, float k) {
@@ -136,6 +141,35 @@ vec3 DirectionalLights(vec3 F0) {
 	return result;
 }
 
+// Diffuse lighting from the environment, from the spherical harmonics of its irradiance. Their constants are folded
+// into the coefficients, so only the polynomials of the normal are left.
+vec3 DiffuseIBL(vec3 F0) {
+	vec3 n = PBR.Normal;
+	vec3 irradiance = Scene.IrradianceSH[0].rgb;
+	irradiance += Scene.IrradianceSH[1].rgb * n.y;
+	irradiance += Scene.IrradianceSH[2].rgb * n.z;
+	irradiance += Scene.IrradianceSH[3].rgb * n.x;
+	irradiance += Scene.IrradianceSH[4].rgb * (n.x * n.y);
+	irradiance += Scene.IrradianceSH[5].rgb * (n.y * n.z);
+	irradiance += Scene.IrradianceSH[6].rgb * (3.0 * n.z * n.z - 1.0);
+	irradiance += Scene.IrradianceSH[7].rgb * (n.x * n.z);
+	irradiance += Scene.IrradianceSH[8].rgb * (n.x * n.x - n.y * n.y);
+
+	vec3 F = FresnelSchlickRoughness(F0, PBR.NdotV, PBR.Roughness);
+	vec3 kD = (1.0 - F) * (1.0 - PBR.Metallic);
+	return kD * PBR.Albedo * max(irradiance, vec3(0.0));
+}
+
+// Specular lighting from the environment, using the split-sum approximation: the prefiltered environment in the
+// reflected direction, scaled by the integrated BRDF for this view angle and roughness.
+vec3 SpecularIBL(vec3 F0, vec3 Lr) {
+	float lod = PBR.Roughness * float(textureQueryLevels(TexSpecular) - 1);
+	vec3 prefiltered = textureLod(TexSpecular, Lr, lod).rgb;
+	vec2 brdf = texture(TexBrdfLut, vec2(PBR.NdotV, PBR.Roughness)).rg;
+
+	return prefiltered * (F0 * brdf.x + brdf.y);
+}
+
 float GetShadowBias() {
 	const float MinimumShadowBias = 0.002f;
 	float bias = max(MinimumShadowBias * (1.0 - dot(PBR.Normal, Scene.Light.Direction)), MinimumShadowBias);
@@ -213,7 +247,9 @@ void main() {
 
 	PBR.Normal = normalize(In.Normal);
 	if (Material.HasNormal) {
-		PBR.Normal = normalize(texture(TexNormal, In.UV0).rgb * 2.0f - 1.0f);
+		// Only the XY components are read, so that two-channel (BC5) normal maps work as well.
+		vec2 normalXY = texture(TexNormal, In.UV0).rg * 2.0f - 1.0f;
+		PBR.Normal = normalize(vec3(normalXY, sqrt(max(1.0f - dot(normalXY, normalXY), 0.0f))));
 		PBR.Normal = normalize(In.NormalMat * PBR.Normal);
 	}
 
@@ -242,8 +278,9 @@ void main() {
 	shadowScale = 1.0 - clamp(Scene.Light.ShadowAmount - shadowScale, 0.0f, 1.0f);
 
 	vec3 lightContrib = DirectionalLights(F0) * shadowScale;
+	vec3 iblContrib = DiffuseIBL(F0) + SpecularIBL(F0, Lr);
 
-	outColor = vec4(lightContrib, 1.0f);
+	outColor = vec4(lightContrib + iblContrib, 1.0f);
 
 	if (Scene.ShowCascades) {
 		switch(cascadeIndex) {
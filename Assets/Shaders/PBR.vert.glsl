@@ -17,9 +17,14 @@ struct DirectionalLight {
 
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec2 inUV0;
+#ifdef COMPACT_VERTEX
+layout(location = 2) in vec2 inNormalOct;
+layout(location = 3) in vec2 inTangentOct;
+#else
 layout(location = 2) in vec3 inNormal;
 layout(location = 3) in vec3 inTangent;
 layout(location = 4) in vec3 inBitangent;
+#endif
 
 layout(set = 0, binding = 0) uniform SceneData {
 	mat4 ViewProjection;
@@ -35,8 +40,13 @@ layout(set = 0, binding = 0) uniform SceneData {
 	bool ShowCascades;
 } Scene;
 
+layout(set = 0, binding = 2, std430) readonly buffer InstanceData {
+	mat4 Models[];
+} Instances;
+
 layout(push_constant) uniform PushConstant {
-	mat4 Model;
+	vec4 PositionOffset;
+	vec4 PositionScale;
 } PC;
 
 struct VertexOut {
@@ -50,16 +60,36 @@ struct VertexOut {
 
 layout(location = 0) out VertexOut Out;
 
+#ifdef COMPACT_VERTEX
+vec3 OctahedralDecode(vec2 e) {
+	vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-v.z, 0.0);
+	v.x += v.x >= 0.0 ? -t : t;
+	v.y += v.y >= 0.0 ? -t : t;
+	return normalize(v);
+}
+#endif
+
 void main() {
+#ifdef COMPACT_VERTEX
+	// The bitangent sign is stored in the sign of the tangent's second component.
+	vec3 inNormal = OctahedralDecode(inNormalOct);
+	float bitangentSign = inTangentOct.y < 0.0 ? -1.0 : 1.0;
+	vec3 inTangent = OctahedralDecode(vec2(inTangentOct.x, abs(inTangentOct.y) * 2.0 - 1.0));
+	vec3 inBitangent = bitangentSign * cross(inNormal, inTangent);
+#endif
+
+	mat4 model = Instances.Models[gl_InstanceIndex];
+	vec3 position = PC.PositionOffset.xyz + inPosition * PC.PositionScale.xyz;
 	vec4 locPos;
-	locPos = PC.Model * vec4(inPosition, 1.0);
+	locPos = model * vec4(position, 1.0);
 	Out.WorldPos = locPos.xyz / locPos.w;
 
-	Out.Normal = normalize(transpose(inverse(mat3(PC.Model))) * inNormal);
+	Out.Normal = normalize(transpose(inverse(mat3(model))) * inNormal);
 	Out.ViewPos = (Scene.View * locPos).xyz;
 	Out.UV0 = inUV0;
 
-	Out.NormalMat = mat3(PC.Model) * mat3(inTangent, inBitangent, inNormal);
+	Out.NormalMat = mat3(model) * mat3(inTangent, inBitangent, inNormal);
 
 	if (Scene.CastShadows) {
 		Out.ShadowCoords[0] = (BiasMat * Scene.LightMatrices[0]) * vec4(Out.WorldPos, 1.0f);
@@ -0,0 +1,98 @@
+#version 450 core
+
+// Prefilters one mip level of the specular environment cubemap for the GGX lobe of one roughness, by importance
+// sampling the environment. Each sample is read from the environment mip level whose texels cover about as much of the
+// sphere as the sample does, so that a few hundred samples are enough without aliasing.
+
+layout(local_size_x = 8, local_size_y = 8) in;
+
+layout(set = 0, binding = 0) uniform samplerCube envMap;
+layout(set = 0, binding = 1, rgba16f) uniform writeonly image2DArray specularMap;
+
+layout(push_constant) uniform PushConstant {
+	uint Size;
+	uint SampleCount;
+	float Roughness;
+	float EnvSize;
+} PC;
+
+const float Pi = 3.141592;
+
+// Returns the direction through a point of a cube face, with coordinates from -1 to 1, following the face layout
+// Vulkan uses when sampling cubemaps.
+vec3 GetCubeDirection(uint face, vec2 st) {
+	switch (face) {
+		case 0:
+			return vec3(1.0, -st.y, -st.x);
+		case 1:
+			return vec3(-1.0, -st.y, st.x);
+		case 2:
+			return vec3(st.x, 1.0, st.y);
+		case 3:
+			return vec3(st.x, -1.0, -st.y);
+		case 4:
+			return vec3(st.x, -st.y, 1.0);
+		default:
+			return vec3(-st.x, -st.y, -1.0);
+	}
+}
+
+vec2 Hammersley(uint i, uint count) {
+	return vec2(float(i) / float(count), float(bitfieldReverse(i)) * 2.3283064365386963e-10);
+}
+
+vec3 ImportanceSampleGGX(vec2 xi, vec3 N, float alpha) {
+	const float phi      = 2.0 * Pi * xi.x;
+	const float cosTheta = sqrt((1.0 - xi.y) / (1.0 + (alpha * alpha - 1.0) * xi.y));
+	const float sinTheta = sqrt(1.0 - cosTheta * cosTheta);
+
+	const vec3 up        = abs(N.z) < 0.999 ? vec3(0.0, 0.0, 1.0) : vec3(1.0, 0.0, 0.0);
+	const vec3 tangent   = normalize(cross(up, N));
+	const vec3 bitangent = cross(N, tangent);
+
+	return normalize(tangent * (cos(phi) * sinTheta) + bitangent * (sin(phi) * sinTheta) + N * cosTheta);
+}
+
+float NdfGGX(float cosLh, float alpha) {
+	float alphaSq = alpha * alpha;
+
+	float denom = (cosLh * cosLh) * (alphaSq - 1.0) + 1.0;
+	return alphaSq / (Pi * denom * denom);
+}
+
+void main() {
+	const uvec3 texel = gl_GlobalInvocationID;
+	if (texel.x >= PC.Size || texel.y >= PC.Size) { return; }
+
+	const vec2 st = (vec2(texel.xy) + 0.5) / float(PC.Size) * 2.0 - 1.0;
+	const vec3 N  = normalize(GetCubeDirection(texel.z, st));
+
+	// The mirror-like first level only needs the environment at its own resolution.
+	if (PC.SampleCount <= 1) {
+		imageStore(specularMap, ivec3(texel), vec4(textureLod(envMap, N, log2(PC.EnvSize / float(PC.Size))).rgb, 1.0));
+		return;
+	}
+
+	const float alpha           = PC.Roughness * PC.Roughness;
+	const float texelSolidAngle = 4.0 * Pi / (6.0 * PC.EnvSize * PC.EnvSize);
+	vec3 color                  = vec3(0.0);
+	float weight                = 0.0;
+	for (uint i = 0; i < PC.SampleCount; ++i) {
+		// The view direction is assumed to be the normal, so the light direction is the normal reflected about H.
+		const vec3 H      = ImportanceSampleGGX(Hammersley(i, PC.SampleCount), N, alpha);
+		const float NdotH = max(dot(N, H), 0.0);
+		const vec3 L      = 2.0 * NdotH * H - N;
+		const float NdotL = dot(N, L);
+		if (NdotL <= 0.0) { continue; }
+
+		// With V equal to N, the probability of L is D * NdotH / (4 * VdotH), which is D / 4.
+		const float pdf              = NdfGGX(NdotH, alpha) * 0.25;
+		const float sampleSolidAngle = 1.0 / (float(PC.SampleCount) * pdf + 0.0001);
+		const float lod              = max(0.5 * log2(sampleSolidAngle / texelSolidAngle) + 1.0, 0.0);
+
+		color += textureLod(envMap, L, lod).rgb * NdotL;
+		weight += NdotL;
+	}
+
+	imageStore(specularMap, ivec3(texel), vec4(color / max(weight, 0.0001), 1.0));
+}
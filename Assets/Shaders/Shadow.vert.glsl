@@ -26,8 +26,13 @@ layout(set = 0, binding = 0) uniform SceneData {
 	bool ShowCascades;
 } Scene;
 
+layout(set = 0, binding = 2, std430) readonly buffer InstanceData {
+	mat4 Models[];
+} Instances;
+
 layout(push_constant) uniform PushConstant {
-	mat4 Model;
+	vec4 PositionOffset;
+	vec4 PositionScale;
 	int ShadowCascade;
 } PC;
 
@@ -36,5 +41,7 @@ layout(location = 0) out vec2 outUV0;
 void main() {
 	outUV0 = inUV0;
 
-	gl_Position = Scene.LightMatrices[PC.ShadowCascade] * PC.Model * vec4(inPosition, 1.0);
+	mat4 model = Instances.Models[gl_InstanceIndex];
+	vec3 position = PC.PositionOffset.xyz + inPosition * PC.PositionScale.xyz;
+	gl_Position = Scene.LightMatrices[PC.ShadowCascade] * model * vec4(position, 1.0);
 }
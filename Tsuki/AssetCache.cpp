@@ -0,0 +1,107 @@
+#include "AssetCache.hpp"
+
+#include <cstdio>
+#include <fstream>
+
+namespace AssetCache {
+static constexpr uint64_t Prime1 = 0x9e3779b185ebca87ull;
+static constexpr uint64_t Prime2 = 0xc2b2ae3d27d4eb4full;
+static constexpr uint64_t Prime3 = 0x165667b19e3779f9ull;
+
+static uint64_t Rotl(uint64_t x, int r) {
+	return (x << r) | (x >> (64 - r));
+}
+
+uint64_t Hash(const void* data, size_t size, uint64_t seed) {
+	const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+	uint64_t h           = seed + Prime3 + size * Prime1;
+
+	while (size >= 8) {
+		uint64_t k;
+		memcpy(&k, bytes, 8);
+		k *= Prime2;
+		k = Rotl(k, 31);
+		k *= Prime1;
+		h ^= k;
+		h = Rotl(h, 27) * Prime1 + Prime3;
+
+		bytes += 8;
+		size -= 8;
+	}
+	while (size > 0) {
+		h ^= *bytes * Prime3;
+		h = Rotl(h, 11) * Prime1;
+
+		++bytes;
+		--size;
+	}
+
+	h ^= h >> 33;
+	h *= Prime2;
+	h ^= h >> 29;
+	h *= Prime3;
+	h ^= h >> 32;
+
+	return h;
+}
+
+uint64_t HashFile(const std::filesystem::path& path, uint64_t seed) {
+	std::ifstream file(path, std::ios::binary);
+	if (!file) { return seed; }
+
+	uint64_t h = seed;
+	std::vector<char> chunk(1 << 20);
+	while (file) {
+		file.read(chunk.data(), chunk.size());
+		const auto count = file.gcount();
+		if (count <= 0) { break; }
+		h = Hash(chunk.data(), static_cast<size_t>(count), h);
+	}
+
+	return h;
+}
+
+std::filesystem::path GetPath(const std::string& category, uint64_t key, const std::string& extension) {
+	char keyStr[17];
+	snprintf(keyStr, sizeof(keyStr), "%016llx", static_cast<unsigned long long>(key));
+
+	return std::filesystem::path("Cache") / category / (std::string(keyStr) + extension);
+}
+
+bool Read(const std::filesystem::path& path, std::vector<uint8_t>& data) {
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file) { return false; }
+
+	const auto size = file.tellg();
+	if (size <= 0) { return false; }
+	data.resize(static_cast<size_t>(size));
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(data.data()), data.size());
+
+	return bool(file);
+}
+
+bool Write(const std::filesystem::path& path, const void* data, size_t size) {
+	std::error_code ec;
+	std::filesystem::create_directories(path.parent_path(), ec);
+	if (ec) { return false; }
+
+	// Write to a temporary file first, so that an interrupted write never leaves a truncated cache entry behind.
+	auto tempPath = path;
+	tempPath += ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file) { return false; }
+		file.write(reinterpret_cast<const char*>(data), size);
+		if (!file) { return false; }
+	}
+
+	std::filesystem::rename(tempPath, path, ec);
+	if (ec) {
+		std::filesystem::remove(tempPath, ec);
+		return false;
+	}
+
+	return true;
+}
+}  // namespace AssetCache
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Helpers for storing processed ("cooked") asset data on disk, so that it can be reused between runs.
+namespace AssetCache {
+uint64_t Hash(const void* data, size_t size, uint64_t seed = 0);
+uint64_t HashFile(const std::filesystem::path& path, uint64_t seed = 0);
+
+// Returns the path of a cache entry, e.g. Cache/Meshes/0123456789abcdef.mesh
+std::filesystem::path GetPath(const std::string& category, uint64_t key, const std::string& extension);
+
+bool Read(const std::filesystem::path& path, std::vector<uint8_t>& data);
+bool Write(const std::filesystem::path& path, const void* data, size_t size);
+
+class Writer {
+ public:
+	void Write(const void* data, size_t size) {
+		const auto* bytes = reinterpret_cast<const uint8_t*>(data);
+		_data.insert(_data.end(), bytes, bytes + size);
+	}
+
+	template <typename T>
+	void Write(const T& value) {
+		static_assert(std::is_trivially_copyable_v<T>);
+		Write(&value, sizeof(T));
+	}
+
+	const std::vector<uint8_t>& GetData() const {
+		return _data;
+	}
+
+	std::vector<uint8_t> TakeData() {
+		return std::move(_data);
+	}
+
+ private:
+	std::vector<uint8_t> _data;
+};
+
+class Reader {
+ public:
+	Reader(const uint8_t* data, size_t size) : _data(data), _size(size) {}
+
+	// Returns a pointer to the next size bytes and advances past them, or nullptr if the data is too short.
+	const uint8_t* ReadBytes(size_t size) {
+		if (size > _size - _offset) { return nullptr; }
+		const uint8_t* ptr = _data + _offset;
+		_offset += size;
+
+		return ptr;
+	}
+
+	template <typename T>
+	bool Read(T& value) {
+		static_assert(std::is_trivially_copyable_v<T>);
+		const uint8_t* ptr = ReadBytes(sizeof(T));
+		if (ptr == nullptr) { return false; }
+		memcpy(&value, ptr, sizeof(T));
+
+		return true;
+	}
+
+ private:
+	const uint8_t* _data;
+	size_t _size;
+	size_t _offset = 0;
+};
+}  // namespace AssetCache
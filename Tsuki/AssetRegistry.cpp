@@ -0,0 +1,100 @@
+#include "AssetRegistry.hpp"
+
+#include <Vulkan/Image.hpp>
+
+void SharedImage::Attach(const Luna::TextureHandle& texture) {
+	if (Image) {
+		texture->Image = Image;
+	} else if (!Failed) {
+		Waiting.push_back(texture);
+	}
+}
+
+void SharedImage::WhenReady(std::function<void()> callback) {
+	if (Image || Failed) {
+		callback();
+	} else {
+		ReadyCallbacks.push_back(std::move(callback));
+	}
+}
+
+void SharedImage::SetImage(Luna::Vulkan::ImageHandle image) {
+	Image = std::move(image);
+	for (auto& texture : Waiting) { texture->Image = Image; }
+	Waiting.clear();
+	RunReadyCallbacks();
+}
+
+void SharedImage::Fail() {
+	Failed = true;
+	Waiting.clear();
+	RunReadyCallbacks();
+}
+
+void SharedImage::RunReadyCallbacks() {
+	auto callbacks = std::move(ReadyCallbacks);
+	ReadyCallbacks.clear();
+	for (auto& callback : callbacks) { callback(); }
+}
+
+std::shared_ptr<LoadedModel> AssetRegistry::FindModel(const std::filesystem::path& path, uint64_t contentHash) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	const auto it = _models.find(GetModelKey(path));
+	if (it == _models.end() || it->second.ContentHash != contentHash) { return nullptr; }
+
+	return it->second.Model.lock();
+}
+
+void AssetRegistry::AddModel(const std::filesystem::path& path,
+                             uint64_t contentHash,
+                             const std::shared_ptr<LoadedModel>& model) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	RemoveExpired();
+	_models[GetModelKey(path)] = ModelEntry{.ContentHash = contentHash, .Model = model};
+}
+
+std::pair<std::shared_ptr<SharedImage>, bool> AssetRegistry::AcquireImage(uint64_t key) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	auto& entry = _images[key];
+	if (auto image = entry.lock()) { return {std::move(image), false}; }
+
+	RemoveExpired();
+	auto image   = std::make_shared<SharedImage>();
+	image->Key   = key;
+	_images[key] = image;
+
+	return {std::move(image), true};
+}
+
+void AssetRegistry::RemoveImage(const std::shared_ptr<SharedImage>& image) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	const auto it = _images.find(image->Key);
+	if (it != _images.end() && it->second.lock() == image) { _images.erase(it); }
+}
+
+size_t AssetRegistry::GetModelCount() {
+	std::lock_guard<std::mutex> lock(_mutex);
+	RemoveExpired();
+
+	return _models.size();
+}
+
+size_t AssetRegistry::GetImageCount() {
+	std::lock_guard<std::mutex> lock(_mutex);
+	RemoveExpired();
+
+	return _images.size();
+}
+
+std::string AssetRegistry::GetModelKey(const std::filesystem::path& path) {
+	// The same file may be reached through different relative paths.
+	std::error_code error;
+	const auto canonical = std::filesystem::weakly_canonical(path, error);
+
+	return (error ? path : canonical).generic_string();
+}
+
+void AssetRegistry::RemoveExpired() {
+	std::erase_if(_models, [](const auto& entry) { return entry.second.Model.expired(); });
+	std::erase_if(_images, [](const auto& entry) { return entry.second.expired(); });
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <Assets/Material.hpp>
+#include <Assets/Mesh.hpp>
+#include <Assets/Texture.hpp>
+#include <Utility/IntrusivePtr.hpp>
+#include <Vulkan/Common.hpp>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <glm/glm.hpp>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+struct MaterialTable;
+struct MeshInfo;
+
+// One uploaded image, shared by every texture of every model that uses the same encoded image in the same format.
+// Textures attached before the upload is ready are pointed at the image once it is. If the owner fails to decode it,
+// the image is marked failed and its textures keep their default image. Only used on the main thread, except for Key.
+struct SharedImage {
+	uint64_t Key = 0;
+	Luna::Vulkan::ImageHandle Image;
+	std::vector<Luna::TextureHandle> Waiting;
+	std::vector<std::function<void()>> ReadyCallbacks;
+	bool Failed = false;
+
+	void Attach(const Luna::TextureHandle& texture);
+	// Calls back once the image has been uploaded or has failed, which may be straight away.
+	void WhenReady(std::function<void()> callback);
+	void SetImage(Luna::Vulkan::ImageHandle image);
+	void Fail();
+
+ private:
+	void RunReadyCallbacks();
+};
+
+// A node of a model, which becomes one entity each time the model is instantiated. Children index the model's nodes.
+struct ModelNode {
+	std::string Name;
+	glm::vec3 Translation = glm::vec3(0.0f);
+	glm::vec3 Rotation    = glm::vec3(0.0f);
+	glm::vec3 Scale       = glm::vec3(1.0f);
+	int Mesh              = -1;
+	std::shared_ptr<const std::vector<glm::mat4>> Instances;
+	std::vector<uint32_t> Children;
+};
+
+// The resources a model file was loaded into, along with its node hierarchy, so that it can be placed in a scene any
+// number of times without loading it again.
+struct LoadedModel {
+	std::vector<Luna::TextureHandle> Textures;
+	std::shared_ptr<const MaterialTable> Materials;
+	std::vector<Luna::IntrusivePtr<Luna::Mesh>> Meshes;
+	std::vector<std::shared_ptr<const MeshInfo>> MeshInfos;
+	// Indexed by the file's images. Filled in on the main thread as each image is decoded.
+	std::vector<std::shared_ptr<SharedImage>> Images;
+	std::vector<ModelNode> Nodes;
+	std::vector<uint32_t> RootNodes;
+};
+
+// Finds models and images that are already resident, so they are not loaded and uploaded again. Models are keyed by
+// their path and the hash of the file's contents, and images by the hash of their encoded data and format.
+//
+// The registry only holds weak references. Entities keep their model alive through a ModelComponent, and models keep
+// their images alive, so everything is released once the last entity using it has been destroyed.
+class AssetRegistry {
+ public:
+	AssetRegistry()                                = default;
+	AssetRegistry(const AssetRegistry&)            = delete;
+	AssetRegistry& operator=(const AssetRegistry&) = delete;
+
+	// Returns the model loaded from path, if it is still resident and was loaded from the same contents.
+	std::shared_ptr<LoadedModel> FindModel(const std::filesystem::path& path, uint64_t contentHash);
+	void AddModel(const std::filesystem::path& path, uint64_t contentHash, const std::shared_ptr<LoadedModel>& model);
+
+	// Returns the resident image with the given key, or a new, empty one if there is none. The flag is set when the image
+	// is new, in which case the caller is responsible for uploading it.
+	std::pair<std::shared_ptr<SharedImage>, bool> AcquireImage(uint64_t key);
+	// Forgets an image its owner failed to upload, so that the next model to acquire its key becomes the new owner.
+	void RemoveImage(const std::shared_ptr<SharedImage>& image);
+
+	size_t GetModelCount();
+	size_t GetImageCount();
+
+ private:
+	struct ModelEntry {
+		uint64_t ContentHash = 0;
+		std::weak_ptr<LoadedModel> Model;
+	};
+
+	static std::string GetModelKey(const std::filesystem::path& path);
+	void RemoveExpired();
+
+	std::mutex _mutex;
+	std::unordered_map<std::string, ModelEntry> _models;
+	std::unordered_map<uint64_t, std::weak_ptr<SharedImage>> _images;
+};
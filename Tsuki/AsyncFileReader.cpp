@@ -0,0 +1,317 @@
+#include "AsyncFileReader.hpp"
+
+#include <Utility/Files.hpp>
+#include <stdexcept>
+#include <string>
+
+#include "ThreadPool.hpp"
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define TSUKI_IO_URING 1
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <thread>
+#endif
+
+struct AsyncFileReader::Request {
+	std::shared_ptr<Batch::State> Owner;
+	size_t Index = 0;
+	std::filesystem::path Path;
+	int File = -1;
+	std::vector<uint8_t> Data;
+	size_t Offset = 0;
+};
+
+void AsyncFileReader::Batch::State::Complete(size_t index, std::vector<uint8_t>&& data, std::exception_ptr error) {
+	OnRead(index, std::move(data), error);
+
+	std::lock_guard<std::mutex> lock(Mutex);
+	if (--Remaining == 0) { Finished.notify_all(); }
+}
+
+AsyncFileReader::Batch::~Batch() noexcept {
+	Wait();
+}
+
+void AsyncFileReader::Batch::Wait() {
+	if (!_state) { return; }
+
+	std::unique_lock<std::mutex> lock(_state->Mutex);
+	_state->Finished.wait(lock, [this]() { return _state->Remaining == 0; });
+}
+
+#ifdef TSUKI_IO_URING
+// Enough reads in flight to keep any storage device busy. Further reads wait for a free slot.
+static constexpr uint32_t RingEntries = 64;
+
+// The length of a single read is 32-bit, so larger files are read in several parts.
+static constexpr size_t MaxReadSize = size_t(1) << 30;
+
+struct AsyncFileReader::Ring {
+	Ring()                       = default;
+	Ring(const Ring&)            = delete;
+	Ring& operator=(const Ring&) = delete;
+	~Ring() noexcept {
+		if (Sqes != MAP_FAILED) { munmap(Sqes, SqesSize); }
+		if (CqRing != MAP_FAILED && CqRing != SqRing) { munmap(CqRing, CqRingSize); }
+		if (SqRing != MAP_FAILED) { munmap(SqRing, SqRingSize); }
+		if (Fd >= 0) { close(Fd); }
+	}
+
+	int Fd            = -1;
+	void* SqRing      = MAP_FAILED;
+	void* CqRing      = MAP_FAILED;
+	void* Sqes        = MAP_FAILED;
+	size_t SqRingSize = 0;
+	size_t CqRingSize = 0;
+	size_t SqesSize   = 0;
+
+	uint32_t SqEntries = 0;
+	uint32_t* SqHead   = nullptr;
+	uint32_t* SqTail   = nullptr;
+	uint32_t* SqMask   = nullptr;
+	uint32_t* SqArray  = nullptr;
+	uint32_t* CqHead   = nullptr;
+	uint32_t* CqTail   = nullptr;
+	uint32_t* CqMask   = nullptr;
+	io_uring_cqe* Cqes = nullptr;
+
+	std::mutex Mutex;
+	// Reads waiting for a submission slot. A null entry asks the completion thread to stop.
+	std::deque<Request*> Queued;
+	uint32_t InFlight = 0;
+	std::thread CompletionThread;
+};
+
+static int IoUringSetup(uint32_t entries, io_uring_params* params) {
+	return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+static int IoUringEnter(int fd, uint32_t toSubmit, uint32_t minComplete, uint32_t flags) {
+	return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+}
+
+static std::exception_ptr MakeReadError(const std::filesystem::path& path, int error) {
+	return std::make_exception_ptr(
+		std::runtime_error("Failed to read file '" + path.string() + "': " + std::strerror(error)));
+}
+#else
+struct AsyncFileReader::Ring {};
+#endif
+
+AsyncFileReader::AsyncFileReader(ThreadPool& threadPool) : _threadPool(&threadPool) {
+#ifdef TSUKI_IO_URING
+	// io_uring may be missing from the kernel or blocked by a sandbox, in which case every read uses the thread pool.
+	// IORING_OP_READ arrived in Linux 5.6, alongside IORING_FEAT_RW_CUR_POS.
+	io_uring_params params = {};
+	auto ring              = std::make_unique<Ring>();
+	ring->Fd               = IoUringSetup(RingEntries, &params);
+	if (ring->Fd < 0 || (params.features & IORING_FEAT_RW_CUR_POS) == 0) { return; }
+
+	ring->SqRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+	ring->CqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+	ring->SqesSize   = params.sq_entries * sizeof(io_uring_sqe);
+	if (params.features & IORING_FEAT_SINGLE_MMAP) {
+		ring->SqRingSize = std::max(ring->SqRingSize, ring->CqRingSize);
+		ring->CqRingSize = ring->SqRingSize;
+	}
+
+	ring->SqRing = mmap(
+		nullptr, ring->SqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->Fd, IORING_OFF_SQ_RING);
+	if (ring->SqRing == MAP_FAILED) { return; }
+	if (params.features & IORING_FEAT_SINGLE_MMAP) {
+		ring->CqRing = ring->SqRing;
+	} else {
+		ring->CqRing = mmap(
+			nullptr, ring->CqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->Fd, IORING_OFF_CQ_RING);
+		if (ring->CqRing == MAP_FAILED) { return; }
+	}
+	ring->Sqes =
+		mmap(nullptr, ring->SqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->Fd, IORING_OFF_SQES);
+	if (ring->Sqes == MAP_FAILED) { return; }
+
+	auto* sq        = static_cast<uint8_t*>(ring->SqRing);
+	auto* cq        = static_cast<uint8_t*>(ring->CqRing);
+	ring->SqEntries = params.sq_entries;
+	ring->SqHead    = reinterpret_cast<uint32_t*>(sq + params.sq_off.head);
+	ring->SqTail    = reinterpret_cast<uint32_t*>(sq + params.sq_off.tail);
+	ring->SqMask    = reinterpret_cast<uint32_t*>(sq + params.sq_off.ring_mask);
+	ring->SqArray   = reinterpret_cast<uint32_t*>(sq + params.sq_off.array);
+	ring->CqHead    = reinterpret_cast<uint32_t*>(cq + params.cq_off.head);
+	ring->CqTail    = reinterpret_cast<uint32_t*>(cq + params.cq_off.tail);
+	ring->CqMask    = reinterpret_cast<uint32_t*>(cq + params.cq_off.ring_mask);
+	ring->Cqes      = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+	_ring                   = std::move(ring);
+	_ring->CompletionThread = std::thread(&AsyncFileReader::CompletionLoop, this);
+#endif
+}
+
+AsyncFileReader::~AsyncFileReader() noexcept {
+#ifdef TSUKI_IO_URING
+	if (!_ring) { return; }
+
+	{
+		std::lock_guard<std::mutex> lock(_ring->Mutex);
+		_ring->Queued.push_back(nullptr);
+		SubmitQueued();
+	}
+	_ring->CompletionThread.join();
+#endif
+}
+
+AsyncFileReader::Batch AsyncFileReader::ReadFiles(const std::vector<std::filesystem::path>& paths,
+                                                  ReadCallback onRead) {
+	Batch batch;
+	batch._state            = std::make_shared<Batch::State>();
+	batch._state->OnRead    = std::move(onRead);
+	batch._state->Remaining = paths.size();
+
+#ifdef TSUKI_IO_URING
+	if (_ring) {
+		std::vector<Request*> requests;
+		for (size_t i = 0; i < paths.size(); ++i) {
+			auto request   = std::make_unique<Request>();
+			request->Owner = batch._state;
+			request->Index = i;
+			request->Path  = paths[i];
+			request->File  = open(paths[i].c_str(), O_RDONLY | O_CLOEXEC);
+
+			struct stat status;
+			if (request->File < 0 || fstat(request->File, &status) != 0) {
+				const auto error = MakeReadError(paths[i], errno);
+				if (request->File >= 0) { close(request->File); }
+				_threadPool->Submit([state = batch._state, i, error]() { state->Complete(i, {}, error); });
+				continue;
+			}
+			if (status.st_size == 0) {
+				close(request->File);
+				_threadPool->Submit([state = batch._state, i]() { state->Complete(i, {}, nullptr); });
+				continue;
+			}
+
+			request->Data.resize(static_cast<size_t>(status.st_size));
+			requests.push_back(request.release());
+		}
+
+		std::lock_guard<std::mutex> lock(_ring->Mutex);
+		_ring->Queued.insert(_ring->Queued.end(), requests.begin(), requests.end());
+		SubmitQueued();
+
+		return batch;
+	}
+#endif
+
+	for (size_t i = 0; i < paths.size(); ++i) { ReadOnThreadPool(batch._state, i, paths[i]); }
+
+	return batch;
+}
+
+void AsyncFileReader::ReadOnThreadPool(std::shared_ptr<Batch::State> batch, size_t index, std::filesystem::path path) {
+	_threadPool->Submit([batch = std::move(batch), index, path = std::move(path)]() {
+		std::vector<uint8_t> data;
+		std::exception_ptr error;
+		try {
+			data = ReadFileBinary(path);
+		} catch (...) { error = std::current_exception(); }
+		batch->Complete(index, std::move(data), error);
+	});
+}
+
+// Moves as many queued reads into the submission ring as there are free slots. The ring mutex must be held.
+void AsyncFileReader::SubmitQueued() {
+#ifdef TSUKI_IO_URING
+	auto& ring         = *_ring;
+	uint32_t tail      = *ring.SqTail;
+	uint32_t submitted = 0;
+	while (!ring.Queued.empty() && ring.InFlight < ring.SqEntries) {
+		Request* request = ring.Queued.front();
+		ring.Queued.pop_front();
+
+		const uint32_t slot = tail & *ring.SqMask;
+		auto& sqe           = static_cast<io_uring_sqe*>(ring.Sqes)[slot];
+		std::memset(&sqe, 0, sizeof(sqe));
+		if (request == nullptr) {
+			sqe.opcode = IORING_OP_NOP;
+		} else {
+			sqe.opcode    = IORING_OP_READ;
+			sqe.fd        = request->File;
+			sqe.addr      = reinterpret_cast<uint64_t>(request->Data.data() + request->Offset);
+			sqe.len       = static_cast<uint32_t>(std::min(request->Data.size() - request->Offset, MaxReadSize));
+			sqe.off       = request->Offset;
+			sqe.user_data = reinterpret_cast<uint64_t>(request);
+		}
+		ring.SqArray[slot] = slot;
+
+		++tail;
+		++submitted;
+		++ring.InFlight;
+	}
+	if (submitted == 0) { return; }
+
+	__atomic_store_n(ring.SqTail, tail, __ATOMIC_RELEASE);
+	while (IoUringEnter(ring.Fd, submitted, 0, 0) < 0 && errno == EINTR) {}
+#endif
+}
+
+// Waits for reads to complete, resubmitting short reads and handing finished files to the thread pool.
+void AsyncFileReader::CompletionLoop() {
+#ifdef TSUKI_IO_URING
+	auto& ring    = *_ring;
+	bool stopping = false;
+	while (!stopping) {
+		IoUringEnter(ring.Fd, 0, 1, IORING_ENTER_GETEVENTS);
+
+		std::lock_guard<std::mutex> lock(ring.Mutex);
+		uint32_t head       = *ring.CqHead;
+		const uint32_t tail = __atomic_load_n(ring.CqTail, __ATOMIC_ACQUIRE);
+		for (; head != tail; ++head) {
+			const auto& cqe = ring.Cqes[head & *ring.CqMask];
+			--ring.InFlight;
+
+			std::unique_ptr<Request> request(reinterpret_cast<Request*>(cqe.user_data));
+			if (!request) {
+				stopping = true;
+				continue;
+			}
+
+			std::exception_ptr error;
+			if (cqe.res > 0) {
+				request->Offset += static_cast<size_t>(cqe.res);
+				if (request->Offset < request->Data.size()) {
+					ring.Queued.push_front(request.release());
+					continue;
+				}
+			} else if (cqe.res == -EINTR || cqe.res == -EAGAIN) {
+				ring.Queued.push_front(request.release());
+				continue;
+			} else if (cqe.res == -EINVAL || cqe.res == -EOPNOTSUPP) {
+				// Some file systems do not support reads through io_uring.
+				close(request->File);
+				ReadOnThreadPool(std::move(request->Owner), request->Index, std::move(request->Path));
+				continue;
+			} else {
+				error = MakeReadError(request->Path, cqe.res == 0 ? EIO : -cqe.res);
+				request->Data.clear();
+			}
+
+			close(request->File);
+			_threadPool->Submit([request = std::move(request), error]() {
+				request->Owner->Complete(request->Index, std::move(request->Data), error);
+			});
+		}
+		__atomic_store_n(ring.CqHead, head, __ATOMIC_RELEASE);
+
+		SubmitQueued();
+	}
+#endif
+}
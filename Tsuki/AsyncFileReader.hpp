@@ -0,0 +1,70 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class ThreadPool;
+
+// Reads whole files in the background. Where io_uring is available, every read of a batch is queued with the kernel at
+// once, so a batch of small files costs about as long as the slowest of them rather than their sum. Otherwise each file
+// is read by a thread pool job.
+class AsyncFileReader {
+ public:
+	// Called once for each file of a batch with its index in the batch and its contents, or with the reason it could not
+	// be read. Callbacks run on a background thread in the order reads finish, and must not block on other reads.
+	using ReadCallback = std::function<void(size_t index, std::vector<uint8_t>&& data, std::exception_ptr error)>;
+
+	// Tracks the reads started by one call to ReadFiles. Destroying it waits until every callback has returned, so
+	// callbacks may safely reference anything that outlives the batch.
+	class Batch {
+	 public:
+		Batch() = default;
+		Batch(Batch&&) noexcept            = default;
+		Batch& operator=(Batch&&) noexcept = default;
+		~Batch() noexcept;
+
+		void Wait();
+
+	 private:
+		friend class AsyncFileReader;
+
+		struct State {
+			ReadCallback OnRead;
+			std::mutex Mutex;
+			std::condition_variable Finished;
+			size_t Remaining = 0;
+
+			void Complete(size_t index, std::vector<uint8_t>&& data, std::exception_ptr error);
+		};
+
+		std::shared_ptr<State> _state;
+	};
+
+	AsyncFileReader(ThreadPool& threadPool);
+	AsyncFileReader(const AsyncFileReader&)            = delete;
+	AsyncFileReader& operator=(const AsyncFileReader&) = delete;
+	~AsyncFileReader() noexcept;
+
+	bool IsUsingIoUring() const {
+		return _ring != nullptr;
+	}
+
+	Batch ReadFiles(const std::vector<std::filesystem::path>& paths, ReadCallback onRead);
+
+ private:
+	struct Request;
+	struct Ring;
+
+	void ReadOnThreadPool(std::shared_ptr<Batch::State> batch, size_t index, std::filesystem::path path);
+	void SubmitQueued();
+	void CompletionLoop();
+
+	ThreadPool* _threadPool;
+	std::unique_ptr<Ring> _ring;
+};
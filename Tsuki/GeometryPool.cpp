@@ -0,0 +1,315 @@
+#include "GeometryPool.hpp"
+
+#include <Utility/Log.hpp>
+#include <Vulkan/Buffer.hpp>
+#include <Vulkan/Device.hpp>
+#include <Vulkan/WSI.hpp>
+#include <algorithm>
+#include <iterator>
+#include <limits>
+
+#include "UploadManager.hpp"
+
+using namespace Luna;
+
+// Arenas start out large enough for a typical model, so that small scenes never have to grow them.
+static constexpr uint32_t MinVertexCapacity  = 1u << 16;
+static constexpr uint32_t MinIndexCapacity   = 1u << 18;
+static constexpr uint32_t MinMeshletCapacity = 1u << 12;
+
+static std::array<const VertexStream*, GeometryPool::StreamCount> GetStreams(const MeshInfo& info) {
+	return {&info.Position, &info.Normal, &info.Tangent, &info.Bitangent, &info.Texcoord0};
+}
+
+static vk::DeviceSize GetIndexStride(const MeshInfo& info) {
+	return info.IndexType == vk::IndexType::eUint16 ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
+static vk::DeviceSize GetVertexStride(const MeshInfo& info) {
+	vk::DeviceSize stride = 0;
+	for (const auto* stream : GetStreams(info)) { stride += stream->Stride; }
+
+	return stride;
+}
+
+static bool SameLayout(const MeshInfo& a, const MeshInfo& b) {
+	const auto aStreams = GetStreams(a);
+	const auto bStreams = GetStreams(b);
+	for (size_t i = 0; i < GeometryPool::StreamCount; ++i) {
+		if (aStreams[i]->Format != bStreams[i]->Format || aStreams[i]->Stride != bStreams[i]->Stride) { return false; }
+	}
+
+	return a.IndexType == b.IndexType && a.Compact == b.Compact;
+}
+
+std::optional<uint32_t> RangeAllocator::Allocate(uint32_t count) {
+	if (count == 0) { return 0; }
+
+	for (auto it = _freeRanges.begin(); it != _freeRanges.end(); ++it) {
+		if (it->second < count) { continue; }
+
+		const uint32_t offset = it->first;
+		const uint32_t size   = it->second;
+		_freeRanges.erase(it);
+		if (size > count) { _freeRanges.emplace(offset + count, size - count); }
+
+		return offset;
+	}
+
+	return std::nullopt;
+}
+
+void RangeAllocator::Free(uint32_t offset, uint32_t count) {
+	if (count == 0) { return; }
+
+	auto next = _freeRanges.lower_bound(offset);
+	if (next != _freeRanges.end() && offset + count == next->first) {
+		count += next->second;
+		next = _freeRanges.erase(next);
+	}
+	if (next != _freeRanges.begin()) {
+		auto prev = std::prev(next);
+		if (prev->first + prev->second == offset) {
+			prev->second += count;
+			return;
+		}
+	}
+	_freeRanges.emplace(offset, count);
+}
+
+void RangeAllocator::Grow(uint32_t capacity) {
+	if (capacity <= _capacity) { return; }
+
+	const uint32_t oldCapacity = _capacity;
+	_capacity                  = capacity;
+	Free(oldCapacity, capacity - oldCapacity);
+}
+
+GeometryPool::GeometryPool(Vulkan::WSI& wsi, UploadManager& uploads) {
+	_wsi     = &wsi;
+	_uploads = &uploads;
+}
+
+GeometryPool::~GeometryPool() noexcept {
+	_arenas.clear();
+	_wsi     = nullptr;
+	_uploads = nullptr;
+}
+
+std::shared_ptr<const GeometryAllocation> GeometryPool::Allocate(Mesh& mesh,
+                                                                 const MeshInfo& info,
+                                                                 const std::vector<Meshlet>& meshlets,
+                                                                 const uint8_t* data,
+                                                                 vk::DeviceSize size) {
+	auto& arena = GetArena(info);
+
+	const auto vertexCount   = static_cast<uint32_t>(mesh.TotalVertexCount);
+	const auto indexCount    = static_cast<uint32_t>(mesh.TotalIndexCount);
+	const auto meshletCount  = static_cast<uint32_t>(meshlets.size());
+	const auto indexStride   = GetIndexStride(info);
+	const auto streams       = GetStreams(info);
+	const auto streamOffsets = std::array<vk::DeviceSize, StreamCount>{
+		mesh.PositionOffset, mesh.NormalOffset, mesh.TangentOffset, mesh.BitangentOffset, mesh.Texcoord0Offset};
+
+	// Cooked data is read back from disk, so its layout is checked against its size before anything is copied from it.
+	const auto Fits = [&](vk::DeviceSize offset, vk::DeviceSize rangeSize) -> bool {
+		return offset <= size && rangeSize <= size - offset;
+	};
+	bool fits = Fits(mesh.IndexOffset, vk::DeviceSize(indexCount) * indexStride);
+	for (size_t i = 0; i < StreamCount; ++i) {
+		if (streams[i]->Stride > 0) { fits &= Fits(streamOffsets[i], vk::DeviceSize(vertexCount) * streams[i]->Stride); }
+	}
+	if (!fits) {
+		Log::Error("GeometryPool", "Mesh data of {} bytes is too small for its vertices and indices.", size);
+		return nullptr;
+	}
+
+	auto firstVertex  = arena.VertexRanges.Allocate(vertexCount);
+	auto firstIndex   = arena.IndexRanges.Allocate(indexCount);
+	auto firstMeshlet = arena.MeshletRanges.Allocate(meshletCount);
+	if (!firstVertex || !firstIndex || !firstMeshlet) {
+		// Capacities double, so that the buffers of an arena are only reallocated a logarithmic number of times.
+		const auto NewCapacity = [](uint32_t capacity, uint32_t minCapacity, uint32_t count) -> uint32_t {
+			const uint64_t required = uint64_t(capacity) + count;
+			uint64_t newCapacity    = std::max(capacity, minCapacity);
+			while (newCapacity < required) { newCapacity *= 2; }
+
+			return static_cast<uint32_t>(std::min<uint64_t>(newCapacity, std::numeric_limits<uint32_t>::max()));
+		};
+		uint32_t vertexCapacity  = arena.VertexRanges.GetCapacity();
+		uint32_t indexCapacity   = arena.IndexRanges.GetCapacity();
+		uint32_t meshletCapacity = arena.MeshletRanges.GetCapacity();
+		if (!firstVertex) { vertexCapacity = NewCapacity(vertexCapacity, MinVertexCapacity, vertexCount); }
+		if (!firstIndex) { indexCapacity = NewCapacity(indexCapacity, MinIndexCapacity, indexCount); }
+		if (!firstMeshlet) { meshletCapacity = NewCapacity(meshletCapacity, MinMeshletCapacity, meshletCount); }
+		GrowArena(arena, vertexCapacity, indexCapacity, meshletCapacity);
+
+		if (!firstVertex) { firstVertex = arena.VertexRanges.Allocate(vertexCount); }
+		if (!firstIndex) { firstIndex = arena.IndexRanges.Allocate(indexCount); }
+		if (!firstMeshlet) { firstMeshlet = arena.MeshletRanges.Allocate(meshletCount); }
+	}
+
+	// Stage the cooked data once per stream, straight into its place in the arena. The upload manager makes the
+	// renderer wait for the copies before it reads them.
+	for (size_t i = 0; i < StreamCount; ++i) {
+		const vk::DeviceSize stride = streams[i]->Stride;
+		if (stride == 0 || vertexCount == 0) { continue; }
+		_uploads->UploadBuffer(
+			*arena.Streams[i], *firstVertex * stride, data + streamOffsets[i], vk::DeviceSize(vertexCount) * stride);
+	}
+	if (indexCount > 0) {
+		_uploads->UploadBuffer(
+			*arena.Indices, *firstIndex * indexStride, data + mesh.IndexOffset, vk::DeviceSize(indexCount) * indexStride);
+	}
+	if (meshletCount > 0) {
+		// Meshlets address the arena's index buffer directly.
+		auto rebased = meshlets;
+		for (auto& meshlet : rebased) { meshlet.FirstIndex += *firstIndex; }
+		_uploads->UploadBuffer(
+			*arena.Meshlets, *firstMeshlet * sizeof(Meshlet), rebased.data(), rebased.size() * sizeof(Meshlet));
+	}
+
+	// Submeshes now address the arena directly, rather than the mesh's own buffer.
+	for (auto& submesh : mesh.Submeshes) {
+		submesh.FirstVertex += *firstVertex;
+		submesh.FirstIndex += *firstIndex;
+	}
+	mesh.PositionOffset  = 0;
+	mesh.NormalOffset    = 0;
+	mesh.TangentOffset   = 0;
+	mesh.BitangentOffset = 0;
+	mesh.Texcoord0Offset = 0;
+	mesh.IndexOffset     = 0;
+
+	_allocatedSize += vertexCount * GetVertexStride(info) + indexCount * indexStride + meshletCount * sizeof(Meshlet);
+
+	auto allocation          = std::make_shared<GeometryAllocation>();
+	allocation->Arena        = &arena;
+	allocation->FirstVertex  = *firstVertex;
+	allocation->VertexCount  = vertexCount;
+	allocation->FirstIndex   = *firstIndex;
+	allocation->IndexCount   = indexCount;
+	allocation->FirstMeshlet = *firstMeshlet;
+	allocation->MeshletCount = meshletCount;
+
+	return allocation;
+}
+
+void GeometryPool::NextFrame() {
+	++_frame;
+
+	const uint64_t framesInFlight = _wsi->GetImageCount();
+	std::erase_if(_pendingFrees, [&](const PendingFree& pending) {
+		if (pending.Frame + framesInFlight > _frame) { return false; }
+
+		auto& arena = *pending.Target;
+		arena.VertexRanges.Free(pending.FirstVertex, pending.VertexCount);
+		arena.IndexRanges.Free(pending.FirstIndex, pending.IndexCount);
+		arena.MeshletRanges.Free(pending.FirstMeshlet, pending.MeshletCount);
+		_allocatedSize -= pending.VertexCount * GetVertexStride(arena.Layout) +
+		                  pending.IndexCount * GetIndexStride(arena.Layout) + pending.MeshletCount * sizeof(Meshlet);
+
+		return true;
+	});
+}
+
+vk::DeviceSize GeometryPool::GetAllocatedSize() const {
+	return _allocatedSize;
+}
+
+vk::DeviceSize GeometryPool::GetCapacity() const {
+	vk::DeviceSize capacity = 0;
+	for (const auto& arena : _arenas) {
+		capacity += arena->VertexRanges.GetCapacity() * GetVertexStride(arena->Layout) +
+		            arena->IndexRanges.GetCapacity() * GetIndexStride(arena->Layout) +
+		            arena->MeshletRanges.GetCapacity() * sizeof(Meshlet);
+	}
+
+	return capacity;
+}
+
+GeometryPool::Arena& GeometryPool::GetArena(const MeshInfo& info) {
+	for (auto& arena : _arenas) {
+		if (SameLayout(arena->Layout, info)) { return *arena; }
+	}
+
+	auto& arena            = _arenas.emplace_back(std::make_unique<Arena>());
+	arena->Pool            = this;
+	arena->Layout          = info;
+	arena->Layout.Geometry = nullptr;
+	arena->Layout.SubmeshMeshlets.clear();
+	arena->Layout.SubmeshLods.clear();
+
+	return *arena;
+}
+
+void GeometryPool::Free(const GeometryAllocation& allocation) {
+	_pendingFrees.push_back({.Target       = allocation.Arena,
+	                         .FirstVertex  = allocation.FirstVertex,
+	                         .VertexCount  = allocation.VertexCount,
+	                         .FirstIndex   = allocation.FirstIndex,
+	                         .IndexCount   = allocation.IndexCount,
+	                         .FirstMeshlet = allocation.FirstMeshlet,
+	                         .MeshletCount = allocation.MeshletCount,
+	                         .Frame        = _frame});
+}
+
+void GeometryPool::GrowArena(Arena& arena,
+                             uint32_t vertexCapacity,
+                             uint32_t indexCapacity,
+                             uint32_t meshletCapacity) {
+	auto& device = _wsi->GetDevice();
+
+	// Existing geometry is copied into the new buffers on the GPU. The old buffers stay alive until frames in flight
+	// are done with them.
+	const auto Reallocate = [&](Vulkan::BufferHandle& buffer,
+	                            vk::DeviceSize oldSize,
+	                            vk::DeviceSize newSize,
+	                            vk::BufferUsageFlags usage) -> void {
+		if (newSize == 0 || newSize == oldSize) { return; }
+
+		auto newBuffer = device.CreateBuffer(Vulkan::BufferCreateInfo(
+			Vulkan::BufferDomain::Device,
+			newSize,
+			usage | vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst));
+		if (buffer && oldSize > 0) { _uploads->CopyBuffer(*newBuffer, 0, *buffer, 0, oldSize); }
+		buffer = newBuffer;
+	};
+
+	const auto streams = GetStreams(arena.Layout);
+	for (size_t i = 0; i < StreamCount; ++i) {
+		const vk::DeviceSize stride = streams[i]->Stride;
+		Reallocate(arena.Streams[i],
+		           arena.VertexRanges.GetCapacity() * stride,
+		           vertexCapacity * stride,
+		           vk::BufferUsageFlagBits::eVertexBuffer);
+	}
+	const vk::DeviceSize indexStride = GetIndexStride(arena.Layout);
+	// The culling shader reads indices and meshlets as storage buffers.
+	Reallocate(arena.Indices,
+	           arena.IndexRanges.GetCapacity() * indexStride,
+	           indexCapacity * indexStride,
+	           vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eStorageBuffer);
+	Reallocate(arena.Meshlets,
+	           arena.MeshletRanges.GetCapacity() * sizeof(Meshlet),
+	           meshletCapacity * sizeof(Meshlet),
+	           vk::BufferUsageFlagBits::eStorageBuffer);
+
+	arena.VertexRanges.Grow(vertexCapacity);
+	arena.IndexRanges.Grow(indexCapacity);
+	arena.MeshletRanges.Grow(meshletCapacity);
+
+	Log::Info("GeometryPool",
+	          "Resized geometry arena with {} positions to {} vertices, {} indices and {} meshlets ({:.2f} MiB).",
+	          vk::to_string(arena.Layout.Position.Format),
+	          vertexCapacity,
+	          indexCapacity,
+	          meshletCapacity,
+	          (vertexCapacity * GetVertexStride(arena.Layout) + indexCapacity * indexStride +
+	           meshletCapacity * sizeof(Meshlet)) /
+	            (1024.0 * 1024.0));
+}
+
+GeometryAllocation::~GeometryAllocation() noexcept {
+	if (Arena) { Arena->Pool->Free(*this); }
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <Assets/Mesh.hpp>
+#include <Vulkan/Common.hpp>
+#include <array>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "MeshInfoComponent.hpp"
+#include "MeshOptimizer.hpp"
+
+class UploadManager;
+
+// Hands out ranges of a fixed-size address space, keeping free ranges sorted by offset so that neighbouring ranges
+// coalesce when they are released.
+class RangeAllocator {
+ public:
+	uint32_t GetCapacity() const {
+		return _capacity;
+	}
+
+	std::optional<uint32_t> Allocate(uint32_t count);
+	void Free(uint32_t offset, uint32_t count);
+	void Grow(uint32_t capacity);
+
+ private:
+	std::map<uint32_t, uint32_t> _freeRanges;
+	uint32_t _capacity = 0;
+};
+
+// Stores the geometry of many meshes in a handful of large device buffers, one per vertex stream plus one for indices,
+// so that the renderer can bind them once per pass instead of once per mesh. Meshes with different vertex layouts
+// cannot share bindings, so each layout gets its own arena of buffers. Each arena also keeps the meshlets of its meshes
+// in a storage buffer, addressing its index buffer, for culling on the GPU.
+class GeometryPool {
+ public:
+	static constexpr size_t StreamCount = 5;
+
+	struct Arena {
+		GeometryPool* Pool = nullptr;
+		MeshInfo Layout;
+		// Position, Normal, Tangent, Bitangent and Texcoord0, in the same order as MeshInfo. Streams with a stride of 0
+		// have no buffer.
+		std::array<Luna::Vulkan::BufferHandle, StreamCount> Streams;
+		Luna::Vulkan::BufferHandle Indices;
+		Luna::Vulkan::BufferHandle Meshlets;
+		RangeAllocator VertexRanges;
+		RangeAllocator IndexRanges;
+		RangeAllocator MeshletRanges;
+	};
+
+	GeometryPool(Luna::Vulkan::WSI& wsi, UploadManager& uploads);
+	GeometryPool(const GeometryPool&)            = delete;
+	GeometryPool& operator=(const GeometryPool&) = delete;
+	~GeometryPool() noexcept;
+
+	// Copies the cooked vertex and index data of a mesh into the arena matching its layout, and rebases the submeshes of
+	// the mesh onto the arena, along with its meshlets. The ranges are released when the returned allocation is
+	// destroyed. Returns nothing, without copying, if the streams and indices of the mesh do not fit in size bytes.
+	std::shared_ptr<const GeometryAllocation> Allocate(Luna::Mesh& mesh,
+	                                                   const MeshInfo& info,
+	                                                   const std::vector<Meshlet>& meshlets,
+	                                                   const uint8_t* data,
+	                                                   vk::DeviceSize size);
+
+	// Releases ranges that were freed long enough ago that no frame in flight can still be reading them.
+	void NextFrame();
+
+	vk::DeviceSize GetAllocatedSize() const;
+	vk::DeviceSize GetCapacity() const;
+
+ private:
+	friend struct GeometryAllocation;
+
+	struct PendingFree {
+		Arena* Target;
+		uint32_t FirstVertex;
+		uint32_t VertexCount;
+		uint32_t FirstIndex;
+		uint32_t IndexCount;
+		uint32_t FirstMeshlet;
+		uint32_t MeshletCount;
+		uint64_t Frame;
+	};
+
+	Arena& GetArena(const MeshInfo& info);
+	void Free(const GeometryAllocation& allocation);
+	void GrowArena(Arena& arena,
+	               uint32_t vertexCapacity,
+	               uint32_t indexCapacity,
+	               uint32_t meshletCapacity);
+
+	Luna::Vulkan::WSI* _wsi;
+	UploadManager* _uploads;
+	std::vector<std::unique_ptr<Arena>> _arenas;
+	std::vector<PendingFree> _pendingFrees;
+	uint64_t _frame               = 0;
+	vk::DeviceSize _allocatedSize = 0;
+};
+
+// A range of vertices and indices inside one arena of a GeometryPool. Submeshes of the owning mesh address the arena's
+// buffers directly, so no per-mesh offsets are needed when drawing.
+struct GeometryAllocation {
+	GeometryAllocation()                                     = default;
+	GeometryAllocation(const GeometryAllocation&)            = delete;
+	GeometryAllocation& operator=(const GeometryAllocation&) = delete;
+	~GeometryAllocation() noexcept;
+
+	GeometryPool::Arena* Arena = nullptr;
+	uint32_t FirstVertex       = 0;
+	uint32_t VertexCount       = 0;
+	uint32_t FirstIndex        = 0;
+	uint32_t IndexCount        = 0;
+	uint32_t FirstMeshlet      = 0;
+	uint32_t MeshletCount      = 0;
+};
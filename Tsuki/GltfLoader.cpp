@@ -1,5 +1,6 @@
 #include "GltfLoader.hpp"
 
+#include <json.hpp>
 #include <stb_image.h>
 #include <tiny_gltf.h>
 
@@ -7,264 +8,1332 @@
 #include <Scene/MeshComponent.hpp>
 #include <Scene/Scene.hpp>
 #include <Scene/TransformComponent.hpp>
-#include <Utility/Files.hpp>
 #include <Utility/Log.hpp>
 #include <Vulkan/Buffer.hpp>
 #include <Vulkan/Device.hpp>
 #include <Vulkan/Image.hpp>
 #include <Vulkan/WSI.hpp>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+#include <glm/gtc/quaternion.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/matrix_decompose.hpp>
-
+#include <limits>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+
+#include "AssetCache.hpp"
+#include "AssetRegistry.hpp"
+#include "AsyncFileReader.hpp"
+#include "GeometryPool.hpp"
+#include "InstancesComponent.hpp"
+#include "MappedFile.hpp"
+#include "MeshInfoComponent.hpp"
+#include "MeshOptimizer.hpp"
+#include "ModelComponent.hpp"
+#include "TextureCompressor.hpp"
+#include "TextureTranscoder.hpp"
+#include "ThreadPool.hpp"
+#include "UploadManager.hpp"
 #include "mikktspace.h"
 
 using namespace Luna;
 
-GltfLoader::GltfLoader(Luna::Vulkan::WSI& wsi) {
-	_wsi = &wsi;
+// Increment whenever the cooked mesh layout or the processing that produces it changes.
+static constexpr uint32_t MeshCacheMagic   = 0x4d4b5354;  // "TSKM"
+static constexpr uint32_t MeshCacheVersion = 9;
+
+// Each level of detail aims for half the triangles of the previous one, and stops at an error of this fraction of the
+// primitive's bounding box diagonal.
+static constexpr float LodMaxError = 0.05f;
+
+// Increment whenever the compressed texture layout or the encoders that produce it change.
+static constexpr uint32_t TextureCacheMagic   = 0x58544b54;  // "TKTX"
+static constexpr uint32_t TextureCacheVersion = 3;
+
+// Time spent each frame on asynchronous load work that has to happen on the main thread, such as creating images.
+static constexpr double MainThreadBudgetMs = 4.0;
+
+// A .glb file is a 12-byte header followed by a JSON chunk and an optional BIN chunk.
+static constexpr uint32_t GlbMagic     = 0x46546c67;  // "glTF"
+static constexpr uint32_t GlbChunkJson = 0x4e4f534a;  // "JSON"
+static constexpr uint32_t GlbChunkBin  = 0x004e4942;  // "BIN\0"
+
+struct CookedMesh {
+	Mesh Layout;
+	MeshInfo Info;
+	std::vector<Meshlet> Meshlets;
+	const uint8_t* Data = nullptr;
+	vk::DeviceSize Size = 0;
+	// Owns Data for meshes cooked during this load. Meshes read from the cache point into the cache file instead.
+	std::unique_ptr<uint8_t[]> Storage;
+};
+
+static void WriteMeshCacheHeader(AssetCache::Writer& writer, uint64_t sourceHash, uint32_t meshCount) {
+	writer.Write(MeshCacheMagic);
+	writer.Write(MeshCacheVersion);
+	writer.Write(sourceHash);
+	writer.Write(meshCount);
 }
 
-GltfLoader::~GltfLoader() noexcept {
-	_wsi = nullptr;
+static void WriteCookedMesh(AssetCache::Writer& writer,
+                            const Mesh& mesh,
+                            const MeshInfo& info,
+                            const std::vector<Meshlet>& meshlets,
+                            const void* data,
+                            vk::DeviceSize size) {
+	writer.Write(mesh.Bounds.GetMin());
+	writer.Write(mesh.Bounds.GetMax());
+	writer.Write(static_cast<uint64_t>(mesh.PositionOffset));
+	writer.Write(static_cast<uint64_t>(mesh.NormalOffset));
+	writer.Write(static_cast<uint64_t>(mesh.TangentOffset));
+	writer.Write(static_cast<uint64_t>(mesh.BitangentOffset));
+	writer.Write(static_cast<uint64_t>(mesh.Texcoord0Offset));
+	writer.Write(static_cast<uint64_t>(mesh.IndexOffset));
+	writer.Write(static_cast<uint64_t>(mesh.TotalVertexCount));
+	writer.Write(static_cast<uint64_t>(mesh.TotalIndexCount));
+	writer.Write(static_cast<uint32_t>(mesh.Submeshes.size()));
+	for (const auto* stream : {&info.Position, &info.Normal, &info.Tangent, &info.Bitangent, &info.Texcoord0}) {
+		writer.Write(static_cast<int32_t>(stream->Format));
+		writer.Write(stream->Stride);
+	}
+	writer.Write(static_cast<uint8_t>(info.Compact));
+	writer.Write(static_cast<int32_t>(info.IndexType));
+
+	for (const auto& submesh : mesh.Submeshes) {
+		writer.Write(submesh.Bounds.GetMin());
+		writer.Write(submesh.Bounds.GetMax());
+		writer.Write(static_cast<uint64_t>(submesh.VertexCount));
+		writer.Write(static_cast<uint64_t>(submesh.IndexCount));
+		writer.Write(static_cast<uint64_t>(submesh.FirstVertex));
+		writer.Write(static_cast<uint64_t>(submesh.FirstIndex));
+		writer.Write(static_cast<int32_t>(submesh.MaterialIndex));
+	}
+	for (const auto& range : info.SubmeshMeshlets) {
+		writer.Write(range.FirstMeshlet);
+		writer.Write(range.MeshletCount);
+	}
+	for (const auto& lods : info.SubmeshLods) {
+		writer.Write(static_cast<uint32_t>(lods.size()));
+		for (const auto& lod : lods) {
+			writer.Write(lod.FirstIndex);
+			writer.Write(lod.IndexCount);
+			writer.Write(lod.Error);
+		}
+	}
+	writer.Write(static_cast<uint32_t>(meshlets.size()));
+	writer.Write(meshlets.data(), meshlets.size() * sizeof(Meshlet));
+
+	writer.Write(static_cast<uint64_t>(size));
+	writer.Write(data, size);
 }
 
-Entity GltfLoader::Load(const std::filesystem::path& meshAssetPath, Scene& scene) {
-	const auto gltfPath      = meshAssetPath;
-	const auto gltfFile      = gltfPath.string();
-	const auto gltfFolder    = gltfPath.parent_path().string();
-	const auto gltfFileName  = gltfPath.filename().string();
-	const auto gltfFileNameC = gltfFileName.c_str();
+// Parses a cooked mesh file. The returned meshes point directly into the given data, so it must outlive them.
+static bool ReadMeshCache(const std::vector<uint8_t>& data, uint64_t sourceHash, std::vector<CookedMesh>& meshes) {
+	AssetCache::Reader reader(data.data(), data.size());
+
+	uint32_t magic, version, meshCount;
+	uint64_t hash;
+	if (!reader.Read(magic) || !reader.Read(version) || !reader.Read(hash) || !reader.Read(meshCount)) { return false; }
+	if (magic != MeshCacheMagic || version != MeshCacheVersion || hash != sourceHash) { return false; }
+
+	meshes.resize(meshCount);
+	for (auto& cooked : meshes) {
+		auto& mesh = cooked.Layout;
+
+		glm::vec3 boundsMin, boundsMax;
+		uint64_t positionOffset, normalOffset, tangentOffset, bitangentOffset, texcoord0Offset, indexOffset;
+		uint64_t totalVertexCount, totalIndexCount;
+		uint32_t submeshCount;
+		if (!reader.Read(boundsMin) || !reader.Read(boundsMax) || !reader.Read(positionOffset) ||
+		    !reader.Read(normalOffset) || !reader.Read(tangentOffset) || !reader.Read(bitangentOffset) ||
+		    !reader.Read(texcoord0Offset) || !reader.Read(indexOffset) || !reader.Read(totalVertexCount) ||
+		    !reader.Read(totalIndexCount) || !reader.Read(submeshCount)) {
+			return false;
+		}
+		mesh.Bounds           = AABB(boundsMin, boundsMax);
+		mesh.PositionOffset   = positionOffset;
+		mesh.NormalOffset     = normalOffset;
+		mesh.TangentOffset    = tangentOffset;
+		mesh.BitangentOffset  = bitangentOffset;
+		mesh.Texcoord0Offset  = texcoord0Offset;
+		mesh.IndexOffset      = indexOffset;
+		mesh.TotalVertexCount = totalVertexCount;
+		mesh.TotalIndexCount  = totalIndexCount;
 
-	tinygltf::Model gltfModel;
-	tinygltf::TinyGLTF loader;
-	std::string gltfError;
-	std::string gltfWarning;
-	bool loaded;
-	const auto gltfExt = gltfPath.extension().string();
-	if (gltfExt == ".gltf") {
-		loaded = loader.LoadASCIIFromFile(&gltfModel, &gltfError, &gltfWarning, gltfFile);
-	} else if (gltfExt == ".glb") {
-		loaded = loader.LoadBinaryFromFile(&gltfModel, &gltfError, &gltfWarning, gltfFile);
-	} else {
-		Log::Error("GltfLoader", "Mesh asset file {} is not supported!", gltfFile);
-		return {};
+		auto& info = cooked.Info;
+		for (auto* stream : {&info.Position, &info.Normal, &info.Tangent, &info.Bitangent, &info.Texcoord0}) {
+			int32_t format;
+			if (!reader.Read(format) || !reader.Read(stream->Stride)) { return false; }
+			stream->Format = static_cast<vk::Format>(format);
+		}
+		uint8_t compact;
+		int32_t indexType;
+		if (!reader.Read(compact) || !reader.Read(indexType)) { return false; }
+		info.Compact   = compact != 0;
+		info.IndexType = static_cast<vk::IndexType>(indexType);
+
+		mesh.Submeshes.resize(submeshCount);
+		for (auto& submesh : mesh.Submeshes) {
+			uint64_t vertexCount, indexCount, firstVertex, firstIndex;
+			int32_t materialIndex;
+			if (!reader.Read(boundsMin) || !reader.Read(boundsMax) || !reader.Read(vertexCount) ||
+			    !reader.Read(indexCount) || !reader.Read(firstVertex) || !reader.Read(firstIndex) ||
+			    !reader.Read(materialIndex)) {
+				return false;
+			}
+			submesh.Bounds        = AABB(boundsMin, boundsMax);
+			submesh.VertexCount   = vertexCount;
+			submesh.IndexCount    = indexCount;
+			submesh.FirstVertex   = firstVertex;
+			submesh.FirstIndex    = firstIndex;
+			submesh.MaterialIndex = materialIndex;
+		}
+		info.SubmeshMeshlets.resize(submeshCount);
+		for (auto& range : info.SubmeshMeshlets) {
+			if (!reader.Read(range.FirstMeshlet) || !reader.Read(range.MeshletCount)) { return false; }
+		}
+		info.SubmeshLods.resize(submeshCount);
+		for (auto& lods : info.SubmeshLods) {
+			uint32_t lodCount;
+			if (!reader.Read(lodCount) || lodCount >= MeshInfo::MaxLodCount) { return false; }
+			lods.resize(lodCount);
+			for (auto& lod : lods) {
+				if (!reader.Read(lod.FirstIndex) || !reader.Read(lod.IndexCount) || !reader.Read(lod.Error)) { return false; }
+			}
+		}
+		uint32_t meshletCount;
+		if (!reader.Read(meshletCount)) { return false; }
+		const uint8_t* meshletData = reader.ReadBytes(meshletCount * sizeof(Meshlet));
+		if (meshletData == nullptr) { return false; }
+		cooked.Meshlets.resize(meshletCount);
+		memcpy(cooked.Meshlets.data(), meshletData, meshletCount * sizeof(Meshlet));
+
+		uint64_t size;
+		if (!reader.Read(size)) { return false; }
+		cooked.Data = reader.ReadBytes(size);
+		cooked.Size = size;
+		if (cooked.Data == nullptr) { return false; }
 	}
 
-	if (!gltfError.empty()) { Log::Error("GltfLoader", "Error loading mesh asset {}: {}", gltfFile, gltfError); }
-	if (!gltfWarning.empty()) { Log::Warning("GltfLoader", "Warning loading mesh asset {}: {}", gltfFile, gltfWarning); }
-	if (!loaded) {
-		Log::Error("GltfLoader", "Failed to load mesh asset file {}.", gltfFile);
-		return {};
+	return true;
+}
+
+// Checks that a cooked mesh file reads back as it was written, by writing what was read again and comparing the two.
+// Any field the reader skips or misreads changes the second copy, so a reader that drifts from the writer is caught
+// when the file is cooked, rather than showing up as a cache that never hits.
+static bool VerifyMeshCache(const std::vector<uint8_t>& data, uint64_t sourceHash) {
+	std::vector<CookedMesh> meshes;
+	if (!ReadMeshCache(data, sourceHash, meshes)) { return false; }
+
+	AssetCache::Writer writer;
+	WriteMeshCacheHeader(writer, sourceHash, static_cast<uint32_t>(meshes.size()));
+	for (const auto& mesh : meshes) {
+		WriteCookedMesh(writer, mesh.Layout, mesh.Info, mesh.Meshlets, mesh.Data, mesh.Size);
 	}
 
-	// Quickly iterate over materials to find what format each image should be, Srgb or Unorm.
-	std::vector<vk::Format> textureFormats(gltfModel.images.size(), vk::Format::eUndefined);
-	const auto EnsureFormat = [&](uint32_t index, vk::Format expected) -> void {
-		auto& format = textureFormats[index];
-		if (format != vk::Format::eUndefined && format != expected) {
-			Log::Error(
-				"GltfLoader", "For asset '{}', texture index {} is used in both Srgb and Unorm contexts!", gltfFile, index);
+	return writer.GetData() == data;
+}
+
+// Finds the JSON chunk and, if present, the BIN chunk of a .glb file in memory.
+static bool SplitGlb(const uint8_t* data, size_t size, std::string_view& json, std::span<const uint8_t>& bin) {
+	uint32_t header[3];
+	if (size < sizeof(header)) { return false; }
+	memcpy(header, data, sizeof(header));
+	if (header[0] != GlbMagic || header[1] != 2 || header[2] > size) { return false; }
+
+	size_t offset = sizeof(header);
+	while (header[2] - offset >= 8) {
+		uint32_t chunk[2];
+		memcpy(chunk, data + offset, sizeof(chunk));
+		offset += sizeof(chunk);
+		if (chunk[0] > header[2] - offset) { return false; }
+
+		if (chunk[1] == GlbChunkJson && json.empty()) {
+			json = std::string_view(reinterpret_cast<const char*>(data + offset), chunk[0]);
+		} else if (chunk[1] == GlbChunkBin && bin.empty()) {
+			bin = std::span<const uint8_t>(data + offset, chunk[0]);
 		}
-		format = expected;
-	};
-	for (size_t i = 0; i < gltfModel.materials.size(); ++i) {
-		const auto& gltfMaterial = gltfModel.materials[i];
+		offset += std::min<size_t>((size_t(chunk[0]) + 3) & ~size_t(3), header[2] - offset);
+	}
 
-		if (gltfMaterial.pbrMetallicRoughness.baseColorTexture.index >= 0) {
-			EnsureFormat(gltfMaterial.pbrMetallicRoughness.baseColorTexture.index, vk::Format::eR8G8B8A8Srgb);
+	return !json.empty();
+}
+
+// Decodes the percent-escapes of a relative uri, e.g. "Sponza%20Diffuse.png".
+static std::string DecodeUri(const std::string& uri) {
+	const auto IsHexDigit = [](char c) -> bool { return std::isxdigit(static_cast<unsigned char>(c)) != 0; };
+
+	std::string decoded;
+	decoded.reserve(uri.size());
+	for (size_t i = 0; i < uri.size(); ++i) {
+		if (uri[i] == '%' && i + 2 < uri.size() && IsHexDigit(uri[i + 1]) && IsHexDigit(uri[i + 2])) {
+			decoded.push_back(static_cast<char>(std::stoi(uri.substr(i + 1, 2), nullptr, 16)));
+			i += 2;
+		} else {
+			decoded.push_back(uri[i]);
 		}
-		if (gltfMaterial.normalTexture.index >= 0) {
-			EnsureFormat(gltfMaterial.normalTexture.index, vk::Format::eR8G8B8A8Unorm);
+	}
+
+	return decoded;
+}
+
+// Identifies the contents of a file by its size and modification time, without reading it.
+static uint64_t GetFileStamp(const std::filesystem::path& path, uint64_t seed) {
+	std::error_code sizeError;
+	std::error_code timeError;
+	const uint64_t stamp[2] = {
+		static_cast<uint64_t>(std::filesystem::file_size(path, sizeError)),
+		static_cast<uint64_t>(std::filesystem::last_write_time(path, timeError).time_since_epoch().count())};
+
+	return AssetCache::Hash(stamp, sizeof(stamp), seed);
+}
+
+static bool IsExternalUri(const std::string& uri) {
+	return !uri.empty() && uri.rfind("data:", 0) != 0;
+}
+
+// Decodes the payload of a base64 data uri, e.g. "data:application/octet-stream;base64,AAAA".
+static bool DecodeDataUri(const std::string& uri, std::vector<uint8_t>& data) {
+	const size_t start = uri.find(";base64,");
+	if (uri.rfind("data:", 0) != 0 || start == std::string::npos) { return false; }
+
+	const auto GetSextet = [](char c) -> int {
+		if (c >= 'A' && c <= 'Z') { return c - 'A'; }
+		if (c >= 'a' && c <= 'z') { return c - 'a' + 26; }
+		if (c >= '0' && c <= '9') { return c - '0' + 52; }
+		if (c == '+') { return 62; }
+		if (c == '/') { return 63; }
+		return -1;
+	};
+
+	data.clear();
+	data.reserve((uri.size() - start) / 4 * 3);
+	uint32_t bits = 0;
+	int bitCount  = 0;
+	for (size_t i = start + 8; i < uri.size() && uri[i] != '='; ++i) {
+		const int sextet = GetSextet(uri[i]);
+		if (sextet < 0) { return false; }
+		bits = (bits << 6) | uint32_t(sextet);
+		bitCount += 6;
+		if (bitCount >= 8) {
+			bitCount -= 8;
+			data.push_back(static_cast<uint8_t>(bits >> bitCount));
 		}
-		if (gltfMaterial.pbrMetallicRoughness.metallicRoughnessTexture.index >= 0) {
-			EnsureFormat(gltfMaterial.pbrMetallicRoughness.metallicRoughnessTexture.index, vk::Format::eR8G8B8A8Unorm);
+	}
+
+	return true;
+}
+
+// Converts JSON into the generic value tinygltf keeps extensions as.
+static tinygltf::Value ToValue(const nlohmann::json& json) {
+	switch (json.type()) {
+		case nlohmann::json::value_t::boolean:
+			return tinygltf::Value(json.get<bool>());
+		case nlohmann::json::value_t::number_integer:
+		case nlohmann::json::value_t::number_unsigned:
+			return tinygltf::Value(json.get<int>());
+		case nlohmann::json::value_t::number_float:
+			return tinygltf::Value(json.get<double>());
+		case nlohmann::json::value_t::string:
+			return tinygltf::Value(json.get<std::string>());
+		case nlohmann::json::value_t::array: {
+			tinygltf::Value::Array array;
+			for (const auto& element : json) { array.push_back(ToValue(element)); }
+			return tinygltf::Value(std::move(array));
 		}
-		if (gltfMaterial.emissiveTexture.index >= 0) {
-			EnsureFormat(gltfMaterial.emissiveTexture.index, vk::Format::eR8G8B8A8Srgb);
+		case nlohmann::json::value_t::object: {
+			tinygltf::Value::Object object;
+			for (const auto& element : json.items()) { object.emplace(element.key(), ToValue(element.value())); }
+			return tinygltf::Value(std::move(object));
 		}
+		default:
+			return tinygltf::Value();
 	}
+}
 
-	std::vector<Vulkan::ImageHandle> images;
-	for (size_t i = 0; i < gltfModel.images.size(); ++i) {
-		const auto& gltfImage = gltfModel.images[i];
+// Returns the image a texture samples. Textures using KHR_texture_basisu name their KTX2 image in the extension, and
+// may name a fallback image as their regular source, which is ignored.
+static int GetTextureSource(const tinygltf::Texture& texture) {
+	const auto basisu = texture.extensions.find("KHR_texture_basisu");
+	if (basisu != texture.extensions.end() && basisu->second.Has("source")) {
+		return basisu->second.Get("source").GetNumberAsInt();
+	}
 
-		if (textureFormats[i] == vk::Format::eUndefined) {
-			// Image is unused in any materials.
-			images.push_back({});
+	return texture.source;
+}
+
+// The glTF extensions the loader implements. Files that require any other extension are rejected.
+static constexpr std::array<std::string_view, 3> SupportedExtensions = {
+	"EXT_mesh_gpu_instancing", "KHR_mesh_quantization", "KHR_texture_basisu"};
+
+// Fills in the parts of a tinygltf model that the loader uses from the JSON of a glTF file, which is only ever parsed
+// once. Nothing is read while parsing: buffers with data uris are decoded in place, while external buffers and images
+// keep their uri and are left empty, to be read by the loader in one batch. The BIN chunk of a .glb is the first
+// buffer, which has no uri, and is read in place from the mapped file. Throws if the JSON does not have the layout of a
+// glTF file, if any index in it is out of range, or if it relies on a feature the loader does not implement. Features
+// the loader can do without, such as occlusion textures, are reported in warnings and left out of the model.
+static void ParseModel(const nlohmann::json& document, tinygltf::Model& model, std::vector<std::string>& warnings) {
+	const auto Warn = [&](const std::string& warning) -> void {
+		if (std::find(warnings.begin(), warnings.end(), warning) == warnings.end()) { warnings.push_back(warning); }
+	};
+	const auto ForEach = [&](const nlohmann::json& parent, const char* name, const auto& function) -> void {
+		const auto it = parent.find(name);
+		if (it == parent.end()) { return; }
+		if (!it->is_array()) { throw std::runtime_error(std::string("'") + name + "' is not an array"); }
+		for (const auto& element : *it) { function(element); }
+	};
+	const auto GetTexture = [&](const nlohmann::json& parent, const char* name) -> int {
+		const auto it = parent.find(name);
+		if (it == parent.end()) { return -1; }
+		const int texCoord = it->value("texCoord", 0);
+		if (texCoord != 0) {
+			Warn(std::string(name) + " samples TEXCOORD_" + std::to_string(texCoord) +
+			     ", but only TEXCOORD_0 is supported and is used instead");
+		}
+		return it->at("index").get<int>();
+	};
+	const auto GetExtensions = [](const nlohmann::json& parent) -> tinygltf::ExtensionMap {
+		tinygltf::ExtensionMap extensions;
+		const auto it = parent.find("extensions");
+		if (it == parent.end()) { return extensions; }
+		for (const auto& extension : it->items()) { extensions.emplace(extension.key(), ToValue(extension.value())); }
+		return extensions;
+	};
+
+	model.extensionsUsed     = document.value("extensionsUsed", std::vector<std::string>{});
+	model.extensionsRequired = document.value("extensionsRequired", std::vector<std::string>{});
+	model.defaultScene       = document.value("scene", -1);
+	for (const auto& extension : model.extensionsUsed) {
+		if (std::find(SupportedExtensions.begin(), SupportedExtensions.end(), extension) != SupportedExtensions.end()) {
 			continue;
 		}
+		if (std::find(model.extensionsRequired.begin(), model.extensionsRequired.end(), extension) !=
+		    model.extensionsRequired.end()) {
+			throw std::runtime_error("required extension " + extension + " is not supported");
+		}
+		Warn("extension " + extension + " is not supported and is ignored");
+	}
 
-		bool loaded = false;
-		std::vector<uint8_t> bytes;
-		const auto uri = gltfImage.uri;
-		if (!uri.empty()) {
-			const std::filesystem::path imagePath = std::filesystem::path(gltfFolder) / uri;
-			const std::string imagePathStr        = imagePath.string();
-			const char* imagePathC                = imagePathStr.c_str();
-			try {
-				bytes = ReadFileBinary(imagePath);
-			} catch (const std::exception& e) {
-				Log::Error("GltfLoader", "Failed to load texture for {}, {}\n\t{}", gltfFile, uri, e.what());
-				images.push_back({});
-				continue;
+	ForEach(document, "buffers", [&](const nlohmann::json& json) {
+		auto& buffer = model.buffers.emplace_back();
+		buffer.uri   = json.value("uri", std::string{});
+		if (!IsExternalUri(buffer.uri) && !buffer.uri.empty() && !DecodeDataUri(buffer.uri, buffer.data)) {
+			throw std::runtime_error("buffer data uri is not base64");
+		}
+	});
+	ForEach(document, "bufferViews", [&](const nlohmann::json& json) {
+		auto& bufferView      = model.bufferViews.emplace_back();
+		bufferView.buffer     = json.at("buffer").get<int>();
+		bufferView.byteOffset = json.value("byteOffset", size_t(0));
+		bufferView.byteLength = json.at("byteLength").get<size_t>();
+		bufferView.byteStride = json.value("byteStride", size_t(0));
+	});
+	ForEach(document, "accessors", [&](const nlohmann::json& json) {
+		static const std::unordered_map<std::string, int> types = {{"SCALAR", TINYGLTF_TYPE_SCALAR},
+		                                                           {"VEC2", TINYGLTF_TYPE_VEC2},
+		                                                           {"VEC3", TINYGLTF_TYPE_VEC3},
+		                                                           {"VEC4", TINYGLTF_TYPE_VEC4},
+		                                                           {"MAT2", TINYGLTF_TYPE_MAT2},
+		                                                           {"MAT3", TINYGLTF_TYPE_MAT3},
+		                                                           {"MAT4", TINYGLTF_TYPE_MAT4}};
+		// Accessors without a bufferView are zero-filled and usually sparse, neither of which the loader reads.
+		if (json.contains("sparse")) { throw std::runtime_error("sparse accessors are not supported"); }
+		if (!json.contains("bufferView")) { throw std::runtime_error("accessors without a bufferView are not supported"); }
+		const auto type = types.find(json.at("type").get<std::string>());
+		if (type == types.end()) { throw std::runtime_error("accessor type is not valid"); }
+
+		auto& accessor         = model.accessors.emplace_back();
+		accessor.bufferView    = json.at("bufferView").get<int>();
+		accessor.byteOffset    = json.value("byteOffset", size_t(0));
+		accessor.componentType = json.at("componentType").get<int>();
+		accessor.count         = json.at("count").get<size_t>();
+		accessor.type          = type->second;
+		accessor.normalized    = json.value("normalized", false);
+		if (tinygltf::GetComponentSizeInBytes(accessor.componentType) < 0) {
+			throw std::runtime_error("accessor componentType is not valid");
+		}
+	});
+	ForEach(document, "meshes", [&](const nlohmann::json& json) {
+		auto& mesh = model.meshes.emplace_back();
+		mesh.name  = json.value("name", std::string{});
+		ForEach(json, "primitives", [&](const nlohmann::json& primitiveJson) {
+			auto& primitive      = mesh.primitives.emplace_back();
+			primitive.attributes = primitiveJson.at("attributes").get<std::map<std::string, int>>();
+			primitive.indices    = primitiveJson.value("indices", -1);
+			primitive.material   = primitiveJson.value("material", -1);
+			primitive.mode       = primitiveJson.value("mode", TINYGLTF_MODE_TRIANGLES);
+		});
+	});
+	ForEach(document, "nodes", [&](const nlohmann::json& json) {
+		auto& node       = model.nodes.emplace_back();
+		node.name        = json.value("name", std::string{});
+		node.mesh        = json.value("mesh", -1);
+		node.children    = json.value("children", std::vector<int>{});
+		node.matrix      = json.value("matrix", std::vector<double>{});
+		node.translation = json.value("translation", std::vector<double>{});
+		node.rotation    = json.value("rotation", std::vector<double>{});
+		node.scale       = json.value("scale", std::vector<double>{});
+		node.extensions  = GetExtensions(json);
+	});
+	ForEach(document, "scenes", [&](const nlohmann::json& json) {
+		model.scenes.emplace_back().nodes = json.value("nodes", std::vector<int>{});
+	});
+	ForEach(document, "materials", [&](const nlohmann::json& json) {
+		auto& material = model.materials.emplace_back();
+		material.name  = json.value("name", std::string{});
+
+		auto& pbr          = material.pbrMetallicRoughness;
+		const auto pbrJson = json.value("pbrMetallicRoughness", nlohmann::json::object());
+		pbr.baseColorFactor                = pbrJson.value("baseColorFactor", std::vector<double>{1.0, 1.0, 1.0, 1.0});
+		pbr.baseColorTexture.index         = GetTexture(pbrJson, "baseColorTexture");
+		pbr.metallicFactor                 = pbrJson.value("metallicFactor", 1.0);
+		pbr.roughnessFactor                = pbrJson.value("roughnessFactor", 1.0);
+		pbr.metallicRoughnessTexture.index = GetTexture(pbrJson, "metallicRoughnessTexture");
+
+		material.normalTexture.index   = GetTexture(json, "normalTexture");
+		material.emissiveTexture.index = GetTexture(json, "emissiveTexture");
+		if (json.contains("occlusionTexture")) { Warn("occlusionTexture is not supported and is ignored"); }
+		material.emissiveFactor        = json.value("emissiveFactor", std::vector<double>{0.0, 0.0, 0.0});
+		material.alphaMode             = json.value("alphaMode", std::string("OPAQUE"));
+		material.alphaCutoff           = json.value("alphaCutoff", 0.5);
+		material.doubleSided           = json.value("doubleSided", false);
+	});
+	ForEach(document, "textures", [&](const nlohmann::json& json) {
+		auto& texture      = model.textures.emplace_back();
+		texture.sampler    = json.value("sampler", -1);
+		texture.source     = json.value("source", -1);
+		texture.extensions = GetExtensions(json);
+	});
+	ForEach(document, "images", [&](const nlohmann::json& json) {
+		auto& image      = model.images.emplace_back();
+		image.name       = json.value("name", std::string{});
+		image.uri        = json.value("uri", std::string{});
+		image.mimeType   = json.value("mimeType", std::string{});
+		image.bufferView = json.value("bufferView", -1);
+	});
+	ForEach(document, "samplers", [&](const nlohmann::json& json) {
+		auto& sampler     = model.samplers.emplace_back();
+		sampler.minFilter = json.value("minFilter", -1);
+		sampler.magFilter = json.value("magFilter", -1);
+		sampler.wrapS     = json.value("wrapS", TINYGLTF_TEXTURE_WRAP_REPEAT);
+		sampler.wrapT     = json.value("wrapT", TINYGLTF_TEXTURE_WRAP_REPEAT);
+	});
+
+	// Every index is checked here once, so that the loader can use them without checking again. Optional indices are -1
+	// when absent.
+	const auto CheckIndex = [](int index, size_t count, const char* name, bool required) -> void {
+		if (index < (required ? 0 : -1) || index >= int(count)) {
+			throw std::runtime_error(std::string(name) + " index out of range");
+		}
+	};
+	for (const auto& view : model.bufferViews) { CheckIndex(view.buffer, model.buffers.size(), "buffer", true); }
+	for (const auto& accessor : model.accessors) {
+		CheckIndex(accessor.bufferView, model.bufferViews.size(), "bufferView", true);
+
+		// The last element has to end within the bufferView, which is checked against its buffer once that is read.
+		const auto& view         = model.bufferViews[accessor.bufferView];
+		const size_t elementSize = size_t(tinygltf::GetComponentSizeInBytes(accessor.componentType)) *
+		                           size_t(tinygltf::GetNumComponentsInType(accessor.type));
+		const size_t stride = view.byteStride != 0 ? view.byteStride : elementSize;
+		if (accessor.count > 0 &&
+		    (accessor.byteOffset > view.byteLength || accessor.count - 1 > view.byteLength / stride ||
+		     stride * (accessor.count - 1) + elementSize > view.byteLength - accessor.byteOffset)) {
+			throw std::runtime_error("accessor extends past the end of its bufferView");
+		}
+	}
+	for (const auto& mesh : model.meshes) {
+		for (const auto& primitive : mesh.primitives) {
+			for (const auto& [name, accessor] : primitive.attributes) {
+				CheckIndex(accessor, model.accessors.size(), "accessor", true);
 			}
+			CheckIndex(primitive.indices, model.accessors.size(), "accessor", false);
+			CheckIndex(primitive.material, model.materials.size(), "material", false);
+		}
+	}
+	for (const auto& material : model.materials) {
+		for (const int texture : {material.pbrMetallicRoughness.baseColorTexture.index,
+		                          material.pbrMetallicRoughness.metallicRoughnessTexture.index,
+		                          material.normalTexture.index,
+		                          material.emissiveTexture.index}) {
+			CheckIndex(texture, model.textures.size(), "texture", false);
+		}
+	}
+	for (const auto& texture : model.textures) {
+		CheckIndex(texture.sampler, model.samplers.size(), "sampler", false);
+		CheckIndex(texture.source, model.images.size(), "image", false);
+		CheckIndex(GetTextureSource(texture), model.images.size(), "image", false);
+	}
+	for (const auto& image : model.images) {
+		CheckIndex(image.bufferView, model.bufferViews.size(), "bufferView", false);
+	}
 
-			loaded = true;
+	// Nodes form trees below the root nodes of each scene, which is what lets the loader walk them without looking out
+	// for cycles: no node has more than one parent, and root nodes have none.
+	std::vector<int> parentCounts(model.nodes.size(), 0);
+	for (const auto& node : model.nodes) {
+		CheckIndex(node.mesh, model.meshes.size(), "mesh", false);
+		for (const int child : node.children) {
+			CheckIndex(child, model.nodes.size(), "node", true);
+			if (++parentCounts[child] > 1) { throw std::runtime_error("node has more than one parent"); }
+		}
+	}
+	for (const auto& scene : model.scenes) {
+		for (const int root : scene.nodes) {
+			CheckIndex(root, model.nodes.size(), "node", true);
+			if (parentCounts[root] > 0) { throw std::runtime_error("scene root node has a parent"); }
 		}
-		const int bufferView = gltfImage.bufferView;
-		if (bufferView >= 0) {
-			const tinygltf::BufferView& gltfBufferView = gltfModel.bufferViews[bufferView];
-			const tinygltf::Buffer& gltfBuffer         = gltfModel.buffers[gltfBufferView.buffer];
-			const uint8_t* data                        = gltfBuffer.data.data() + gltfBufferView.byteOffset;
-			const size_t dataSize                      = gltfBufferView.byteLength;
-			bytes.resize(dataSize);
-			memcpy(bytes.data(), data, dataSize);
+	}
+
+	// Files that do not name a scene to show get their first one, if they have any.
+	if (model.defaultScene < 0 && !model.scenes.empty()) { model.defaultScene = 0; }
+	CheckIndex(model.defaultScene, model.scenes.size(), "scene", false);
+}
+
+// The contents of each glTF buffer. Buffers with data uris alias their decoded copies, while the BIN chunk of a .glb is
+// read in place from the mapped file and external buffers are read by the loader.
+using BufferData = std::vector<std::span<const uint8_t>>;
+
+// Describes where the elements of a glTF accessor live in memory and how they are encoded.
+struct AttributeSource {
+	const uint8_t* Data = nullptr;
+	size_t Stride       = 0;
+	int Type            = 0;
+	int ComponentType   = 0;
+	bool Normalized     = false;
+
+	bool SameEncoding(const AttributeSource& other) const {
+		return Type == other.Type && ComponentType == other.ComponentType && Normalized == other.Normalized;
+	}
+};
+
+static AttributeSource GetAttributeSource(const tinygltf::Model& model,
+                                          const BufferData& buffers,
+                                          const tinygltf::Accessor& accessor) {
+	const auto& gltfBufferView = model.bufferViews[accessor.bufferView];
+	const auto& gltfBuffer     = buffers[gltfBufferView.buffer];
+
+	return AttributeSource{.Data          = gltfBuffer.data() + accessor.byteOffset + gltfBufferView.byteOffset,
+	                       .Stride        = static_cast<size_t>(accessor.ByteStride(gltfBufferView)),
+	                       .Type          = accessor.type,
+	                       .ComponentType = accessor.componentType,
+	                       .Normalized    = accessor.normalized};
+}
 
-			loaded = true;
+// Reads a single element of an attribute as floats, applying the glTF normalization rules for integer data.
+static glm::vec4 ReadAttribute(const AttributeSource& source, size_t index) {
+	const uint8_t* element   = source.Data + index * source.Stride;
+	const int componentCount = tinygltf::GetNumComponentsInType(source.Type);
+
+	glm::vec4 value(0.0f);
+	for (int c = 0; c < componentCount && c < 4; ++c) {
+		switch (source.ComponentType) {
+			case TINYGLTF_COMPONENT_TYPE_BYTE: {
+				const float v = static_cast<float>(reinterpret_cast<const int8_t*>(element)[c]);
+				value[c]      = source.Normalized ? std::max(v / 127.0f, -1.0f) : v;
+			} break;
+			case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE: {
+				const float v = static_cast<float>(element[c]);
+				value[c]      = source.Normalized ? v / 255.0f : v;
+			} break;
+			case TINYGLTF_COMPONENT_TYPE_SHORT: {
+				int16_t raw;
+				memcpy(&raw, element + c * sizeof(int16_t), sizeof(int16_t));
+				value[c] = source.Normalized ? std::max(raw / 32767.0f, -1.0f) : static_cast<float>(raw);
+			} break;
+			case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: {
+				uint16_t raw;
+				memcpy(&raw, element + c * sizeof(uint16_t), sizeof(uint16_t));
+				value[c] = source.Normalized ? raw / 65535.0f : static_cast<float>(raw);
+			} break;
+			case TINYGLTF_COMPONENT_TYPE_FLOAT:
+				memcpy(&value[c], element + c * sizeof(float), sizeof(float));
+				break;
 		}
-		if (!loaded) {
-			Log::Error("GltfLoader", "Failed to find data source for texture for {}, image '{}'!", gltfFile, gltfImage.name);
-			images.push_back({});
-			continue;
+	}
+
+	return value;
+}
+
+// Reads the TRANSLATION, ROTATION and SCALE instance attributes of an EXT_mesh_gpu_instancing node into one transform
+// per instance. Missing attributes take their identity value.
+static std::vector<glm::mat4> ReadInstanceTransforms(const tinygltf::Model& model,
+                                                     const BufferData& buffers,
+                                                     const tinygltf::Value& extension) {
+	const auto& attributes = extension.Get("attributes");
+	if (!attributes.IsObject()) { return {}; }
+
+	size_t instanceCount = std::numeric_limits<size_t>::max();
+	const auto GetSource = [&](const char* name) -> AttributeSource {
+		if (!attributes.Has(name)) { return {}; }
+		const int accessorIndex = attributes.Get(name).GetNumberAsInt();
+		if (accessorIndex < 0 || accessorIndex >= model.accessors.size()) { return {}; }
+		const auto& accessor = model.accessors[accessorIndex];
+		instanceCount        = std::min(instanceCount, accessor.count);
+
+		return GetAttributeSource(model, buffers, accessor);
+	};
+	const auto translations = GetSource("TRANSLATION");
+	const auto rotations    = GetSource("ROTATION");
+	const auto scales       = GetSource("SCALE");
+	if (instanceCount == std::numeric_limits<size_t>::max()) { return {}; }
+
+	std::vector<glm::mat4> transforms(instanceCount);
+	for (size_t i = 0; i < instanceCount; ++i) {
+		const glm::vec3 translation = translations.Data ? glm::vec3(ReadAttribute(translations, i)) : glm::vec3(0.0f);
+		const glm::vec4 rotation    = rotations.Data ? ReadAttribute(rotations, i) : glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+		const glm::vec3 scale       = scales.Data ? glm::vec3(ReadAttribute(scales, i)) : glm::vec3(1.0f);
+
+		transforms[i] = glm::translate(glm::mat4(1.0f), translation) *
+		                glm::mat4_cast(glm::quat(rotation.w, rotation.x, rotation.y, rotation.z)) *
+		                glm::scale(glm::mat4(1.0f), scale);
+	}
+
+	return transforms;
+}
+
+// Returns the vertex stream that can hold an attribute in its original encoding. 3-component integer data is widened
+// to 4 components, since 4-component formats are more widely supported for vertex fetch and glTF already pads them.
+// Support for the scaled formats used by non-normalized data is optional, so callers check it with the device.
+static VertexStream GetNativeStream(const AttributeSource& source) {
+	const int componentCount = tinygltf::GetNumComponentsInType(source.Type);
+	const bool wide          = componentCount > 2;
+	const bool norm          = source.Normalized;
+
+	VertexStream stream{.Format = vk::Format::eUndefined, .Stride = 0};
+	switch (source.ComponentType) {
+		case TINYGLTF_COMPONENT_TYPE_BYTE:
+			if (wide) {
+				stream = {norm ? vk::Format::eR8G8B8A8Snorm : vk::Format::eR8G8B8A8Sscaled, 4};
+			} else {
+				stream = {norm ? vk::Format::eR8G8Snorm : vk::Format::eR8G8Sscaled, 4};
+			}
+			break;
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+			if (wide) {
+				stream = {norm ? vk::Format::eR8G8B8A8Unorm : vk::Format::eR8G8B8A8Uscaled, 4};
+			} else {
+				stream = {norm ? vk::Format::eR8G8Unorm : vk::Format::eR8G8Uscaled, 4};
+			}
+			break;
+		case TINYGLTF_COMPONENT_TYPE_SHORT:
+			if (wide) {
+				stream = {norm ? vk::Format::eR16G16B16A16Snorm : vk::Format::eR16G16B16A16Sscaled, 8};
+			} else {
+				stream = {norm ? vk::Format::eR16G16Snorm : vk::Format::eR16G16Sscaled, 4};
+			}
+			break;
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+			if (wide) {
+				stream = {norm ? vk::Format::eR16G16B16A16Unorm : vk::Format::eR16G16B16A16Uscaled, 8};
+			} else {
+				stream = {norm ? vk::Format::eR16G16Unorm : vk::Format::eR16G16Uscaled, 4};
+			}
+			break;
+	}
+
+	return stream;
+}
+
+static bool SupportsVertexFormat(const vk::PhysicalDevice& gpu, vk::Format format) {
+	return bool(gpu.getFormatProperties(format).bufferFeatures & vk::FormatFeatureFlagBits::eVertexBuffer);
+}
+
+// Returns a bit for each optional format GetNativeStream may choose that the device can fetch vertices from.
+static uint32_t GetVertexFormatSupport(const vk::PhysicalDevice& gpu) {
+	constexpr std::array<vk::Format, 8> scaledFormats = {vk::Format::eR8G8Sscaled,
+	                                                     vk::Format::eR8G8B8A8Sscaled,
+	                                                     vk::Format::eR8G8Uscaled,
+	                                                     vk::Format::eR8G8B8A8Uscaled,
+	                                                     vk::Format::eR16G16Sscaled,
+	                                                     vk::Format::eR16G16B16A16Sscaled,
+	                                                     vk::Format::eR16G16Uscaled,
+	                                                     vk::Format::eR16G16B16A16Uscaled};
+	uint32_t support = 0;
+	for (size_t i = 0; i < scaledFormats.size(); ++i) {
+		if (SupportsVertexFormat(gpu, scaledFormats[i])) { support |= 1u << i; }
+	}
+
+	return support;
+}
+
+// Maps a unit vector onto the [-1, 1] square of an octahedron unfolded around the Z axis.
+static glm::vec2 OctahedralEncode(const glm::vec3& v) {
+	const float l1 = std::abs(v.x) + std::abs(v.y) + std::abs(v.z);
+	if (l1 <= 0.0f) { return glm::vec2(0.0f); }
+
+	glm::vec2 p = glm::vec2(v.x, v.y) / l1;
+	if (v.z < 0.0f) {
+		const glm::vec2 signs(p.x >= 0.0f ? 1.0f : -1.0f, p.y >= 0.0f ? 1.0f : -1.0f);
+		p = (1.0f - glm::abs(glm::vec2(p.y, p.x))) * signs;
+	}
+
+	return p;
+}
+
+static int16_t PackSnorm16(float value) {
+	return static_cast<int16_t>(std::round(glm::clamp(value, -1.0f, 1.0f) * 32767.0f));
+}
+
+// Creates an entity under root for every node of the model, each of which keeps the model resident.
+static void InstantiateModel(const std::shared_ptr<const LoadedModel>& model, Scene& scene, Entity root) {
+	std::function<void(uint32_t, Luna::Entity&)> AddNode = [&](uint32_t nodeIndex, Luna::Entity& parentEntity) {
+		const auto& node = model->Nodes[nodeIndex];
+		auto entity      = scene.CreateChildEntity(parentEntity, node.Name);
+		auto& transform  = entity.Transform();
+
+		transform.Translation = node.Translation;
+		transform.Rotation    = node.Rotation;
+		transform.Scale       = node.Scale;
+		entity.AddComponent<ModelComponent>().Model = model;
+
+		if (node.Mesh >= 0) {
+			const auto& mesh = model->Meshes[node.Mesh];
+			auto& cMesh      = entity.AddComponent<MeshComponent>();
+			cMesh.Bounds     = mesh->Bounds;
+			cMesh.Mesh       = mesh;
+
+			entity.AddComponent<MeshInfoComponent>().Info = model->MeshInfos[node.Mesh];
+
+			// Instanced nodes keep a single entity, with bounds grown to cover every instance.
+			if (node.Instances) {
+				for (size_t instance = 0; instance < node.Instances->size(); ++instance) {
+					auto instanceBounds = mesh->Bounds;
+					instanceBounds.Transform((*node.Instances)[instance]);
+					if (instance == 0) {
+						cMesh.Bounds = instanceBounds;
+					} else {
+						cMesh.Bounds.Contain(instanceBounds);
+					}
+				}
+				entity.AddComponent<InstancesComponent>().Transforms = node.Instances;
+			}
 		}
 
-		int width, height, components;
-		stbi_set_flip_vertically_on_load(0);
-		stbi_uc* pixels = stbi_load_from_memory(bytes.data(), bytes.size(), &width, &height, &components, STBI_rgb_alpha);
-		if (pixels == nullptr) {
-			Log::Error("AssetManager", "Failed to read texture data for {}, {}: {}", gltfFile, uri, stbi_failure_reason());
-			images.push_back({});
-			continue;
+		for (auto child : node.Children) { AddNode(child, entity); }
+	};
+	for (auto nodeIndex : model->RootNodes) { AddNode(nodeIndex, root); }
+}
+
+GltfLoader::GltfLoader(Luna::Vulkan::WSI& wsi,
+                       ThreadPool& threadPool,
+                       GeometryPool& geometryPool,
+                       UploadManager& uploads,
+                       AssetRegistry& registry) {
+	_wsi          = &wsi;
+	_threadPool   = &threadPool;
+	_geometryPool = &geometryPool;
+	_uploads      = &uploads;
+	_registry     = &registry;
+	_fileReader   = std::make_unique<AsyncFileReader>(threadPool);
+	Log::Info("GltfLoader",
+	          "Reading external glTF files through {}.",
+	          _fileReader->IsUsingIoUring() ? "io_uring" : "the thread pool");
+}
+
+GltfLoader::~GltfLoader() noexcept {
+	// Loads still in flight may be waiting on the main thread, so keep running their tasks until every one has finished.
+	while (!_asyncLoads.empty()) {
+		Update();
+		std::this_thread::yield();
+	}
+	_fileReader.reset();
+	_wsi          = nullptr;
+	_threadPool   = nullptr;
+	_geometryPool = nullptr;
+	_uploads      = nullptr;
+	_registry     = nullptr;
+}
+
+float GltfLoadProgress::GetFraction() const {
+	if (Finished) { return 1.0f; }
+
+	const uint32_t textureCount = TextureCount;
+	const float textureFraction = textureCount > 0 ? float(TexturesLoaded) / float(textureCount) : 0.0f;
+
+	return (GeometryLoaded ? 0.5f : 0.0f) + textureFraction * 0.5f;
+}
+
+Entity GltfLoader::Load(const std::filesystem::path& meshAssetPath, Scene& scene, const GltfLoadOptions& options) {
+	auto progress  = std::make_shared<GltfLoadProgress>();
+	progress->Name = meshAssetPath.filename().string();
+	auto root      = scene.CreateEntity(progress->Name);
+	if (!LoadGltf(meshAssetPath, scene, root, options, progress, false)) {
+		progress->Failed   = true;
+		progress->Finished = true;
+	}
+
+	return root;
+}
+
+GltfAsyncLoad GltfLoader::LoadAsync(const std::filesystem::path& meshAssetPath,
+                                    Scene& scene,
+                                    const GltfLoadOptions& options) {
+	auto progress  = std::make_shared<GltfLoadProgress>();
+	progress->Name = meshAssetPath.filename().string();
+	auto root      = scene.CreateEntity(progress->Name);
+
+	// The worker spends most of its time waiting on thread pool jobs, so it gets a thread of its own rather than taking
+	// one from the pool.
+	_asyncLoads.push_back(std::async(std::launch::async, [this, meshAssetPath, &scene, root, options, progress]() {
+		if (!LoadGltf(meshAssetPath, scene, root, options, progress, true)) {
+			progress->Failed   = true;
+			progress->Finished = true;
 		}
+	}));
+
+	return GltfAsyncLoad{.Root = root, .Progress = progress};
+}
 
-		const Vulkan::ImageInitialData initialData{.Data = pixels};
-		const auto imageCI = Vulkan::ImageCreateInfo::Immutable2D(width, height, textureFormats[i], true);
-		images.push_back(_wsi->GetDevice().CreateImage(imageCI, &initialData));
+void GltfLoader::Update() {
+	const auto updateStart = std::chrono::steady_clock::now();
+	while (true) {
+		std::function<void()> task;
+		{
+			std::lock_guard<std::mutex> lock(_mainThreadMutex);
+			if (_mainThreadTasks.empty()) { break; }
+			task = std::move(_mainThreadTasks.front());
+			_mainThreadTasks.pop_front();
+		}
+		task();
+
+		const std::chrono::duration<double, std::milli> updateTime = std::chrono::steady_clock::now() - updateStart;
+		if (updateTime.count() >= MainThreadBudgetMs) { break; }
 	}
 
-	const bool quantized =
-		std::find(gltfModel.extensionsRequired.begin(), gltfModel.extensionsRequired.end(), "KHR_mesh_quantization") !=
-		gltfModel.extensionsRequired.end();
-	if (quantized) { Log::Info("GltfLoader", "{} uses KHR_mesh_quantization.", gltfFile); }
+	std::erase_if(_asyncLoads, [](const std::future<void>& load) {
+		return load.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+	});
+}
 
-	std::vector<Vulkan::Sampler*> samplers;
-	for (size_t i = 0; i < gltfModel.samplers.size(); ++i) {
-		const auto& gltfSampler = gltfModel.samplers[i];
+void GltfLoader::RunOnMainThread(bool async, std::function<void()>&& task) {
+	if (!async) {
+		task();
+		return;
+	}
 
-		const auto& gpuInfo    = _wsi->GetDevice().GetGPUInfo();
-		const float anisotropy = gpuInfo.EnabledFeatures.Features.samplerAnisotropy
-		                           ? gpuInfo.Properties.Properties.limits.maxSamplerAnisotropy
-		                           : 0.0f;
+	std::lock_guard<std::mutex> lock(_mainThreadMutex);
+	_mainThreadTasks.push_back(std::move(task));
+}
 
-		Vulkan::SamplerCreateInfo samplerCI{
-			.AnisotropyEnable = anisotropy > 0.0f, .MaxAnisotropy = anisotropy, .MaxLod = 11.0f};
-		switch (gltfSampler.magFilter) {
-			case 9728:  // NEAREST
-				samplerCI.MagFilter = vk::Filter::eNearest;
-				break;
-			case 9729:  // LINEAR
-				samplerCI.MagFilter = vk::Filter::eLinear;
-				break;
+void GltfLoader::RunOnMainThreadAndWait(bool async, std::function<void()>&& task) {
+	if (!async) {
+		task();
+		return;
+	}
+
+	auto packagedTask = std::make_shared<std::packaged_task<void()>>(std::move(task));
+	auto done         = packagedTask->get_future();
+	RunOnMainThread(async, [packagedTask]() { (*packagedTask)(); });
+	done.get();
+}
+
+bool GltfLoader::LoadGltf(const std::filesystem::path& meshAssetPath,
+                          Scene& scene,
+                          Entity root,
+                          const GltfLoadOptions& options,
+                          const std::shared_ptr<GltfLoadProgress>& progress,
+                          bool async) {
+	const auto gltfPath     = meshAssetPath;
+	const auto gltfFile     = gltfPath.string();
+	const auto gltfFolder   = gltfPath.parent_path().string();
+	const auto gltfFileName = gltfPath.filename().string();
+
+	const auto loadStart = std::chrono::steady_clock::now();
+
+	const auto gltfExt = gltfPath.extension().string();
+	if (gltfExt != ".gltf" && gltfExt != ".glb") {
+		Log::Error("GltfLoader", "Mesh asset file {} is not supported!", gltfFile);
+		return false;
+	}
+
+	// The file is mapped rather than read. The BIN chunk of a .glb is read in place for as long as the load takes, so
+	// vertex data and embedded images are never copied out of the file before they are processed.
+	MappedFile gltfMapping(gltfPath);
+	if (!gltfMapping.IsValid()) {
+		Log::Error("GltfLoader", "Failed to open mesh asset file {}.", gltfFile);
+		return false;
+	}
+
+	std::string_view gltfJson;
+	std::span<const uint8_t> glbBin;
+	if (gltfExt == ".glb") {
+		if (!SplitGlb(gltfMapping.GetData(), gltfMapping.GetSize(), gltfJson, glbBin)) {
+			Log::Error("GltfLoader", "Mesh asset file {} is not a valid binary glTF file.", gltfFile);
+			return false;
 		}
-		switch (gltfSampler.minFilter) {
-			case 9728:  // NEAREST
-				samplerCI.MinFilter = vk::Filter::eNearest;
-				break;
-			case 9729:  // LINEAR
-				samplerCI.MinFilter = vk::Filter::eLinear;
-				break;
-			case 9984:  // NEAREST_MIPMAP_NEAREST
-				samplerCI.MinFilter  = vk::Filter::eNearest;
-				samplerCI.MipmapMode = vk::SamplerMipmapMode::eNearest;
-				break;
-			case 9985:  // LINEAR_MIPMAP_NEAREST
-				samplerCI.MinFilter  = vk::Filter::eLinear;
-				samplerCI.MipmapMode = vk::SamplerMipmapMode::eNearest;
-				break;
-			case 9986:  // NEAREST_MIPMAP_LINEAR
-				samplerCI.MinFilter  = vk::Filter::eNearest;
-				samplerCI.MipmapMode = vk::SamplerMipmapMode::eLinear;
-				break;
-			case 9987:  // LINEAR_MIPMAP_LINEAR
-				samplerCI.MinFilter  = vk::Filter::eLinear;
-				samplerCI.MipmapMode = vk::SamplerMipmapMode::eLinear;
-				break;
+	} else {
+		gltfJson = std::string_view(reinterpret_cast<const char*>(gltfMapping.GetData()), gltfMapping.GetSize());
+	}
+
+	// A file that is already resident with the same contents is placed again rather than loaded again. Only the JSON is
+	// hashed, along with the size and modification time of the file, so the BIN chunk of a .glb is never read here and
+	// external files changed while the model is resident are not picked up.
+	const uint64_t contentHash =
+		AssetCache::Hash(gltfJson.data(), gltfJson.size(), GetFileStamp(gltfPath, options.CompactVertices ? 1 : 0));
+	if (auto residentModel = _registry->FindModel(gltfPath, contentHash)) {
+		RunOnMainThreadAndWait(async, [&]() -> void { InstantiateModel(residentModel, scene, root); });
+		progress->GeometryLoaded = true;
+		progress->Finished       = true;
+
+		const std::chrono::duration<double, std::milli> loadTime = std::chrono::steady_clock::now() - loadStart;
+		Log::Info("GltfLoader", "Placed resident {} in {:.2f}ms.", gltfFileName, loadTime.count());
+		return true;
+	}
+
+	// The JSON is parsed once, straight into the model, and the files it references are read by the loader afterwards.
+	tinygltf::Model gltfModel;
+	{
+		const auto document = nlohmann::json::parse(gltfJson.begin(), gltfJson.end(), nullptr, false);
+		if (document.is_discarded() || !document.is_object()) {
+			Log::Error("GltfLoader", "Mesh asset file {} does not contain valid JSON.", gltfFile);
+			return false;
 		}
-		switch (gltfSampler.wrapS) {
-			case 33071:  // CLAMP_TO_EDGE
-				samplerCI.AddressModeU = vk::SamplerAddressMode::eClampToEdge;
-				break;
-			case 33648:  // MIRRORED_REPEAT
-				samplerCI.AddressModeU = vk::SamplerAddressMode::eMirroredRepeat;
-				break;
-			case 10497:  // REPEAT
-				samplerCI.AddressModeU = vk::SamplerAddressMode::eRepeat;
-				break;
+		std::vector<std::string> warnings;
+		try {
+			ParseModel(document, gltfModel, warnings);
+		} catch (const std::exception& e) {
+			Log::Error("GltfLoader", "Mesh asset file {} is not a valid glTF file: {}", gltfFile, e.what());
+			return false;
 		}
-		switch (gltfSampler.wrapT) {
-			case 33071:  // CLAMP_TO_EDGE
-				samplerCI.AddressModeV = vk::SamplerAddressMode::eClampToEdge;
-				break;
-			case 33648:  // MIRRORED_REPEAT
-				samplerCI.AddressModeV = vk::SamplerAddressMode::eMirroredRepeat;
-				break;
-			case 10497:  // REPEAT
-				samplerCI.AddressModeV = vk::SamplerAddressMode::eRepeat;
-				break;
+		for (const auto& warning : warnings) {
+			Log::Warning("GltfLoader", "Warning loading mesh asset {}: {}", gltfFile, warning);
+		}
+	}
+	const bool glbBuffer = !glbBin.empty() && !gltfModel.buffers.empty() && gltfModel.buffers[0].uri.empty();
+	for (size_t i = glbBuffer ? 1 : 0; i < gltfModel.buffers.size(); ++i) {
+		if (gltfModel.buffers[i].uri.empty()) {
+			Log::Error("GltfLoader", "Mesh asset file {} has a buffer without data.", gltfFile);
+			return false;
+		}
+	}
+
+	// Cooked geometry is found by the path of the file, and is only used if the JSON and the size and modification time
+	// of every file it came from are unchanged, so that checking it never reads the buffers. The vertex formats the
+	// device supports decide which streams keep their encoding, so they are part of the key too.
+	const vk::PhysicalDevice gpu = _wsi->GetDevice().GetGPU();
+	const uint64_t meshOptions   = (uint64_t(GetVertexFormatSupport(gpu)) << 1) | (options.CompactVertices ? 1 : 0);
+	const auto meshCacheKey      = AssetCache::Hash(gltfFile.data(), gltfFile.size(), meshOptions);
+	const auto meshCachePath     = AssetCache::GetPath("Meshes", meshCacheKey, ".mesh");
+
+	uint64_t sourceHash = AssetCache::Hash(gltfJson.data(), gltfJson.size(), GetFileStamp(gltfPath, MeshCacheVersion));
+	for (const auto& buffer : gltfModel.buffers) {
+		if (!IsExternalUri(buffer.uri)) { continue; }
+		sourceHash = GetFileStamp(std::filesystem::path(gltfFolder) / DecodeUri(buffer.uri), sourceHash);
+	}
+	std::vector<uint8_t> meshCacheData;
+	std::vector<CookedMesh> cookedMeshes;
+	const bool meshCached =
+		AssetCache::Read(meshCachePath, meshCacheData) && ReadMeshCache(meshCacheData, sourceHash, cookedMeshes);
+
+	// Buffers are only read for what is not cooked, which is every buffer unless the geometry is. Otherwise only images
+	// stored in buffers and the transforms of instanced nodes still need them.
+	std::vector<bool> neededBuffers(gltfModel.buffers.size(), !meshCached);
+	const auto NeedBufferView = [&](int bufferView) -> void {
+		if (bufferView >= 0) { neededBuffers[gltfModel.bufferViews[bufferView].buffer] = true; }
+	};
+	for (const auto& image : gltfModel.images) { NeedBufferView(image.bufferView); }
+	for (const auto& node : gltfModel.nodes) {
+		const auto instancing = node.extensions.find("EXT_mesh_gpu_instancing");
+		if (instancing == node.extensions.end() || !instancing->second.IsObject()) { continue; }
+		const auto& attributes = instancing->second.Get("attributes");
+		if (!attributes.IsObject()) { continue; }
+		for (const auto& name : attributes.Keys()) {
+			const int accessor = attributes.Get(name).GetNumberAsInt();
+			if (accessor >= 0 && accessor < gltfModel.accessors.size()) {
+				NeedBufferView(gltfModel.accessors[accessor].bufferView);
+			}
 		}
-		samplers.push_back(_wsi->GetDevice().RequestSampler(samplerCI));
 	}
 
-	std::vector<TextureHandle> textures;
-	for (size_t i = 0; i < gltfModel.textures.size(); ++i) {
-		const auto& gltfTexture = gltfModel.textures[i];
+	// Every external buffer and image is read in one batch. Buffers are needed before anything else can happen, but
+	// images that finish reading before the materials have been scanned are parked until then, and the rest are decoded
+	// as soon as they arrive.
+	std::vector<std::filesystem::path> externalPaths;
+	std::vector<size_t> externalBuffers;
+	std::vector<size_t> externalImages;
+	for (size_t i = 0; i < gltfModel.buffers.size(); ++i) {
+		if (!IsExternalUri(gltfModel.buffers[i].uri) || !neededBuffers[i]) { continue; }
+		externalPaths.push_back(std::filesystem::path(gltfFolder) / DecodeUri(gltfModel.buffers[i].uri));
+		externalBuffers.push_back(i);
+	}
+	for (size_t i = 0; i < gltfModel.images.size(); ++i) {
+		if (!IsExternalUri(gltfModel.images[i].uri)) { continue; }
+		externalPaths.push_back(std::filesystem::path(gltfFolder) / DecodeUri(gltfModel.images[i].uri));
+		externalImages.push_back(i);
+	}
+
+	using ImageRead = std::tuple<size_t, std::vector<uint8_t>, std::exception_ptr>;
+	std::vector<std::promise<std::vector<uint8_t>>> bufferReads(externalBuffers.size());
+	std::mutex imageReadMutex;
+	std::vector<ImageRead> parkedImageReads;
+	std::function<void(size_t, std::vector<uint8_t>&&, std::exception_ptr)> decodeImageRead;
+	auto externalReads = _fileReader->ReadFiles(
+		externalPaths, [&](size_t file, std::vector<uint8_t>&& data, std::exception_ptr error) -> void {
+			if (file < bufferReads.size()) {
+				if (error) {
+					bufferReads[file].set_exception(error);
+				} else {
+					bufferReads[file].set_value(std::move(data));
+				}
+				return;
+			}
+
+			const size_t image = externalImages[file - bufferReads.size()];
+			std::unique_lock<std::mutex> lock(imageReadMutex);
+			if (!decodeImageRead) {
+				parkedImageReads.emplace_back(image, std::move(data), error);
+				return;
+			}
+			lock.unlock();
+			decodeImageRead(image, std::move(data), error);
+		});
+
+	std::vector<std::vector<uint8_t>> bufferFiles(bufferReads.size());
+	for (size_t i = 0; i < bufferReads.size(); ++i) {
+		try {
+			bufferFiles[i] = bufferReads[i].get_future().get();
+		} catch (const std::exception& e) {
+			const auto& uri = gltfModel.buffers[externalBuffers[i]].uri;
+			Log::Error("GltfLoader", "Failed to load buffer for {}, {}\n\t{}", gltfFile, uri, e.what());
+			return false;
+		}
+	}
 
-		auto& image              = images[gltfTexture.source];
-		Vulkan::Sampler* sampler = gltfTexture.sampler >= 0
-		                             ? samplers[gltfTexture.sampler]
-		                             : _wsi->GetDevice().RequestSampler(Vulkan::StockSampler::DefaultGeometryFilterClamp);
-		auto handle              = TextureHandle(new Texture());
-		handle->Image            = image;
-		handle->Sampler          = sampler;
-		textures.push_back(handle);
+	BufferData gltfBuffers(gltfModel.buffers.size());
+	std::transform(gltfModel.buffers.begin(),
+	               gltfModel.buffers.end(),
+	               gltfBuffers.begin(),
+	               [](const tinygltf::Buffer& buffer) -> std::span<const uint8_t> { return buffer.data; });
+	if (glbBuffer) { gltfBuffers[0] = glbBin; }
+	for (size_t i = 0; i < externalBuffers.size(); ++i) { gltfBuffers[externalBuffers[i]] = bufferFiles[i]; }
+	for (const auto& view : gltfModel.bufferViews) {
+		const auto& buffer = gltfBuffers[view.buffer];
+		if (neededBuffers[view.buffer] &&
+		    (view.byteOffset > buffer.size() || view.byteLength > buffer.size() - view.byteOffset)) {
+			Log::Error("GltfLoader", "Mesh asset file {} has a bufferView past the end of its buffer.", gltfFile);
+			return false;
+		}
 	}
 
-	std::vector<MaterialHandle> materials;
+	// Quickly iterate over materials to find what format each image should be, Srgb or Unorm.
+	std::vector<vk::Format> textureFormats(gltfModel.images.size(), vk::Format::eUndefined);
+	std::vector<bool> normalMaps(gltfModel.images.size(), false);
+	const auto EnsureFormat = [&](int textureIndex, vk::Format expected, bool normalMap = false) -> void {
+		const int index = GetTextureSource(gltfModel.textures[textureIndex]);
+		if (index < 0 || index >= gltfModel.images.size()) { return; }
+
+		auto& format = textureFormats[index];
+		if (format != vk::Format::eUndefined && format != expected) {
+			Log::Error(
+				"GltfLoader", "For asset '{}', image index {} is used in both Srgb and Unorm contexts!", gltfFile, index);
+		}
+		format = expected;
+		if (normalMap) { normalMaps[index] = true; }
+	};
 	for (size_t i = 0; i < gltfModel.materials.size(); ++i) {
 		const auto& gltfMaterial = gltfModel.materials[i];
-		Material* material       = new Material();
 
-		material->DualSided = gltfMaterial.doubleSided;
-		if (gltfMaterial.pbrMetallicRoughness.baseColorFactor.size() == 4) {
-			material->BaseColorFactor = glm::make_vec4(gltfMaterial.pbrMetallicRoughness.baseColorFactor.data());
+		if (gltfMaterial.pbrMetallicRoughness.baseColorTexture.index >= 0) {
+			EnsureFormat(gltfMaterial.pbrMetallicRoughness.baseColorTexture.index, vk::Format::eR8G8B8A8Srgb);
 		}
-		if (gltfMaterial.emissiveFactor.size() == 3) {
-			material->EmissiveFactor = glm::make_vec3(gltfMaterial.emissiveFactor.data());
+		if (gltfMaterial.normalTexture.index >= 0) {
+			EnsureFormat(gltfMaterial.normalTexture.index, vk::Format::eR8G8B8A8Unorm, true);
 		}
-		if (gltfMaterial.alphaMode.compare("OPAQUE") == 0) {
-			material->Alpha = AlphaMode::Opaque;
-		} else if (gltfMaterial.alphaMode.compare("MASK") == 0) {
-			material->Alpha = AlphaMode::Mask;
-		} else if (gltfMaterial.alphaMode.compare("BLEND") == 0) {
-			material->Alpha = AlphaMode::Blend;
+		if (gltfMaterial.pbrMetallicRoughness.metallicRoughnessTexture.index >= 0) {
+			EnsureFormat(gltfMaterial.pbrMetallicRoughness.metallicRoughnessTexture.index, vk::Format::eR8G8B8A8Unorm);
+		}
+		if (gltfMaterial.emissiveTexture.index >= 0) {
+			EnsureFormat(gltfMaterial.emissiveTexture.index, vk::Format::eR8G8B8A8Srgb);
 		}
-		material->AlphaCutoff     = gltfMaterial.alphaCutoff;
-		material->MetallicFactor  = gltfMaterial.pbrMetallicRoughness.metallicFactor;
-		material->RoughnessFactor = gltfMaterial.pbrMetallicRoughness.roughnessFactor;
+	}
 
-		if (gltfMaterial.pbrMetallicRoughness.baseColorTexture.index >= 0) {
-			material->Albedo = textures[gltfMaterial.pbrMetallicRoughness.baseColorTexture.index];
+	// When the device supports BC formats, images are block-compressed with a full mip chain and cached on disk, keyed
+	// by the encoded image contents. Otherwise they are uploaded as RGBA8 and mipmapped on the GPU.
+	const bool compressTextures = _wsi->GetDevice().GetGPUInfo().EnabledFeatures.Features.textureCompressionBC;
+	const auto GetBlockFormat   = [&](size_t i) -> TextureCompressor::BlockFormat {
+		if (textureFormats[i] == vk::Format::eR8G8B8A8Srgb) { return TextureCompressor::BlockFormat::BC7; }
+		return normalMaps[i] ? TextureCompressor::BlockFormat::BC5 : TextureCompressor::BlockFormat::BC1;
+	};
+	const auto GetCompressedFormat = [](TextureCompressor::BlockFormat blockFormat) -> vk::Format {
+		switch (blockFormat) {
+			case TextureCompressor::BlockFormat::BC1:
+				return vk::Format::eBc1RgbUnormBlock;
+			case TextureCompressor::BlockFormat::BC5:
+				return vk::Format::eBc5UnormBlock;
+			case TextureCompressor::BlockFormat::BC7:
+			default:
+				return vk::Format::eBc7SrgbBlock;
 		}
-		if (gltfMaterial.normalTexture.index >= 0) { material->Normal = textures[gltfMaterial.normalTexture.index]; }
-		if (gltfMaterial.pbrMetallicRoughness.metallicRoughnessTexture.index >= 0) {
-			material->PBR = textures[gltfMaterial.pbrMetallicRoughness.metallicRoughnessTexture.index];
+	};
+
+	// Read and decode every image used by a material on the thread pool. Unused images are skipped entirely.
+	struct DecodedImage {
+		int Width         = 0;
+		int Height        = 0;
+		vk::Format Format = vk::Format::eUndefined;
+		std::unique_ptr<stbi_uc, decltype(&stbi_image_free)> Pixels{nullptr, &stbi_image_free};
+		std::vector<TextureCompressor::MipLevel> Mips;
+		// The image is decoded and uploaded only by its owner, the first load to use it. Others share the owner's upload.
+		std::shared_ptr<SharedImage> Shared;
+		bool Owner = false;
+	};
+	const auto ReadTextureCache = [](const std::vector<uint8_t>& data, DecodedImage& decoded) -> bool {
+		AssetCache::Reader reader(data.data(), data.size());
+
+		uint32_t magic, version, mipCount;
+		int32_t format;
+		if (!reader.Read(magic) || !reader.Read(version) || !reader.Read(format) || !reader.Read(decoded.Width) ||
+		    !reader.Read(decoded.Height) || !reader.Read(mipCount)) {
+			return false;
+		}
+		if (magic != TextureCacheMagic || version != TextureCacheVersion) { return false; }
+		// A 32-bit extent has at most 32 mip levels, so anything more is a damaged file rather than a huge allocation.
+		if (mipCount == 0 || mipCount > 32) { return false; }
+
+		decoded.Format = static_cast<vk::Format>(format);
+		decoded.Mips.resize(mipCount);
+		for (auto& mip : decoded.Mips) {
+			uint64_t size;
+			if (!reader.Read(mip.Width) || !reader.Read(mip.Height) || !reader.Read(size)) { return false; }
+			const uint8_t* mipData = reader.ReadBytes(size);
+			if (mipData == nullptr) { return false; }
+			mip.Data.assign(mipData, mipData + size);
 		}
-		if (gltfMaterial.emissiveTexture.index >= 0) { material->Emissive = textures[gltfMaterial.emissiveTexture.index]; }
 
-		materials.emplace_back(material);
-	}
+		return true;
+	};
+	const auto WriteTextureCache = [](const DecodedImage& decoded) -> std::vector<uint8_t> {
+		AssetCache::Writer writer;
+		writer.Write(TextureCacheMagic);
+		writer.Write(TextureCacheVersion);
+		writer.Write(static_cast<int32_t>(decoded.Format));
+		writer.Write(decoded.Width);
+		writer.Write(decoded.Height);
+		writer.Write(static_cast<uint32_t>(decoded.Mips.size()));
+		for (const auto& mip : decoded.Mips) {
+			writer.Write(mip.Width);
+			writer.Write(mip.Height);
+			writer.Write(static_cast<uint64_t>(mip.Data.size()));
+			writer.Write(mip.Data.data(), mip.Data.size());
+		}
+
+		return writer.TakeData();
+	};
+	const auto DecodeImage = [&](size_t i, const uint8_t* data, size_t dataSize) -> DecodedImage {
+		const auto& uri = gltfModel.images[i].uri;
+		DecodedImage decoded;
+
+		// Basis Universal textures with a full mip chain transcode straight into the format they are uploaded in, without
+		// going through the texture cache. Others are transcoded to RGBA, then mipmapped and compressed like any image.
+		const auto blockFormat = GetBlockFormat(i);
+		const auto ktx2        = TextureTranscoder::GetInfo(data, dataSize);
+		if (ktx2 && ktx2->LevelCount == static_cast<uint32_t>(std::bit_width(std::max(ktx2->Width, ktx2->Height)))) {
+			decoded.Mips = TextureTranscoder::Transcode(
+				data, dataSize, compressTextures ? std::optional(blockFormat) : std::nullopt, normalMaps[i]);
+			if (decoded.Mips.empty()) {
+				Log::Error("GltfLoader", "Failed to transcode texture data for {}, {}.", gltfFile, uri);
+				return decoded;
+			}
+			decoded.Width  = ktx2->Width;
+			decoded.Height = ktx2->Height;
+			decoded.Format = compressTextures ? GetCompressedFormat(blockFormat) : textureFormats[i];
+			return decoded;
+		}
+
+		std::filesystem::path cachePath;
+		if (compressTextures) {
+			const uint64_t key = AssetCache::Hash(data, dataSize, (uint64_t(blockFormat) << 32) | TextureCacheVersion);
+			cachePath          = AssetCache::GetPath("Textures", key, ".tex");
+
+			std::vector<uint8_t> cacheData;
+			if (AssetCache::Read(cachePath, cacheData) && ReadTextureCache(cacheData, decoded)) { return decoded; }
+			decoded.Mips.clear();
+		}
+
+		const uint8_t* pixels = nullptr;
+		std::vector<TextureCompressor::MipLevel> ktx2Levels;
+		if (ktx2) {
+			ktx2Levels = TextureTranscoder::Transcode(data, dataSize, std::nullopt, normalMaps[i], 1);
+			if (ktx2Levels.empty()) {
+				Log::Error("GltfLoader", "Failed to transcode texture data for {}, {}.", gltfFile, uri);
+				return decoded;
+			}
+			decoded.Width  = ktx2->Width;
+			decoded.Height = ktx2->Height;
+			pixels         = ktx2Levels[0].Data.data();
+		} else {
+			int components;
+			decoded.Pixels.reset(
+				stbi_load_from_memory(data, dataSize, &decoded.Width, &decoded.Height, &components, STBI_rgb_alpha));
+			if (!decoded.Pixels) {
+				Log::Error("GltfLoader", "Failed to read texture data for {}, {}: {}", gltfFile, uri, stbi_failure_reason());
+				return decoded;
+			}
+			pixels = decoded.Pixels.get();
+		}
+
+		// Mips are built here on the worker rather than on the GPU, so every image uploads as plain copies.
+		const bool srgb = textureFormats[i] == vk::Format::eR8G8B8A8Srgb;
+		decoded.Mips    = TextureCompressor::GenerateMipChain(pixels, decoded.Width, decoded.Height, srgb);
+		decoded.Pixels.reset();
+		ktx2Levels.clear();
+		if (!compressTextures) {
+			decoded.Format = textureFormats[i];
+			return decoded;
+		}
+
+		decoded.Format = GetCompressedFormat(blockFormat);
+		for (auto& mip : decoded.Mips) {
+			mip.Data = TextureCompressor::Compress(mip.Data.data(), mip.Width, mip.Height, blockFormat);
+		}
+
+		// Like cooked geometry, the entry is only kept if what the reader makes of it writes back to the same bytes.
+		const auto cacheData = WriteTextureCache(decoded);
+		DecodedImage readBack;
+		if (!ReadTextureCache(cacheData, readBack) || WriteTextureCache(readBack) != cacheData) {
+			Log::Error("GltfLoader", "Texture cache entry {} does not read back as written.", cachePath.string());
+		} else if (!AssetCache::Write(cachePath, cacheData.data(), cacheData.size())) {
+			Log::Warning("GltfLoader", "Failed to write texture cache entry {}.", cachePath.string());
+		}
+
+		return decoded;
+	};
+	// Images with the same encoded data and format are decoded and uploaded once, however many resident models use them.
+	const auto DecodeSharedImage = [&](size_t i, const uint8_t* data, size_t dataSize) -> DecodedImage {
+		const uint64_t key = AssetCache::Hash(
+			data, dataSize, (uint64_t(GetBlockFormat(i)) << 32) | static_cast<uint32_t>(textureFormats[i]));
+		auto [shared, owner] = _registry->AcquireImage(key);
+		if (!owner) { return DecodedImage{.Shared = std::move(shared)}; }
+
+		auto decoded   = DecodeImage(i, data, dataSize);
+		decoded.Shared = std::move(shared);
+		decoded.Owner  = true;
+
+		return decoded;
+	};
+
+	const bool quantized =
+		std::find(gltfModel.extensionsRequired.begin(), gltfModel.extensionsRequired.end(), "KHR_mesh_quantization") !=
+		gltfModel.extensionsRequired.end();
+	if (quantized) { Log::Info("GltfLoader", "{} uses KHR_mesh_quantization.", gltfFile); }
 
 	struct PrimitiveContext {
 		AABB Bounds                = {};
@@ -272,380 +1341,589 @@ Entity GltfLoader::Load(const std::filesystem::path& meshAssetPath, Scene& scene
 		uint64_t IndexCount        = 0;
 		vk::DeviceSize FirstVertex = 0;
 		vk::DeviceSize FirstIndex  = 0;
-		int IndexStride            = 0;
 		int MaterialIndex          = 0;
-		const void* PositionData   = nullptr;
-		const void* NormalData     = nullptr;
-		const void* TangentData    = nullptr;
-		const void* Texcoord0Data  = nullptr;
-		const void* IndexData      = nullptr;
-		vk::Format PositionFormat  = vk::Format::eR32G32B32Sfloat;
-		vk::Format NormalFormat    = vk::Format::eR32G32B32Sfloat;
-		vk::Format TangentFormat   = vk::Format::eR32G32B32Sfloat;
-		vk::Format Texcoord0Format = vk::Format::eR32G32Sfloat;
-		bool PositionNormalized    = false;
-		bool NormalNormalized      = false;
-		bool TangentNormalized     = false;
-		bool Texcoord0Normalized   = false;
-
+		AttributeSource PositionSource;
+		AttributeSource NormalSource;
+		AttributeSource TangentSource;
+		AttributeSource Texcoord0Source;
+		AttributeSource IndexSource;
+
+		// Attributes decoded to floats, used for tangent generation and for streams that are not kept quantized.
+		std::vector<glm::vec3> Positions;
+		std::vector<glm::vec3> Normals;
+		std::vector<glm::vec2> Texcoords0;
 		std::vector<glm::vec4> Tangents;
 		std::vector<glm::vec3> Bitangents;
+
+		std::vector<uint32_t> Indices;
+		std::vector<Meshlet> Meshlets;
+		// Simplified indices of every level of detail past the first, which follow Indices in the index buffer.
+		std::vector<uint32_t> LodIndices;
+		std::vector<MeshLod> Lods;
+		// The source vertex for each output vertex, after tangent welding and vertex fetch optimization. Empty if
+		// unchanged.
+		std::vector<uint32_t> VertexOrder;
+
+		// Tangents generated by MikkTSpace for each triangle corner, before they are welded back onto vertices.
+		std::vector<glm::vec4> CornerTangents;
+
+		float AcmrBefore = 0.0f;
+		float AcmrAfter  = 0.0f;
+		bool Optimized   = false;
 	};
 
-	// Create a MikkTSpace context for tangent generation.
-	SMikkTSpaceContext mikktContext;
+	// MikkTSpace works on triangle corners, which are resolved through the index buffer when the primitive has one.
+	// Every worker uses its own context, as the context holds the primitive being processed.
 	SMikkTSpaceInterface mikktInterface;
 	{
+		static constexpr auto Vertex = [](const PrimitiveContext* data, const int face, const int vert) -> size_t {
+			const size_t corner = face * 3 + vert;
+			return data->Indices.empty() ? corner : data->Indices[corner];
+		};
+
 		mikktInterface.m_getNumFaces = [](const SMikkTSpaceContext* context) -> int {
 			const auto data = reinterpret_cast<const PrimitiveContext*>(context->m_pUserData);
-			return data->VertexCount / 3;
+			return (data->Indices.empty() ? data->VertexCount : data->IndexCount) / 3;
 		};
 		mikktInterface.m_getNumVerticesOfFace = [](const SMikkTSpaceContext* context, const int face) -> int { return 3; };
 		mikktInterface.m_getPosition =
 			[](const SMikkTSpaceContext* context, float fvPosOut[], const int face, const int vert) -> void {
-			const auto data  = reinterpret_cast<const PrimitiveContext*>(context->m_pUserData);
-			const size_t idx = face * 3 + vert;
-			auto pos         = reinterpret_cast<const float*>(data->PositionData);
-			fvPosOut[0]      = pos[idx + 0];
-			fvPosOut[1]      = pos[idx + 1];
-			fvPosOut[2]      = pos[idx + 2];
+			const auto data      = reinterpret_cast<const PrimitiveContext*>(context->m_pUserData);
+			const glm::vec3& pos = data->Positions[Vertex(data, face, vert)];
+			fvPosOut[0]          = pos.x;
+			fvPosOut[1]          = pos.y;
+			fvPosOut[2]          = pos.z;
 		};
 		mikktInterface.m_getNormal =
 			[](const SMikkTSpaceContext* context, float fvNormOut[], const int face, const int vert) -> void {
-			const auto data  = reinterpret_cast<const PrimitiveContext*>(context->m_pUserData);
-			const size_t idx = face * 3 + vert;
-			auto norm        = reinterpret_cast<const float*>(data->NormalData);
-			fvNormOut[0]     = norm[idx + 0];
-			fvNormOut[1]     = norm[idx + 1];
-			fvNormOut[2]     = norm[idx + 2];
+			const auto data       = reinterpret_cast<const PrimitiveContext*>(context->m_pUserData);
+			const glm::vec3& norm = data->Normals[Vertex(data, face, vert)];
+			fvNormOut[0]          = norm.x;
+			fvNormOut[1]          = norm.y;
+			fvNormOut[2]          = norm.z;
 		};
 		mikktInterface.m_getTexCoord =
 			[](const SMikkTSpaceContext* context, float fvTexcOut[], const int face, const int vert) -> void {
-			const auto data  = reinterpret_cast<const PrimitiveContext*>(context->m_pUserData);
-			const size_t idx = face * 2 + vert;
-			auto uv          = reinterpret_cast<const float*>(data->Texcoord0Data);
-			fvTexcOut[0]     = uv[idx + 0];
-			fvTexcOut[1]     = uv[idx + 1];
+			const auto data    = reinterpret_cast<const PrimitiveContext*>(context->m_pUserData);
+			const glm::vec2 uv = data->Texcoords0.empty() ? glm::vec2(0.0f) : data->Texcoords0[Vertex(data, face, vert)];
+			fvTexcOut[0]       = uv.x;
+			fvTexcOut[1]       = uv.y;
 		};
 		mikktInterface.m_setTSpaceBasic =
 			[](
 				const SMikkTSpaceContext* context, const float fvTangent[], const float fSign, const int face, const int vert) {
-				auto data        = reinterpret_cast<PrimitiveContext*>(context->m_pUserData);
-				const size_t idx = face * 3 + vert;
-				const auto norm  = reinterpret_cast<const float*>(data->NormalData);
-
-				const glm::vec3 N = glm::make_vec3(&norm[idx]);
-				const glm::vec4 T = glm::make_vec4(fvTangent);
-				const glm::vec3 B = fSign * glm::cross(N, glm::vec3(T));
+				auto data = reinterpret_cast<PrimitiveContext*>(context->m_pUserData);
 
-				data->Tangents[idx]   = T;
-				data->Bitangents[idx] = B;
+				data->CornerTangents[face * 3 + vert] = glm::vec4(glm::make_vec3(fvTangent), fSign);
 			};
 		mikktInterface.m_setTSpace = nullptr;
+	}
 
-		mikktContext.m_pInterface = &mikktInterface;
-	}
-
-	const auto ConvertFormat = [](int type, int comp) -> vk::Format {
-		switch (comp) {
-			case TINYGLTF_COMPONENT_TYPE_BYTE:
-				switch (type) {
-					case TINYGLTF_TYPE_SCALAR:
-						return vk::Format::eR8Sint;
-					case TINYGLTF_TYPE_VEC2:
-						return vk::Format::eR8G8Sint;
-					case TINYGLTF_TYPE_VEC3:
-						return vk::Format::eR8G8B8Sint;
-					case TINYGLTF_TYPE_VEC4:
-						return vk::Format::eR8G8B8A8Sint;
-				}
-				break;
-			case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
-				switch (type) {
-					case TINYGLTF_TYPE_SCALAR:
-						return vk::Format::eR8Uint;
-					case TINYGLTF_TYPE_VEC2:
-						return vk::Format::eR8G8Uint;
-					case TINYGLTF_TYPE_VEC3:
-						return vk::Format::eR8G8B8Uint;
-					case TINYGLTF_TYPE_VEC4:
-						return vk::Format::eR8G8B8A8Uint;
-				}
-				break;
+	// Decodes a primitive, generates its tangents, and optimizes its index buffer. Primitives are independent of each
+	// other, so this runs on the thread pool.
+	const auto CookPrimitive = [&mikktInterface](PrimitiveContext& data) -> void {
+		const auto Decode = [&](const AttributeSource& source, auto& values) -> void {
+			using Value = typename std::decay_t<decltype(values)>::value_type;
+			if (source.Data == nullptr) { return; }
+			values.resize(data.VertexCount);
+			for (size_t v = 0; v < data.VertexCount; ++v) { values[v] = Value(ReadAttribute(source, v)); }
+		};
+		Decode(data.PositionSource, data.Positions);
+		Decode(data.NormalSource, data.Normals);
+		Decode(data.TangentSource, data.Tangents);
+		Decode(data.Texcoord0Source, data.Texcoords0);
+
+		// Bounds are taken from the decoded positions, as accessor min/max values are stored unnormalized.
+		if (!data.Positions.empty()) {
+			glm::vec3 boundsMin(std::numeric_limits<float>::max());
+			glm::vec3 boundsMax(std::numeric_limits<float>::lowest());
+			for (const auto& position : data.Positions) {
+				boundsMin = glm::min(boundsMin, position);
+				boundsMax = glm::max(boundsMax, position);
+			}
+			data.Bounds = AABB(boundsMin, boundsMax);
+		}
 
-			case TINYGLTF_COMPONENT_TYPE_SHORT:
-				switch (type) {
-					case TINYGLTF_TYPE_SCALAR:
-						return vk::Format::eR16Sint;
-					case TINYGLTF_TYPE_VEC2:
-						return vk::Format::eR16G16Sint;
-					case TINYGLTF_TYPE_VEC3:
-						return vk::Format::eR16G16B16Sint;
-					case TINYGLTF_TYPE_VEC4:
-						return vk::Format::eR16G16B16A16Sint;
-				}
-				break;
-			case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
-				switch (type) {
-					case TINYGLTF_TYPE_SCALAR:
-						return vk::Format::eR16Uint;
-					case TINYGLTF_TYPE_VEC2:
-						return vk::Format::eR16G16Uint;
-					case TINYGLTF_TYPE_VEC3:
-						return vk::Format::eR16G16B16Uint;
-					case TINYGLTF_TYPE_VEC4:
-						return vk::Format::eR16G16B16A16Uint;
+		if (data.IndexSource.Data != nullptr) {
+			const auto& source = data.IndexSource;
+			data.Indices.resize(data.IndexCount);
+			for (size_t i = 0; i < data.IndexCount; ++i) {
+				const uint8_t* element = source.Data + i * source.Stride;
+				if (source.ComponentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE) {
+					data.Indices[i] = *element;
+				} else if (source.ComponentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT) {
+					uint16_t index;
+					memcpy(&index, element, sizeof(index));
+					data.Indices[i] = index;
+				} else {
+					memcpy(&data.Indices[i], element, sizeof(uint32_t));
 				}
-				break;
+			}
+		}
+		const bool indicesValid =
+			std::all_of(data.Indices.begin(), data.Indices.end(), [&](uint32_t i) { return i < data.VertexCount; });
+
+		if (data.Tangents.empty()) {
+			data.Tangents.resize(data.VertexCount, glm::vec4(1.0f, 0.0f, 0.0f, 1.0f));
+
+			const size_t cornerCount = (data.Indices.empty() ? data.VertexCount : data.IndexCount) / 3 * 3;
+			if (!data.Positions.empty() && !data.Normals.empty() && indicesValid && cornerCount > 0) {
+				data.CornerTangents.resize(cornerCount);
+				SMikkTSpaceContext mikktContext{.m_pInterface = &mikktInterface, .m_pUserData = &data};
+				genTangSpaceDefault(&mikktContext);
+
+				// Weld the corner tangents back onto the vertices. The first tangent seen for a vertex stays with it, and
+				// every other distinct tangent gets a copy of the vertex, chained from the original so that corners with
+				// the same tangent share it.
+				constexpr uint32_t None = ~0u;
+				std::vector<bool> assigned(data.VertexCount, false);
+				std::vector<uint32_t> nextCopy(data.VertexCount, None);
+				for (size_t corner = 0; corner < cornerCount; ++corner) {
+					const glm::vec4& tangent = data.CornerTangents[corner];
+					const uint32_t vertex    = data.Indices.empty() ? static_cast<uint32_t>(corner) : data.Indices[corner];
+					if (!assigned[vertex]) {
+						assigned[vertex]      = true;
+						data.Tangents[vertex] = tangent;
+						continue;
+					}
 
-			case TINYGLTF_COMPONENT_TYPE_FLOAT:
-				switch (type) {
-					case TINYGLTF_TYPE_SCALAR:
-						return vk::Format::eR32Sfloat;
-					case TINYGLTF_TYPE_VEC2:
-						return vk::Format::eR32G32Sfloat;
-					case TINYGLTF_TYPE_VEC3:
-						return vk::Format::eR32G32B32Sfloat;
-					case TINYGLTF_TYPE_VEC4:
-						return vk::Format::eR32G32B32A32Sfloat;
+					uint32_t match = vertex;
+					while (match != None && data.Tangents[match] != tangent) { match = nextCopy[match]; }
+					if (match == None) {
+						if (data.VertexOrder.empty()) {
+							data.VertexOrder.resize(data.VertexCount);
+							std::iota(data.VertexOrder.begin(), data.VertexOrder.end(), 0);
+						}
+						match = static_cast<uint32_t>(data.Positions.size());
+						data.Positions.push_back(data.Positions[vertex]);
+						data.Normals.push_back(data.Normals[vertex]);
+						if (!data.Texcoords0.empty()) { data.Texcoords0.push_back(data.Texcoords0[vertex]); }
+						data.Tangents.push_back(tangent);
+						data.VertexOrder.push_back(data.VertexOrder[vertex]);
+						nextCopy.push_back(nextCopy[vertex]);
+						nextCopy[vertex] = match;
+					}
+					data.Indices[corner] = match;
 				}
-				break;
+				data.VertexCount = data.Positions.size();
+				data.CornerTangents.clear();
+				data.CornerTangents.shrink_to_fit();
+			}
+		}
+		data.Bitangents.resize(data.VertexCount);
+		for (size_t v = 0; v < data.VertexCount; ++v) {
+			const glm::vec3 N = data.Normals.empty() ? glm::vec3(0.0f) : data.Normals[v];
+			const glm::vec4 T = data.Tangents[v];
 
-			default:
-				break;
+			data.Bitangents[v] = glm::cross(N, glm::vec3(T)) * T.w;
 		}
 
-		return vk::Format::eUndefined;
+		// Reorder triangles for the post-transform vertex cache and then for overdraw, and finally lay the vertices out
+		// in the order they are first referenced.
+		if (!data.Indices.empty() && !data.Positions.empty() && indicesValid) {
+			auto* indices   = data.Indices.data();
+			data.AcmrBefore = MeshOptimizer::AnalyzeVertexCache(indices, data.IndexCount, data.VertexCount);
+			MeshOptimizer::OptimizeVertexCache(indices, indices, data.IndexCount, data.VertexCount);
+			MeshOptimizer::OptimizeOverdraw(
+				indices, indices, data.IndexCount, &data.Positions[0].x, sizeof(glm::vec3), data.VertexCount);
+			const auto remap = MeshOptimizer::OptimizeVertexFetch(indices, data.IndexCount, data.VertexCount);
+			data.AcmrAfter   = MeshOptimizer::AnalyzeVertexCache(indices, data.IndexCount, data.VertexCount);
+			data.Optimized   = true;
+
+			std::vector<uint32_t> inverse(data.VertexCount);
+			for (size_t v = 0; v < data.VertexCount; ++v) { inverse[remap[v]] = v; }
+			const auto Permute = [&](auto& values) -> void {
+				if (values.empty()) { return; }
+				auto permuted = values;
+				for (size_t v = 0; v < data.VertexCount; ++v) { permuted[v] = values[inverse[v]]; }
+				values = std::move(permuted);
+			};
+			Permute(data.Positions);
+			Permute(data.Normals);
+			Permute(data.Texcoords0);
+			Permute(data.Tangents);
+			Permute(data.Bitangents);
+			Permute(data.VertexOrder);
+			if (data.VertexOrder.empty()) { data.VertexOrder = std::move(inverse); }
+
+			// Meshlets follow the optimized triangle order, so that they are spatially coherent without reordering.
+			data.Meshlets = MeshOptimizer::BuildMeshlets(
+				data.Indices.data(), data.IndexCount, &data.Positions[0].x, sizeof(glm::vec3), data.VertexCount);
+
+			// Each level is simplified from the previous one, so errors add up along the chain. Levels that barely
+			// simplify are not worth their index memory, and end the chain.
+			const float maxError             = glm::length(data.Bounds.GetMax() - data.Bounds.GetMin()) * LodMaxError;
+			std::vector<uint32_t> lodIndices = data.Indices;
+			size_t lodIndexCount             = data.IndexCount;
+			float lodError                   = 0.0f;
+			while (data.Lods.size() + 1 < MeshInfo::MaxLodCount) {
+				float error             = 0.0f;
+				const size_t simplified = MeshOptimizer::Simplify(lodIndices.data(),
+				                                                  lodIndices.data(),
+				                                                  lodIndexCount,
+				                                                  &data.Positions[0].x,
+				                                                  sizeof(glm::vec3),
+				                                                  data.VertexCount,
+				                                                  lodIndexCount / 2,
+				                                                  maxError,
+				                                                  &error);
+				if (simplified == 0 || simplified > lodIndexCount * 4 / 5) { break; }
+
+				MeshOptimizer::OptimizeVertexCache(lodIndices.data(), lodIndices.data(), simplified, data.VertexCount);
+				lodError += error;
+				data.Lods.push_back({.FirstIndex = static_cast<uint32_t>(data.IndexCount + data.LodIndices.size()),
+				                     .IndexCount = static_cast<uint32_t>(simplified),
+				                     .Error      = lodError});
+				data.LodIndices.insert(data.LodIndices.end(), lodIndices.begin(), lodIndices.begin() + simplified);
+				lodIndexCount = simplified;
+			}
+		}
 	};
 
-	std::vector<IntrusivePtr<Mesh>> meshes;
-	for (size_t i = 0; i < gltfModel.meshes.size(); ++i) {
-		const auto& gltfMesh = gltfModel.meshes[i];
-		Mesh mesh;
+	if (meshCached) {
+		Log::Info("GltfLoader", "Using cooked geometry for {} from {}.", gltfFileName, meshCachePath.string());
+	} else {
+		AssetCache::Writer meshCache;
+		WriteMeshCacheHeader(meshCache, sourceHash, static_cast<uint32_t>(gltfModel.meshes.size()));
+		cookedMeshes.clear();
+		cookedMeshes.reserve(gltfModel.meshes.size());
+
+		const auto cookStart      = std::chrono::steady_clock::now();
+		size_t optimizedTriangles = 0;
+		size_t totalMeshlets      = 0;
+		double acmrBeforeTotal    = 0.0;
+		double acmrAfterTotal     = 0.0;
+
+		for (size_t i = 0; i < gltfModel.meshes.size(); ++i) {
+			const auto& gltfMesh = gltfModel.meshes[i];
+			Mesh mesh;
+
+			vk::DeviceSize totalVertexCount = 0;
+			vk::DeviceSize totalIndexCount  = 0;
+			std::vector<PrimitiveContext> primData(gltfMesh.primitives.size());
+			{
+				mesh.Submeshes.resize(gltfMesh.primitives.size());
+				std::vector<std::future<void>> cookJobs(gltfMesh.primitives.size());
+				for (size_t prim = 0; prim < gltfMesh.primitives.size(); ++prim) {
+					const auto& gltfPrimitive = gltfMesh.primitives[prim];
+					if (gltfPrimitive.mode != 4) {
+						Log::Warning("GltfLoader",
+						             "{} mesh {} contains a primitive with mode {}. Only mode 4 (triangle list) is supported.",
+						             gltfFile,
+						             i,
+						             gltfPrimitive.mode);
+						continue;
+					}
 
-		vk::DeviceSize totalVertexCount = 0;
-		vk::DeviceSize totalIndexCount  = 0;
-		std::vector<PrimitiveContext> primData(gltfMesh.primitives.size());
-		{
-			mesh.Submeshes.resize(gltfMesh.primitives.size());
-			for (size_t prim = 0; prim < gltfMesh.primitives.size(); ++prim) {
-				const auto& gltfPrimitive = gltfMesh.primitives[prim];
-				if (gltfPrimitive.mode != 4) {
-					Log::Warning("GltfLoader",
-					             "{} mesh {} contains a primitive with mode {}. Only mode 4 (triangle list) is supported.",
-					             gltfFile,
-					             i,
-					             gltfPrimitive.mode);
-					continue;
-				}
+					auto& data         = primData[prim];
+					data.MaterialIndex = gltfPrimitive.material;
+
+					for (const auto [attributeName, attributeId] : gltfPrimitive.attributes) {
+						const auto& gltfAccessor = gltfModel.accessors[attributeId];
+						const auto source        = GetAttributeSource(gltfModel, gltfBuffers, gltfAccessor);
+
+						if (attributeName.compare("POSITION") == 0) {
+							data.VertexCount    = gltfAccessor.count;
+							data.PositionSource = source;
+						} else if (attributeName.compare("NORMAL") == 0) {
+							data.NormalSource = source;
+						} else if (attributeName.compare("TANGENT") == 0) {
+							data.TangentSource = source;
+						} else if (attributeName.compare("TEXCOORD_0") == 0) {
+							data.Texcoord0Source = source;
+						}
+					}
 
-				auto& data         = primData[prim];
-				data.MaterialIndex = gltfPrimitive.material;
-
-				for (const auto [attributeName, attributeId] : gltfPrimitive.attributes) {
-					const auto& gltfAccessor   = gltfModel.accessors[attributeId];
-					const auto& gltfBufferView = gltfModel.bufferViews[gltfAccessor.bufferView];
-					const auto& gltfBuffer     = gltfModel.buffers[gltfBufferView.buffer];
-					const void* bufferData     = gltfBuffer.data.data() + gltfAccessor.byteOffset + gltfBufferView.byteOffset;
-
-					if (attributeName.compare("POSITION") == 0) {
-						data.Bounds =
-							AABB(glm::make_vec3(gltfAccessor.minValues.data()), glm::make_vec3(gltfAccessor.maxValues.data()));
-						mesh.Bounds.Contain(data.Bounds);
-						data.VertexCount        = gltfAccessor.count;
-						data.PositionData       = bufferData;
-						data.PositionFormat     = ConvertFormat(gltfAccessor.type, gltfAccessor.componentType);
-						data.PositionNormalized = gltfAccessor.normalized;
-					} else if (attributeName.compare("NORMAL") == 0) {
-						data.NormalData       = bufferData;
-						data.NormalFormat     = ConvertFormat(gltfAccessor.type, gltfAccessor.componentType);
-						data.NormalNormalized = gltfAccessor.normalized;
-					} else if (attributeName.compare("TANGENT") == 0) {
-						data.TangentData       = bufferData;
-						data.TangentFormat     = ConvertFormat(gltfAccessor.type, gltfAccessor.componentType);
-						data.TangentNormalized = gltfAccessor.normalized;
-					} else if (attributeName.compare("TEXCOORD_0") == 0) {
-						data.Texcoord0Data       = bufferData;
-						data.Texcoord0Format     = ConvertFormat(gltfAccessor.type, gltfAccessor.componentType);
-						data.Texcoord0Normalized = gltfAccessor.normalized;
+					if (gltfPrimitive.indices >= 0) {
+						const auto& gltfAccessor = gltfModel.accessors[gltfPrimitive.indices];
+						data.IndexCount          = gltfAccessor.count;
+						data.IndexSource         = GetAttributeSource(gltfModel, gltfBuffers, gltfAccessor);
 					}
-				}
 
-				if (quantized) {
-					Log::Info("GltfLoader",
-					          "Position: {} {}",
-					          vk::to_string(data.PositionFormat),
-					          data.PositionNormalized ? "Normalized" : "Unnormalized");
-					Log::Info("GltfLoader",
-					          "Normal: {} {}",
-					          vk::to_string(data.NormalFormat),
-					          data.NormalNormalized ? "Normalized" : "Unnormalized");
-					Log::Info("GltfLoader",
-					          "Tangent: {} {}",
-					          vk::to_string(data.TangentFormat),
-					          data.TangentNormalized ? "Normalized" : "Unnormalized");
-					Log::Info("GltfLoader",
-					          "Texcoord0: {} {}",
-					          vk::to_string(data.Texcoord0Format),
-					          data.Texcoord0Normalized ? "Normalized" : "Unnormalized");
+					cookJobs[prim] = _threadPool->Submit([&CookPrimitive, &data]() { CookPrimitive(data); });
 				}
 
-				if (gltfPrimitive.indices >= 0) {
-					const auto& gltfAccessor   = gltfModel.accessors[gltfPrimitive.indices];
-					const auto& gltfBufferView = gltfModel.bufferViews[gltfAccessor.bufferView];
-					const auto& gltfBuffer     = gltfModel.buffers[gltfBufferView.buffer];
-					const void* bufferData     = gltfBuffer.data.data() + gltfAccessor.byteOffset + gltfBufferView.byteOffset;
-					const auto bufferStride    = gltfAccessor.ByteStride(gltfBufferView);
+				for (size_t prim = 0; prim < gltfMesh.primitives.size(); ++prim) {
+					if (!cookJobs[prim].valid()) { continue; }
+					cookJobs[prim].get();
+
+					auto& data = primData[prim];
+					if (!data.Positions.empty()) { mesh.Bounds.Contain(data.Bounds); }
+					if (data.Optimized) {
+						const size_t triangleCount = data.IndexCount / 3;
+						optimizedTriangles += triangleCount;
+						acmrBeforeTotal += data.AcmrBefore * triangleCount;
+						acmrAfterTotal += data.AcmrAfter * triangleCount;
+					}
 
-					data.IndexCount  = gltfAccessor.count;
-					data.IndexData   = bufferData;
-					data.IndexStride = bufferStride;
+					data.FirstVertex = totalVertexCount;
+					data.FirstIndex  = totalIndexCount;
+					totalVertexCount += data.VertexCount;
+					totalIndexCount += data.IndexCount + data.LodIndices.size();
 				}
+			}
 
-				if (data.TangentData == nullptr) {
-					data.Tangents.resize(data.VertexCount);
-					data.Bitangents.resize(data.VertexCount);
-					data.TangentData = data.Tangents.data();
-
-					mikktContext.m_pUserData = &data;
-					genTangSpaceDefault(&mikktContext);
-				} else {
-					data.Bitangents.resize(data.VertexCount);
-					for (size_t i = 0; i < data.VertexCount; ++i) {
-						const auto norm = reinterpret_cast<const float*>(data.NormalData);
-						const auto tang = reinterpret_cast<const float*>(data.TangentData);
-
-						const glm::vec3 N = glm::make_vec3(&norm[i]);
-						const glm::vec4 T = glm::make_vec4(&tang[i]);
-
-						data.Bitangents[i] = glm::cross(N, glm::vec3(T)) * T.w;
+			// Streams keep their original quantized encoding when every primitive shares it, and fall back to floats
+			// otherwise. Bitangents are generated by us, so they share the normal encoding when that is quantized.
+			MeshInfo info;
+			const auto SelectStream = [&](AttributeSource PrimitiveContext::*member, VertexStream fallback) -> VertexStream {
+				const AttributeSource* encoding = nullptr;
+				for (const auto& data : primData) {
+					if (data.VertexCount == 0) { continue; }
+					const auto& source = data.*member;
+					if (source.Data == nullptr) { return fallback; }
+					if (encoding == nullptr) {
+						encoding = &source;
+					} else if (!encoding->SameEncoding(source)) {
+						return fallback;
 					}
 				}
+				if (encoding == nullptr || encoding->ComponentType == TINYGLTF_COMPONENT_TYPE_FLOAT) { return fallback; }
+				const auto stream = GetNativeStream(*encoding);
+				if (stream.Format == vk::Format::eUndefined || !SupportsVertexFormat(gpu, stream.Format)) { return fallback; }
 
-				data.FirstVertex = totalVertexCount;
-				data.FirstIndex  = totalIndexCount;
-				totalVertexCount += data.VertexCount;
-				totalIndexCount += data.IndexCount;
+				return stream;
+			};
+			info.Position  = SelectStream(&PrimitiveContext::PositionSource, info.Position);
+			info.Normal    = SelectStream(&PrimitiveContext::NormalSource, info.Normal);
+			info.Tangent   = SelectStream(&PrimitiveContext::TangentSource, info.Tangent);
+			info.Texcoord0 = SelectStream(&PrimitiveContext::Texcoord0Source, info.Texcoord0);
+			if (info.Normal.Format == vk::Format::eR8G8B8A8Snorm || info.Normal.Format == vk::Format::eR16G16B16A16Snorm) {
+				info.Bitangent = info.Normal;
+			}
+			if (options.CompactVertices) { info = MeshInfo::CompactLayout(); }
+
+			// Indices are relative to the first vertex of their submesh, so 16 bits suffice if every submesh fits.
+			const bool shortIndices = std::all_of(
+				primData.begin(), primData.end(), [](const PrimitiveContext& data) { return data.VertexCount <= 65536; });
+			info.IndexType                   = shortIndices ? vk::IndexType::eUint16 : vk::IndexType::eUint32;
+			const vk::DeviceSize indexStride = shortIndices ? sizeof(uint16_t) : sizeof(uint32_t);
+
+			if (quantized || options.CompactVertices) {
+				Log::Info("GltfLoader",
+				          "{} mesh {} vertex streams: Position {}, Normal {}, Tangent {}, Texcoord0 {} ({} bytes per vertex).",
+				          gltfFile,
+				          i,
+				          vk::to_string(info.Position.Format),
+				          vk::to_string(info.Normal.Format),
+				          vk::to_string(info.Tangent.Format),
+				          vk::to_string(info.Texcoord0.Format),
+				          info.Position.Stride + info.Normal.Stride + info.Tangent.Stride + info.Bitangent.Stride +
+				            info.Texcoord0.Stride);
 			}
-		}
-
-		const vk::DeviceSize totalPositionSize  = ((totalVertexCount * sizeof(glm::vec3)) + 16llu) & ~16llu;
-		const vk::DeviceSize totalNormalSize    = ((totalVertexCount * sizeof(glm::vec3)) + 16llu) & ~16llu;
-		const vk::DeviceSize totalTangentSize   = ((totalVertexCount * sizeof(glm::vec3)) + 16llu) & ~16llu;
-		const vk::DeviceSize totalBitangentSize = ((totalVertexCount * sizeof(glm::vec3)) + 16llu) & ~16llu;
-		const vk::DeviceSize totalTexcoord0Size = ((totalVertexCount * sizeof(glm::vec2)) + 16llu) & ~16llu;
-		const vk::DeviceSize totalIndexSize     = ((totalIndexCount * sizeof(uint32_t)) + 16llu) & ~16llu;
-		const vk::DeviceSize bufferSize =
-			totalPositionSize + totalNormalSize + totalTangentSize + totalBitangentSize + totalTexcoord0Size + totalIndexSize;
-
-		mesh.PositionOffset  = 0;
-		mesh.NormalOffset    = totalPositionSize;
-		mesh.TangentOffset   = totalPositionSize + totalNormalSize;
-		mesh.BitangentOffset = totalPositionSize + totalNormalSize + totalTangentSize;
-		mesh.Texcoord0Offset = totalPositionSize + totalNormalSize + totalTangentSize + totalBitangentSize;
-		mesh.IndexOffset = totalPositionSize + totalNormalSize + totalTangentSize + totalBitangentSize + totalTexcoord0Size;
-		mesh.TotalVertexCount = totalVertexCount;
-		mesh.TotalIndexCount  = totalIndexCount;
-
-		std::unique_ptr<uint8_t[]> bufferData;
-		bufferData.reset(new uint8_t[bufferSize]);
-		uint8_t* positionCursor  = bufferData.get();
-		uint8_t* normalCursor    = bufferData.get() + totalPositionSize;
-		uint8_t* tangentCursor   = bufferData.get() + totalPositionSize + totalNormalSize;
-		uint8_t* bitangentCursor = bufferData.get() + totalPositionSize + totalNormalSize + totalTangentSize;
-		uint8_t* texcoord0Cursor =
-			bufferData.get() + totalPositionSize + totalNormalSize + totalTangentSize + totalBitangentSize;
-		uint8_t* indexCursor = bufferData.get() + totalPositionSize + totalNormalSize + totalTangentSize +
-		                       totalBitangentSize + totalTexcoord0Size;
-
-		{
-			for (size_t prim = 0; prim < gltfMesh.primitives.size(); ++prim) {
-				const auto& data = primData[prim];
-				auto& submesh    = mesh.Submeshes[prim];
-
-				submesh.Bounds        = data.Bounds;
-				submesh.VertexCount   = data.VertexCount;
-				submesh.IndexCount    = data.IndexCount;
-				submesh.FirstVertex   = data.FirstVertex;
-				submesh.FirstIndex    = data.FirstIndex;
-				submesh.MaterialIndex = data.MaterialIndex;
-
-				const size_t positionSize  = data.VertexCount * sizeof(glm::vec3);
-				const size_t normalSize    = data.VertexCount * sizeof(glm::vec3);
-				const size_t tangentSize   = data.VertexCount * sizeof(glm::vec3);
-				const size_t bitangentSize = data.VertexCount * sizeof(glm::vec3);
-				const size_t texcoord0Size = data.VertexCount * sizeof(glm::vec2);
-				const size_t indexSize     = data.IndexCount * sizeof(uint32_t);
-
-				memcpy(positionCursor, data.PositionData, positionSize);
-				positionCursor += positionSize;
-
-				if (data.NormalData) {
-					memcpy(normalCursor, data.NormalData, normalSize);
-				} else {
-					memset(normalCursor, 0, normalSize);
-				}
-				normalCursor += normalSize;
-
-				if (data.TangentData) {
-					glm::vec3* dst       = reinterpret_cast<glm::vec3*>(tangentCursor);
-					const glm::vec4* src = reinterpret_cast<const glm::vec4*>(data.TangentData);
-					for (size_t i = 0; i < data.VertexCount; ++i) { dst[i] = src[i]; }
-				} else {
-					memset(tangentCursor, 0, tangentSize);
-				}
-				tangentCursor += tangentSize;
 
-				if (data.Bitangents.size() > 0) {
-					glm::vec3* dst = reinterpret_cast<glm::vec3*>(bitangentCursor);
-					for (size_t i = 0; i < data.VertexCount; ++i) { dst[i] = data.Bitangents[i]; }
+			const auto StreamSize = [&](const VertexStream& stream) -> vk::DeviceSize {
+				return ((totalVertexCount * stream.Stride) + 16llu) & ~16llu;
+			};
+			const vk::DeviceSize totalPositionSize  = StreamSize(info.Position);
+			const vk::DeviceSize totalNormalSize    = StreamSize(info.Normal);
+			const vk::DeviceSize totalTangentSize   = StreamSize(info.Tangent);
+			const vk::DeviceSize totalBitangentSize = StreamSize(info.Bitangent);
+			const vk::DeviceSize totalTexcoord0Size = StreamSize(info.Texcoord0);
+			const vk::DeviceSize totalIndexSize     = ((totalIndexCount * indexStride) + 16llu) & ~16llu;
+			const vk::DeviceSize bufferSize = totalPositionSize + totalNormalSize + totalTangentSize + totalBitangentSize +
+			                                  totalTexcoord0Size + totalIndexSize;
+
+			mesh.PositionOffset  = 0;
+			mesh.NormalOffset    = totalPositionSize;
+			mesh.TangentOffset   = totalPositionSize + totalNormalSize;
+			mesh.BitangentOffset = totalPositionSize + totalNormalSize + totalTangentSize;
+			mesh.Texcoord0Offset = totalPositionSize + totalNormalSize + totalTangentSize + totalBitangentSize;
+			mesh.IndexOffset =
+				totalPositionSize + totalNormalSize + totalTangentSize + totalBitangentSize + totalTexcoord0Size;
+			mesh.TotalVertexCount = totalVertexCount;
+			mesh.TotalIndexCount  = totalIndexCount;
+
+			std::unique_ptr<uint8_t[]> bufferData;
+			bufferData.reset(new uint8_t[bufferSize]());
+			uint8_t* positionCursor  = bufferData.get();
+			uint8_t* normalCursor    = bufferData.get() + totalPositionSize;
+			uint8_t* tangentCursor   = bufferData.get() + totalPositionSize + totalNormalSize;
+			uint8_t* bitangentCursor = bufferData.get() + totalPositionSize + totalNormalSize + totalTangentSize;
+			uint8_t* texcoord0Cursor =
+				bufferData.get() + totalPositionSize + totalNormalSize + totalTangentSize + totalBitangentSize;
+			uint8_t* indexCursor = bufferData.get() + totalPositionSize + totalNormalSize + totalTangentSize +
+			                       totalBitangentSize + totalTexcoord0Size;
+
+			// Copies an attribute into its stream, either verbatim in its original encoding or from the decoded floats.
+			// Missing attributes are left zeroed.
+			const auto WriteStream = [](uint8_t* dst,
+			                            const VertexStream& stream,
+			                            const AttributeSource& source,
+			                            const auto& values,
+			                            const std::vector<uint32_t>& order) -> void {
+				const bool native = source.Data != nullptr && source.ComponentType != TINYGLTF_COMPONENT_TYPE_FLOAT &&
+				                    GetNativeStream(source).Format == stream.Format;
+				if (native) {
+					const size_t elementSize =
+						tinygltf::GetNumComponentsInType(source.Type) * tinygltf::GetComponentSizeInBytes(source.ComponentType);
+					for (size_t v = 0; v < values.size(); ++v) {
+						const size_t src = order.empty() ? v : order[v];
+						memcpy(dst + v * stream.Stride, source.Data + src * source.Stride, elementSize);
+					}
 				} else {
-					memset(bitangentCursor, 0, bitangentSize);
+					for (size_t v = 0; v < values.size(); ++v) { memcpy(dst + v * stream.Stride, &values[v], stream.Stride); }
 				}
-				bitangentCursor += bitangentSize;
+			};
 
-				if (data.Texcoord0Data) {
-					memcpy(texcoord0Cursor, data.Texcoord0Data, texcoord0Size);
-				} else {
-					memset(texcoord0Cursor, 0, texcoord0Size);
-				}
-				texcoord0Cursor += texcoord0Size;
-
-				if (data.IndexData) {
-					if (data.IndexStride == 1) {
-						uint32_t* dst      = reinterpret_cast<uint32_t*>(indexCursor);
-						const uint8_t* src = reinterpret_cast<const uint8_t*>(data.IndexData);
-						for (size_t i = 0; i < data.IndexCount; ++i) { dst[i] = src[i]; }
-					} else if (data.IndexStride == 2) {
-						uint32_t* dst       = reinterpret_cast<uint32_t*>(indexCursor);
-						const uint16_t* src = reinterpret_cast<const uint16_t*>(data.IndexData);
-						for (size_t i = 0; i < data.IndexCount; ++i) { dst[i] = src[i]; }
-					} else if (data.IndexStride == 4) {
-						memcpy(indexCursor, data.IndexData, indexSize);
+			// Meshlets of every submesh are stored together, with their first index relative to the mesh.
+			std::vector<Meshlet> meshlets;
+			info.SubmeshMeshlets.resize(gltfMesh.primitives.size());
+			info.SubmeshLods.resize(gltfMesh.primitives.size());
+			{
+				for (size_t prim = 0; prim < gltfMesh.primitives.size(); ++prim) {
+					const auto& data = primData[prim];
+					auto& submesh    = mesh.Submeshes[prim];
+
+					info.SubmeshMeshlets[prim] = {static_cast<uint32_t>(meshlets.size()),
+					                              static_cast<uint32_t>(data.Meshlets.size())};
+					for (auto meshlet : data.Meshlets) {
+						meshlet.FirstIndex += static_cast<uint32_t>(data.FirstIndex);
+						meshlets.push_back(meshlet);
 					}
-				} else {
-					memset(indexCursor, 0, indexSize);
+					info.SubmeshLods[prim] = data.Lods;
+
+					submesh.Bounds        = data.Bounds;
+					submesh.VertexCount   = data.VertexCount;
+					submesh.IndexCount    = data.IndexCount;
+					submesh.FirstVertex   = data.FirstVertex;
+					submesh.FirstIndex    = data.FirstIndex;
+					submesh.MaterialIndex = data.MaterialIndex;
+
+					const size_t positionSize  = data.VertexCount * info.Position.Stride;
+					const size_t normalSize    = data.VertexCount * info.Normal.Stride;
+					const size_t tangentSize   = data.VertexCount * info.Tangent.Stride;
+					const size_t bitangentSize = data.VertexCount * info.Bitangent.Stride;
+					const size_t texcoord0Size = data.VertexCount * info.Texcoord0.Stride;
+
+					if (info.Compact) {
+						const glm::vec3 boundsMin    = data.Bounds.GetMin();
+						const glm::vec3 boundsExtent = data.Bounds.GetMax() - boundsMin;
+						auto* positions              = reinterpret_cast<uint16_t*>(positionCursor);
+						auto* normals                = reinterpret_cast<int16_t*>(normalCursor);
+						auto* tangents               = reinterpret_cast<int16_t*>(tangentCursor);
+						auto* texcoords              = reinterpret_cast<uint16_t*>(texcoord0Cursor);
+						for (size_t v = 0; v < data.VertexCount; ++v) {
+							if (!data.Positions.empty()) {
+								const glm::vec3 t = glm::clamp(
+									(data.Positions[v] - boundsMin) / glm::max(boundsExtent, glm::vec3(1e-20f)), 0.0f, 1.0f);
+								for (int c = 0; c < 3; ++c) {
+									positions[v * 4 + c] = static_cast<uint16_t>(std::round(t[c] * 65535.0f));
+								}
+							}
+
+							const glm::vec3 N = data.Normals.empty() ? glm::vec3(0.0f) : data.Normals[v];
+							const glm::vec3 T = glm::vec3(data.Tangents[v]);
+							const glm::vec2 n = OctahedralEncode(N);
+							const glm::vec2 t = OctahedralEncode(T);
+							normals[v * 2 + 0] = PackSnorm16(n.x);
+							normals[v * 2 + 1] = PackSnorm16(n.y);
+
+							// The bitangent sign is stored in the sign of the tangent's Y, which is remapped to [0, 1] first.
+							const float sign    = glm::dot(glm::cross(N, T), data.Bitangents[v]) < 0.0f ? -1.0f : 1.0f;
+							tangents[v * 2 + 0] = PackSnorm16(t.x);
+							tangents[v * 2 + 1] = PackSnorm16(std::max(t.y * 0.5f + 0.5f, 1.0f / 32767.0f) * sign);
+
+							if (!data.Texcoords0.empty()) {
+								texcoords[v * 2 + 0] = glm::packHalf1x16(data.Texcoords0[v].x);
+								texcoords[v * 2 + 1] = glm::packHalf1x16(data.Texcoords0[v].y);
+							}
+						}
+					} else {
+						const auto& order = data.VertexOrder;
+						WriteStream(positionCursor, info.Position, data.PositionSource, data.Positions, order);
+						WriteStream(normalCursor, info.Normal, data.NormalSource, data.Normals, order);
+						WriteStream(tangentCursor, info.Tangent, data.TangentSource, data.Tangents, order);
+						WriteStream(texcoord0Cursor, info.Texcoord0, data.Texcoord0Source, data.Texcoords0, order);
+
+						if (info.Bitangent.Format == vk::Format::eR8G8B8A8Snorm) {
+							int8_t* dst = reinterpret_cast<int8_t*>(bitangentCursor);
+							for (size_t v = 0; v < data.Bitangents.size(); ++v) {
+								for (int c = 0; c < 3; ++c) {
+									dst[v * 4 + c] =
+										static_cast<int8_t>(std::round(glm::clamp(data.Bitangents[v][c], -1.0f, 1.0f) * 127.0f));
+								}
+							}
+						} else if (info.Bitangent.Format == vk::Format::eR16G16B16A16Snorm) {
+							int16_t* dst = reinterpret_cast<int16_t*>(bitangentCursor);
+							for (size_t v = 0; v < data.Bitangents.size(); ++v) {
+								for (int c = 0; c < 3; ++c) {
+									dst[v * 4 + c] =
+										static_cast<int16_t>(std::round(glm::clamp(data.Bitangents[v][c], -1.0f, 1.0f) * 32767.0f));
+								}
+							}
+						} else {
+							WriteStream(bitangentCursor, info.Bitangent, AttributeSource{}, data.Bitangents, order);
+						}
+					}
+					positionCursor += positionSize;
+					normalCursor += normalSize;
+					tangentCursor += tangentSize;
+					bitangentCursor += bitangentSize;
+					texcoord0Cursor += texcoord0Size;
+
+					// Levels of detail follow the full index list of their primitive.
+					const auto WriteIndices = [&](const std::vector<uint32_t>& indices, size_t count) -> void {
+						if (shortIndices) {
+							uint16_t* dst = reinterpret_cast<uint16_t*>(indexCursor);
+							for (size_t i = 0; i < indices.size(); ++i) { dst[i] = static_cast<uint16_t>(indices[i]); }
+						} else if (!indices.empty()) {
+							memcpy(indexCursor, indices.data(), indices.size() * sizeof(uint32_t));
+						}
+						indexCursor += count * indexStride;
+					};
+					WriteIndices(data.Indices, data.IndexCount);
+					WriteIndices(data.LodIndices, data.LodIndices.size());
 				}
-				indexCursor += indexSize;
 			}
+
+			totalMeshlets += meshlets.size();
+			WriteCookedMesh(meshCache, mesh, info, meshlets, bufferData.get(), bufferSize);
+
+			auto& cooked    = cookedMeshes.emplace_back();
+			cooked.Layout   = mesh;
+			cooked.Info     = info;
+			cooked.Meshlets = std::move(meshlets);
+			cooked.Data     = bufferData.get();
+			cooked.Size     = bufferSize;
+			cooked.Storage  = std::move(bufferData);
 		}
 
-		auto& device = _wsi->GetDevice();
-		mesh.Buffer  = device.CreateBuffer(
-      Vulkan::BufferCreateInfo(Vulkan::BufferDomain::Device,
-                               bufferSize,
-                               vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eIndexBuffer),
-      bufferData.get());
+		const std::chrono::duration<double, std::milli> cookTime = std::chrono::steady_clock::now() - cookStart;
+		Log::Info("GltfLoader",
+		          "Cooked geometry for {} in {:.2f}ms using {} threads.",
+		          gltfFileName,
+		          cookTime.count(),
+		          _threadPool->GetThreadCount());
+		if (optimizedTriangles > 0) {
+			Log::Info("GltfLoader",
+			          "Optimized index buffers for {}: ACMR {:.3f} -> {:.3f} over {} triangles in {} meshlets.",
+			          gltfFileName,
+			          acmrBeforeTotal / optimizedTriangles,
+			          acmrAfterTotal / optimizedTriangles,
+			          optimizedTriangles,
+			          totalMeshlets);
+		}
 
-		meshes.emplace_back(new Mesh(mesh));
+		meshCacheData = meshCache.TakeData();
+		if (!VerifyMeshCache(meshCacheData, sourceHash)) {
+			Log::Error(
+				"GltfLoader", "Cooked geometry for {} does not read back as written, so it is not cached.", gltfFileName);
+		} else if (!AssetCache::Write(meshCachePath, meshCacheData.data(), meshCacheData.size())) {
+			Log::Warning("GltfLoader", "Failed to write cooked geometry for {} to {}.", gltfFileName, meshCachePath.string());
+		}
 	}
 
-	auto rootNode = scene.CreateEntity(gltfFileName);
-
-	std::function<void(const tinygltf::Node&, Luna::Entity&)> AddNode = [&](const tinygltf::Node& gltfNode,
-	                                                                        Luna::Entity& parentEntity) {
-		auto entity     = scene.CreateChildEntity(parentEntity, gltfNode.name);
-		auto& transform = entity.Transform();
+	// The node hierarchy is kept with the model, so that the model can be placed again without reading the file.
+	auto model = std::make_shared<LoadedModel>();
+	model->Images.resize(gltfModel.images.size());
+	model->Nodes.resize(gltfModel.nodes.size());
+	for (size_t i = 0; i < gltfModel.nodes.size(); ++i) {
+		const auto& gltfNode = gltfModel.nodes[i];
+		auto& node           = model->Nodes[i];
+		node.Name            = gltfNode.name;
+		node.Mesh            = gltfNode.mesh;
+		node.Children.assign(gltfNode.children.begin(), gltfNode.children.end());
 
 		if (gltfNode.matrix.size() > 0) {
 			const glm::mat4 matrix = glm::make_mat4(gltfNode.matrix.data());
@@ -655,32 +1933,346 @@ Entity GltfLoader::Load(const std::filesystem::path& meshAssetPath, Scene& scene
 			glm::vec3 skew;
 			glm::vec4 perspective;
 			glm::decompose(matrix, scale, rotation, translation, skew, perspective);
-			transform.Translation = translation;
-			transform.Rotation    = glm::degrees(glm::eulerAngles(rotation));
-			transform.Scale       = scale;
+			node.Translation = translation;
+			node.Rotation    = glm::degrees(glm::eulerAngles(rotation));
+			node.Scale       = scale;
 		} else {
-			if (gltfNode.translation.size() > 0) { transform.Translation = glm::make_vec3(gltfNode.translation.data()); }
+			if (gltfNode.translation.size() > 0) { node.Translation = glm::make_vec3(gltfNode.translation.data()); }
 			if (gltfNode.rotation.size() > 0) {
-				transform.Rotation = glm::degrees(glm::eulerAngles(
+				node.Rotation = glm::degrees(glm::eulerAngles(
 					glm::quat(gltfNode.rotation[3], gltfNode.rotation[0], gltfNode.rotation[1], gltfNode.rotation[2])));
 			}
-			if (gltfNode.scale.size() > 0) { transform.Scale = glm::make_vec3(gltfNode.scale.data()); }
+			if (gltfNode.scale.size() > 0) { node.Scale = glm::make_vec3(gltfNode.scale.data()); }
 		}
 
-		if (gltfNode.mesh >= 0) {
-			auto& cMesh     = entity.AddComponent<MeshComponent>();
-			cMesh.Bounds    = meshes[gltfNode.mesh]->Bounds;
-			cMesh.Mesh      = meshes[gltfNode.mesh];
-			cMesh.Materials = materials;
+		const auto instancing = gltfNode.extensions.find("EXT_mesh_gpu_instancing");
+		if (gltfNode.mesh >= 0 && instancing != gltfNode.extensions.end()) {
+			auto transforms = ReadInstanceTransforms(gltfModel, gltfBuffers, instancing->second);
+			if (!transforms.empty()) {
+				Log::Info("GltfLoader", "{} node '{}' has {} instances.", gltfFileName, gltfNode.name, transforms.size());
+				node.Instances = std::make_shared<const std::vector<glm::mat4>>(std::move(transforms));
+			}
 		}
+	}
+	if (gltfModel.defaultScene >= 0) {
+		const auto& gltfScene = gltfModel.scenes[gltfModel.defaultScene];
+		model->RootNodes.assign(gltfScene.nodes.begin(), gltfScene.nodes.end());
+	}
 
-		for (auto gltfNodeIndex : gltfNode.children) { AddNode(gltfModel.nodes[gltfNodeIndex], entity); }
-	};
-	auto& gltfScene = gltfModel.scenes[gltfModel.defaultScene];
-	for (auto gltfNodeIndex : gltfScene.nodes) {
-		auto& gltfNode = gltfModel.nodes[gltfNodeIndex];
-		AddNode(gltfNode, rootNode);
+	// Everything from here on touches the device or the scene, so it runs on the main thread. Textures start out without
+	// images, which the renderer replaces with default ones, and are given theirs as each one is uploaded below.
+	std::vector<std::vector<TextureHandle>> imageTextures(gltfModel.images.size());
+	RunOnMainThreadAndWait(async, [&]() -> void {
+		std::vector<Vulkan::Sampler*> samplers;
+		for (size_t i = 0; i < gltfModel.samplers.size(); ++i) {
+			const auto& gltfSampler = gltfModel.samplers[i];
+
+			const auto& gpuInfo    = _wsi->GetDevice().GetGPUInfo();
+			const float anisotropy = gpuInfo.EnabledFeatures.Features.samplerAnisotropy
+			                           ? gpuInfo.Properties.Properties.limits.maxSamplerAnisotropy
+			                           : 0.0f;
+
+			Vulkan::SamplerCreateInfo samplerCI{
+				.AnisotropyEnable = anisotropy > 0.0f, .MaxAnisotropy = anisotropy, .MaxLod = 11.0f};
+			switch (gltfSampler.magFilter) {
+				case 9728:  // NEAREST
+					samplerCI.MagFilter = vk::Filter::eNearest;
+					break;
+				case 9729:  // LINEAR
+					samplerCI.MagFilter = vk::Filter::eLinear;
+					break;
+			}
+			switch (gltfSampler.minFilter) {
+				case 9728:  // NEAREST
+					samplerCI.MinFilter = vk::Filter::eNearest;
+					break;
+				case 9729:  // LINEAR
+					samplerCI.MinFilter = vk::Filter::eLinear;
+					break;
+				case 9984:  // NEAREST_MIPMAP_NEAREST
+					samplerCI.MinFilter  = vk::Filter::eNearest;
+					samplerCI.MipmapMode = vk::SamplerMipmapMode::eNearest;
+					break;
+				case 9985:  // LINEAR_MIPMAP_NEAREST
+					samplerCI.MinFilter  = vk::Filter::eLinear;
+					samplerCI.MipmapMode = vk::SamplerMipmapMode::eNearest;
+					break;
+				case 9986:  // NEAREST_MIPMAP_LINEAR
+					samplerCI.MinFilter  = vk::Filter::eNearest;
+					samplerCI.MipmapMode = vk::SamplerMipmapMode::eLinear;
+					break;
+				case 9987:  // LINEAR_MIPMAP_LINEAR
+					samplerCI.MinFilter  = vk::Filter::eLinear;
+					samplerCI.MipmapMode = vk::SamplerMipmapMode::eLinear;
+					break;
+			}
+			switch (gltfSampler.wrapS) {
+				case 33071:  // CLAMP_TO_EDGE
+					samplerCI.AddressModeU = vk::SamplerAddressMode::eClampToEdge;
+					break;
+				case 33648:  // MIRRORED_REPEAT
+					samplerCI.AddressModeU = vk::SamplerAddressMode::eMirroredRepeat;
+					break;
+				case 10497:  // REPEAT
+					samplerCI.AddressModeU = vk::SamplerAddressMode::eRepeat;
+					break;
+			}
+			switch (gltfSampler.wrapT) {
+				case 33071:  // CLAMP_TO_EDGE
+					samplerCI.AddressModeV = vk::SamplerAddressMode::eClampToEdge;
+					break;
+				case 33648:  // MIRRORED_REPEAT
+					samplerCI.AddressModeV = vk::SamplerAddressMode::eMirroredRepeat;
+					break;
+				case 10497:  // REPEAT
+					samplerCI.AddressModeV = vk::SamplerAddressMode::eRepeat;
+					break;
+			}
+			samplers.push_back(_wsi->GetDevice().RequestSampler(samplerCI));
+		}
+
+		std::vector<TextureHandle> textures;
+		for (size_t i = 0; i < gltfModel.textures.size(); ++i) {
+			const auto& gltfTexture = gltfModel.textures[i];
+
+			Vulkan::Sampler* sampler = gltfTexture.sampler >= 0
+			                             ? samplers[gltfTexture.sampler]
+			                             : _wsi->GetDevice().RequestSampler(Vulkan::StockSampler::DefaultGeometryFilterClamp);
+			auto handle              = TextureHandle(new Texture());
+			handle->Sampler          = sampler;
+			const int source         = GetTextureSource(gltfTexture);
+			if (source >= 0 && source < gltfModel.images.size()) { imageTextures[source].push_back(handle); }
+			textures.push_back(handle);
+		}
+
+		auto materials = std::make_shared<MaterialTable>();
+		for (size_t i = 0; i < gltfModel.materials.size(); ++i) {
+			const auto& gltfMaterial = gltfModel.materials[i];
+			Material* material       = new Material();
+
+			material->DualSided = gltfMaterial.doubleSided;
+			if (gltfMaterial.pbrMetallicRoughness.baseColorFactor.size() == 4) {
+				material->BaseColorFactor = glm::make_vec4(gltfMaterial.pbrMetallicRoughness.baseColorFactor.data());
+			}
+			if (gltfMaterial.emissiveFactor.size() == 3) {
+				material->EmissiveFactor = glm::make_vec3(gltfMaterial.emissiveFactor.data());
+			}
+			if (gltfMaterial.alphaMode.compare("OPAQUE") == 0) {
+				material->Alpha = AlphaMode::Opaque;
+			} else if (gltfMaterial.alphaMode.compare("MASK") == 0) {
+				material->Alpha = AlphaMode::Mask;
+			} else if (gltfMaterial.alphaMode.compare("BLEND") == 0) {
+				material->Alpha = AlphaMode::Blend;
+			}
+			material->AlphaCutoff     = gltfMaterial.alphaCutoff;
+			material->MetallicFactor  = gltfMaterial.pbrMetallicRoughness.metallicFactor;
+			material->RoughnessFactor = gltfMaterial.pbrMetallicRoughness.roughnessFactor;
+
+			if (gltfMaterial.pbrMetallicRoughness.baseColorTexture.index >= 0) {
+				material->Albedo = textures[gltfMaterial.pbrMetallicRoughness.baseColorTexture.index];
+			}
+			if (gltfMaterial.normalTexture.index >= 0) { material->Normal = textures[gltfMaterial.normalTexture.index]; }
+			if (gltfMaterial.pbrMetallicRoughness.metallicRoughnessTexture.index >= 0) {
+				material->PBR = textures[gltfMaterial.pbrMetallicRoughness.metallicRoughnessTexture.index];
+			}
+			if (gltfMaterial.emissiveTexture.index >= 0) {
+				material->Emissive = textures[gltfMaterial.emissiveTexture.index];
+			}
+
+			materials->Materials.emplace_back(material);
+		}
+
+		std::vector<IntrusivePtr<Mesh>> meshes;
+		std::vector<std::shared_ptr<const MeshInfo>> meshInfos;
+		for (auto& cookedMesh : cookedMeshes) {
+			cookedMesh.Info.Materials = materials;
+			cookedMesh.Info.Geometry  = _geometryPool->Allocate(
+				cookedMesh.Layout, cookedMesh.Info, cookedMesh.Meshlets, cookedMesh.Data, cookedMesh.Size);
+			// Meshes whose data could not be placed are kept, so that nodes still index the right ones, but draw nothing.
+			if (!cookedMesh.Info.Geometry) { cookedMesh.Layout.Submeshes.clear(); }
+
+			meshes.emplace_back(new Mesh(cookedMesh.Layout));
+			meshInfos.push_back(std::make_shared<const MeshInfo>(cookedMesh.Info));
+		}
+
+		model->Textures  = std::move(textures);
+		model->Materials = std::move(materials);
+		model->Meshes    = std::move(meshes);
+		model->MeshInfos = std::move(meshInfos);
+		_registry->AddModel(gltfPath, contentHash, model);
+		InstantiateModel(model, scene, root);
+
+		progress->GeometryLoaded = true;
+		const std::chrono::duration<double, std::milli> geometryTime = std::chrono::steady_clock::now() - loadStart;
+		Log::Info("GltfLoader", "Created the scene for {} in {:.2f}ms.", gltfFileName, geometryTime.count());
+	});
+
+	{
+		const auto decodeStart = std::chrono::steady_clock::now();
+
+		// The flip flag is global stb state, so it is set once here rather than from the workers.
+		stbi_set_flip_vertically_on_load(0);
+
+		// Decoded images are queued here in the order they finish, to be handed to the main thread for upload.
+		std::mutex decodedMutex;
+		std::condition_variable decodedReady;
+		std::deque<std::pair<size_t, DecodedImage>> decodedImages;
+		const auto FinishDecode = [&](size_t i, DecodedImage&& decoded) -> void {
+			std::lock_guard<std::mutex> lock(decodedMutex);
+			decodedImages.emplace_back(i, std::move(decoded));
+			decodedReady.notify_one();
+		};
+
+		// Images in their own files are decoded by whichever thread finishes reading them, and the rest on the pool.
+		uint32_t decodeCount = 0;
+		std::vector<bool> externalImage(gltfModel.images.size(), false);
+		for (const size_t i : externalImages) {
+			if (textureFormats[i] == vk::Format::eUndefined) { continue; }
+			externalImage[i] = true;
+			++decodeCount;
+		}
+		std::vector<ImageRead> readyImageReads;
+		{
+			std::lock_guard<std::mutex> lock(imageReadMutex);
+			decodeImageRead = [&](size_t i, std::vector<uint8_t>&& data, std::exception_ptr error) -> void {
+				if (textureFormats[i] == vk::Format::eUndefined) { return; }
+
+				if (error) {
+					try {
+						std::rethrow_exception(error);
+					} catch (const std::exception& e) {
+						Log::Error(
+							"GltfLoader", "Failed to load texture for {}, {}\n\t{}", gltfFile, gltfModel.images[i].uri, e.what());
+					}
+					FinishDecode(i, DecodedImage{});
+					return;
+				}
+				FinishDecode(i, DecodeSharedImage(i, data.data(), data.size()));
+			};
+			readyImageReads = std::move(parkedImageReads);
+		}
+		for (auto& [image, data, error] : readyImageReads) {
+			if (textureFormats[image] == vk::Format::eUndefined) { continue; }
+			_threadPool->Submit([&decodeImageRead, image, data = std::move(data), error]() mutable {
+				decodeImageRead(image, std::move(data), error);
+			});
+		}
+
+		for (size_t i = 0; i < gltfModel.images.size(); ++i) {
+			const auto& gltfImage = gltfModel.images[i];
+			if (textureFormats[i] == vk::Format::eUndefined || externalImage[i]) { continue; }
+			if (gltfImage.bufferView < 0) {
+				Log::Error(
+					"GltfLoader", "Failed to find data source for texture for {}, image '{}'!", gltfFile, gltfImage.name);
+				continue;
+			}
+
+			const tinygltf::BufferView& gltfBufferView = gltfModel.bufferViews[gltfImage.bufferView];
+			const uint8_t* data   = gltfBuffers[gltfBufferView.buffer].data() + gltfBufferView.byteOffset;
+			const size_t dataSize = gltfBufferView.byteLength;
+			_threadPool->Submit([&DecodeSharedImage, &FinishDecode, i, data, dataSize]() {
+				FinishDecode(i, DecodeSharedImage(i, data, dataSize));
+			});
+			++decodeCount;
+		}
+		progress->TextureCount = decodeCount;
+
+		// Hand each image to the main thread as soon as it is decoded, which points every texture using it at the upload.
+		size_t decodedCount = 0;
+		size_t sharedCount  = 0;
+		for (uint32_t remaining = decodeCount; remaining > 0; --remaining) {
+			std::unique_lock<std::mutex> lock(decodedMutex);
+			decodedReady.wait(lock, [&]() { return !decodedImages.empty(); });
+			auto [i, decoded] = std::move(decodedImages.front());
+			decodedImages.pop_front();
+			lock.unlock();
+
+			if (!decoded.Shared) {
+				++progress->TexturesLoaded;
+				continue;
+			}
+			if (decoded.Owner && decoded.Mips.empty()) {
+				// Models that already acquired the image fall back to their default textures, and later loads decode it
+				// again themselves.
+				_registry->RemoveImage(decoded.Shared);
+				RunOnMainThread(async, [shared = decoded.Shared, progress]() -> void {
+					shared->Fail();
+					++progress->TexturesLoaded;
+				});
+				continue;
+			}
+			if (!decoded.Owner) {
+				++sharedCount;
+				RunOnMainThread(async, [model, i, shared = decoded.Shared, textures = imageTextures[i], progress]() -> void {
+					model->Images[i] = shared;
+					for (auto& texture : textures) { shared->Attach(texture); }
+					// The owner may still be streaming the image in for another load.
+					shared->WhenReady([progress]() { ++progress->TexturesLoaded; });
+				});
+				continue;
+			}
+			++decodedCount;
+
+			auto image = std::make_shared<DecodedImage>(std::move(decoded));
+			RunOnMainThread(async, [this, async, model, i, image, textures = imageTextures[i], progress]() -> void {
+				model->Images[i] = image->Shared;
+				for (auto& texture : textures) { image->Shared->Attach(texture); }
+
+				std::vector<UploadManager::MipData> mips;
+				for (const auto& mip : image->Mips) { mips.push_back({.Data = mip.Data.data(), .Size = mip.Data.size()}); }
+				const auto imageCI = Vulkan::ImageCreateInfo::Immutable2D(image->Width, image->Height, image->Format, false);
+				// Synchronous loads stage their images straight away rather than spreading them across frames.
+				if (!async) {
+					image->Shared->SetImage(_uploads->CreateImage(imageCI, mips));
+					++progress->TexturesLoaded;
+					return;
+				}
+				_uploads->CreateImageAsync(
+					imageCI, std::move(mips), image, [shared = image->Shared, progress](Vulkan::ImageHandle handle) {
+						shared->SetImage(std::move(handle));
+						++progress->TexturesLoaded;
+					});
+			});
+		}
+		// Reads of images that no material uses may still be finishing, and their callbacks reference this scope.
+		externalReads.Wait();
+
+		const std::chrono::duration<double, std::milli> decodeTime = std::chrono::steady_clock::now() - decodeStart;
+		Log::Info("GltfLoader",
+		          "Decoded {} images for {} in {:.2f}ms using {} threads, sharing {} already resident.",
+		          decodedCount,
+		          gltfFileName,
+		          decodeTime.count(),
+		          _threadPool->GetThreadCount(),
+		          sharedCount);
 	}
 
-	return rootNode;
+	// The upload manager streams images in the order they were queued, so every image queued above is ready once it has
+	// worked through them. Images shared with other loads are uploaded by those, and are waited for separately.
+	RunOnMainThread(async, [this, async, model, progress, gltfFileName, loadStart]() -> void {
+		const auto FinishWhenReady = [model, progress, gltfFileName, loadStart]() -> void {
+			auto pending          = std::make_shared<size_t>(1);
+			const auto FinishLoad = [pending, progress, gltfFileName, loadStart]() -> void {
+				if (--*pending > 0) { return; }
+				progress->Finished = true;
+				const std::chrono::duration<double, std::milli> loadTime = std::chrono::steady_clock::now() - loadStart;
+				Log::Info("GltfLoader", "Loaded {} in {:.2f}ms.", gltfFileName, loadTime.count());
+			};
+			for (const auto& image : model->Images) {
+				if (!image) { continue; }
+				++*pending;
+				image->WhenReady(FinishLoad);
+			}
+			FinishLoad();
+		};
+
+		if (async) {
+			_uploads->QueueCallback(FinishWhenReady);
+		} else {
+			_uploads->Flush();
+			FinishWhenReady();
+		}
+	});
+
+	return true;
 }
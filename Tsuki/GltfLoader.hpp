@@ -5,18 +5,92 @@
 #include <Utility/IntrusivePtr.hpp>
 #include <Utility/ObjectPool.hpp>
 #include <Vulkan/Common.hpp>
+#include <atomic>
+#include <deque>
 #include <filesystem>
+#include <functional>
+#include <future>
 #include <memory>
+#include <mutex>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
+class AssetRegistry;
+class AsyncFileReader;
+class GeometryPool;
+class ThreadPool;
+class UploadManager;
+
+struct GltfLoadOptions {
+	// Store vertices in the compact format described by MeshInfo::CompactLayout.
+	bool CompactVertices = false;
+};
+
+// Progress of a load, updated as it runs. Geometry and the scene entities are created first, then textures are uploaded
+// one by one as they are decoded.
+struct GltfLoadProgress {
+	std::string Name;
+	std::atomic<bool> GeometryLoaded     = false;
+	std::atomic<uint32_t> TextureCount   = 0;
+	std::atomic<uint32_t> TexturesLoaded = 0;
+	// Set once every texture has been uploaded, or the load has failed.
+	std::atomic<bool> Finished = false;
+	std::atomic<bool> Failed   = false;
+
+	// Geometry and textures each count for half of the load.
+	float GetFraction() const;
+};
+
+struct GltfAsyncLoad {
+	Luna::Entity Root;
+	std::shared_ptr<const GltfLoadProgress> Progress;
+};
+
 class GltfLoader {
  public:
-	GltfLoader(Luna::Vulkan::WSI& wsi);
+	GltfLoader(Luna::Vulkan::WSI& wsi,
+	           ThreadPool& threadPool,
+	           GeometryPool& geometryPool,
+	           UploadManager& uploads,
+	           AssetRegistry& registry);
 	~GltfLoader() noexcept;
 
-	Luna::Entity Load(const std::filesystem::path& meshAssetPath, Luna::Scene& scene);
+	// Loads the file before returning, with its images created and their copies submitted, so that textures are ready
+	// for the next frame. Only images shared with a load that is still streaming them arrive later. The root entity is
+	// left without children if the load fails.
+	//
+	// Files that are already resident are not loaded again. Their nodes are instantiated from the meshes, materials and
+	// textures of the earlier load, and images that other resident files share are reused rather than uploaded again.
+	Luna::Entity Load(const std::filesystem::path& meshAssetPath,
+	                  Luna::Scene& scene,
+	                  const GltfLoadOptions& options = {});
+	// Returns the root entity immediately and loads the file on a worker thread. Meshes appear under the root once their
+	// geometry is ready, with default textures in place of the file's own until each of those is uploaded.
+	GltfAsyncLoad LoadAsync(const std::filesystem::path& meshAssetPath,
+	                        Luna::Scene& scene,
+	                        const GltfLoadOptions& options = {});
+
+	// Runs the parts of asynchronous loads that must happen on the main thread. Call once per frame.
+	void Update();
 
  private:
+	bool LoadGltf(const std::filesystem::path& meshAssetPath,
+	              Luna::Scene& scene,
+	              Luna::Entity root,
+	              const GltfLoadOptions& options,
+	              const std::shared_ptr<GltfLoadProgress>& progress,
+	              bool async);
+	void RunOnMainThread(bool async, std::function<void()>&& task);
+	void RunOnMainThreadAndWait(bool async, std::function<void()>&& task);
+
 	Luna::Vulkan::WSI* _wsi;
+	ThreadPool* _threadPool;
+	GeometryPool* _geometryPool;
+	UploadManager* _uploads;
+	AssetRegistry* _registry;
+	std::unique_ptr<AsyncFileReader> _fileReader;
+	std::mutex _mainThreadMutex;
+	std::deque<std::function<void()>> _mainThreadTasks;
+	std::vector<std::future<void>> _asyncLoads;
 };
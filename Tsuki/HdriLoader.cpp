@@ -1,163 +1,563 @@
 #include "HdriLoader.hpp"
 
-#include <stb_image.h>
-
 #include <Utility/Files.hpp>
+#include <Utility/Log.hpp>
+#include <Vulkan/Buffer.hpp>
 #include <Vulkan/CommandBuffer.hpp>
 #include <Vulkan/Device.hpp>
+#include <Vulkan/Fence.hpp>
 #include <Vulkan/Image.hpp>
-#include <Vulkan/RenderPass.hpp>
 #include <Vulkan/Shader.hpp>
 #include <Vulkan/TextureFormat.hpp>
 #include <Vulkan/WSI.hpp>
-#include <glm/glm.hpp>
-#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <vector>
 
+#include "AssetCache.hpp"
+#include "MappedFile.hpp"
+#include "RadianceHdr.hpp"
 #include "SkyboxComponent.hpp"
+#include "SphericalHarmonics.hpp"
+#include "ThreadPool.hpp"
+#include "UploadManager.hpp"
 
 using namespace Luna;
 
-HdriLoader::HdriLoader(Vulkan::WSI& wsi) : _wsi(&wsi) {
-	_cubemapProgram = _wsi->GetDevice().RequestProgram(ReadFile("Assets/Shaders/Cubemap.vert.glsl"),
-	                                                   ReadFile("Assets/Shaders/Cubemap.frag.glsl"));
-}
+// Increment whenever the cached environment layout or the processing that produces it changes.
+static constexpr uint32_t EnvironmentCacheMagic   = 0x564e4554;  // "TENV"
+static constexpr uint32_t EnvironmentCacheVersion = 4;
+static constexpr uint32_t BrdfLutCacheMagic       = 0x44524254;  // "TBRD"
+static constexpr uint32_t BrdfLutCacheVersion     = 1;
 
-HdriLoader::~HdriLoader() noexcept {}
+// The skybox has every mip level down to 1x1.
+static constexpr uint32_t SkyboxSize            = 1024;
+static constexpr uint32_t SkyboxMipLevels       = 11;
+static constexpr vk::Format SkyboxFormat        = vk::Format::eR16G16B16A16Sfloat;
+static constexpr vk::DeviceSize SkyboxTexelSize = 8;
+// The skybox mip chain is written in 32x32 tiles, five levels below each tile at a time, which takes a 1024 skybox from
+// its first level down to 1x1 in exactly two passes.
+static_assert(SkyboxSize == 1024);
 
-Entity HdriLoader::Load(const std::filesystem::path& hdriPath, Scene& scene) {
-	const std::string hdriPathStr = hdriPath.string();
-	const char* hdriPathC         = hdriPathStr.c_str();
-	auto bytes                    = ReadFileBinary(hdriPath);
+// The specular cubemap has one mip level per roughness step, from mirror-like in the first to fully rough in the last.
+static constexpr uint32_t SpecularSize      = 256;
+static constexpr uint32_t SpecularMipLevels = 6;
+
+static constexpr uint32_t BrdfLutSize            = 256;
+static constexpr uint32_t BrdfLutSampleCount     = 1024;
+static constexpr vk::Format BrdfLutFormat        = vk::Format::eR16G16Sfloat;
+static constexpr vk::DeviceSize BrdfLutTexelSize = 4;
 
-	int width, height, components;
-	stbi_set_flip_vertically_on_load(1);
-	auto pixels = stbi_loadf_from_memory(bytes.data(), bytes.size(), &width, &height, &components, STBI_rgb_alpha);
+// Panoramas are decoded and uploaded in strips of roughly this many bytes.
+static constexpr vk::DeviceSize EquirectStripSize = 8ull * 1024 * 1024;
 
-	const Vulkan::ImageInitialData initialData{.Data = pixels};
-	const auto imageCI = Vulkan::ImageCreateInfo::Immutable2D(width, height, vk::Format::eR32G32B32A32Sfloat);
-	auto baseHdr       = _wsi->GetDevice().CreateImage(imageCI, &initialData);
+struct EquirectStrip {
+	std::vector<uint32_t> Texels;
+	SphericalHarmonics::Coefficients Radiance = {};
+};
 
+static Vulkan::ImageCreateInfo CubeImageCreateInfo(uint32_t size, vk::Format format) {
 	Vulkan::ImageCreateInfo cubeImageCI{.Domain        = Vulkan::ImageDomain::Physical,
-	                                    .Format        = vk::Format::eR16G16B16A16Sfloat,
-	                                    .InitialLayout = vk::ImageLayout::eTransferDstOptimal,
+	                                    .Format        = format,
+	                                    .InitialLayout = vk::ImageLayout::eGeneral,
 	                                    .Samples       = vk::SampleCountFlagBits::e1,
 	                                    .Type          = vk::ImageType::e2D,
-	                                    .Usage  = vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst,
-	                                    .Width  = 1,
-	                                    .Height = 1,
+	                                    .Usage  = vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eStorage,
+	                                    .Width  = size,
+	                                    .Height = size,
 	                                    .Depth  = 1,
 	                                    .ArrayLayers = 6,
 	                                    .MipLevels   = 1,
 	                                    .Flags       = vk::ImageCreateFlagBits::eCubeCompatible};
-	cubeImageCI.Width  = 1024;
-	cubeImageCI.Height = 1024;
-	cubeImageCI.MipLevels =
-		Vulkan::TextureFormatLayout::MipLevels(cubeImageCI.Width, cubeImageCI.Height, cubeImageCI.Depth);
-	auto skybox = _wsi->GetDevice().CreateImage(cubeImageCI);
-
-	Vulkan::ImageHandle renderTarget;
-	{
-		auto imageCI = Vulkan::ImageCreateInfo::RenderTarget(
-			skybox->GetCreateInfo().Width, skybox->GetCreateInfo().Height, vk::Format::eR16G16B16A16Sfloat);
-		imageCI.Usage = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc;
-		renderTarget  = _wsi->GetDevice().CreateImage(imageCI);
+	cubeImageCI.MipLevels = Vulkan::TextureFormatLayout::MipLevels(size, size, 1);
+
+	return cubeImageCI;
+}
+
+struct PrefilterPushConstant {
+	uint32_t Size;
+	uint32_t SampleCount;
+	float Roughness;
+	float EnvSize;
+};
+
+struct BrdfLutPushConstant {
+	uint32_t Size;
+	uint32_t SampleCount;
+};
+
+// The size of one mip level of a cubemap, with all six faces packed one after another.
+static vk::DeviceSize GetCubeMipSize(uint32_t size, uint32_t mip) {
+	const vk::DeviceSize mipSize = std::max(size >> mip, 1u);
+
+	return mipSize * mipSize * SkyboxTexelSize * 6;
+}
+
+// Returns the copies of every mip level of a cubemap into a buffer, packed one after another from offset, and moves
+// offset past the end of them.
+static std::vector<vk::BufferImageCopy> GetCubeCopies(const Vulkan::ImageCreateInfo& cubeImageCI,
+                                                      vk::DeviceSize& offset) {
+	std::vector<vk::BufferImageCopy> copies(cubeImageCI.MipLevels);
+	for (uint32_t mip = 0; mip < cubeImageCI.MipLevels; ++mip) {
+		const uint32_t mipSize = std::max(cubeImageCI.Width >> mip, 1u);
+		copies[mip]            = vk::BufferImageCopy(
+			offset,
+			0,
+			0,
+			vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, mip, 0, 6),
+			vk::Offset3D(0, 0, 0),
+			vk::Extent3D(mipSize, mipSize, 1));
+		offset += GetCubeMipSize(cubeImageCI.Width, mip);
 	}
 
-	auto cmdBuf = _wsi->GetDevice().RequestCommandBuffer(Vulkan::CommandBufferType::AsyncGraphics);
-
-	glm::mat4 captureProjection    = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 10.0f);
-	const glm::mat4 captureViews[] = {
-		glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)),
-		glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)),
-		glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f)),
-		glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f)),
-		glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, -1.0f, 0.0f)),
-		glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, -1.0f, 0.0f))};
-	struct PushConstant {
-		glm::mat4 ViewProjection;
-		float Roughness;
-	};
+	return copies;
+}
 
-	const auto ProcessCubeMap = [&](Vulkan::Program* program,
-	                                Vulkan::ImageHandle& srcCubeMap,
-	                                Vulkan::ImageHandle& dstCubeMap) {
-		auto rpInfo                 = Vulkan::RenderPassInfo{};
-		rpInfo.ColorAttachmentCount = 1;
-		rpInfo.ColorAttachments[0]  = &renderTarget->GetView();
-		rpInfo.StoreAttachments     = 1 << 0;
-
-		const uint32_t mips = dstCubeMap->GetCreateInfo().MipLevels;
-		const uint32_t dim  = dstCubeMap->GetCreateInfo().Width;
-
-		for (uint32_t mip = 0; mip < mips; ++mip) {
-			const uint32_t mipDim = static_cast<float>(dim * std::pow(0.5f, mip));
-
-			for (uint32_t i = 0; i < 6; ++i) {
-				const PushConstant pc{.ViewProjection = captureProjection * captureViews[i],
-				                      .Roughness      = static_cast<float>(mip) / static_cast<float>(mips - 1)};
-				rpInfo.RenderArea = vk::Rect2D{{0, 0}, {mipDim, mipDim}};
-				cmdBuf->BeginRenderPass(rpInfo);
-				cmdBuf->SetProgram(program);
-				cmdBuf->SetCullMode(vk::CullModeFlagBits::eNone);
-				cmdBuf->SetTexture(0, 0, srcCubeMap->GetView(), Vulkan::StockSampler::LinearClamp);
-				cmdBuf->PushConstants(&pc, 0, sizeof(pc));
-				cmdBuf->Draw(36);
-				cmdBuf->EndRenderPass();
-
-				const vk::ImageMemoryBarrier barrier(vk::AccessFlagBits::eColorAttachmentWrite,
-				                                     vk::AccessFlagBits::eTransferRead,
-				                                     vk::ImageLayout::eColorAttachmentOptimal,
-				                                     vk::ImageLayout::eTransferSrcOptimal,
-				                                     VK_QUEUE_FAMILY_IGNORED,
-				                                     VK_QUEUE_FAMILY_IGNORED,
-				                                     renderTarget->GetImage(),
-				                                     vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1));
-				cmdBuf->Barrier(
-					vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::PipelineStageFlagBits::eTransfer, {}, {}, {barrier});
-
-				cmdBuf->CopyImage(*dstCubeMap,
-				                  *renderTarget,
-				                  {},
-				                  {},
-				                  vk::Extent3D(mipDim, mipDim, 1),
-				                  vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, mip, i, 1),
-				                  vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1));
-
-				const vk::ImageMemoryBarrier barrier2(vk::AccessFlagBits::eTransferWrite,
-				                                      vk::AccessFlagBits::eColorAttachmentWrite,
-				                                      vk::ImageLayout::eTransferSrcOptimal,
-				                                      vk::ImageLayout::eColorAttachmentOptimal,
-				                                      VK_QUEUE_FAMILY_IGNORED,
-				                                      VK_QUEUE_FAMILY_IGNORED,
-				                                      renderTarget->GetImage(),
-				                                      vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1));
-				cmdBuf->Barrier(
-					vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eColorAttachmentOutput, {}, {}, {barrier2});
-			}
+// A cached environment is its irradiance, then both cubemaps as their size and mip count followed by every mip level.
+// Parsed mip levels point into the file data.
+struct CachedEnvironment {
+	SphericalHarmonics::Coefficients IrradianceSH = {};
+	std::vector<UploadManager::MipData> SkyboxMips;
+	std::vector<UploadManager::MipData> SpecularMips;
+};
+
+static std::vector<uint8_t> WriteEnvironmentCache(const SphericalHarmonics::Coefficients& irradianceSH,
+                                                  const void* skyboxData,
+                                                  vk::DeviceSize skyboxBytes,
+                                                  const void* specularData,
+                                                  vk::DeviceSize specularBytes) {
+	AssetCache::Writer writer;
+	writer.Write(EnvironmentCacheMagic);
+	writer.Write(EnvironmentCacheVersion);
+	writer.Write(static_cast<int32_t>(SkyboxFormat));
+	writer.Write(irradianceSH);
+	writer.Write(SkyboxSize);
+	writer.Write(SkyboxMipLevels);
+	writer.Write(skyboxData, skyboxBytes);
+	writer.Write(SpecularSize);
+	writer.Write(SpecularMipLevels);
+	writer.Write(specularData, specularBytes);
+
+	return writer.TakeData();
+}
+
+static bool ParseEnvironmentCache(const std::vector<uint8_t>& data, CachedEnvironment& cached) {
+	AssetCache::Reader reader(data.data(), data.size());
+
+	uint32_t magic, version;
+	int32_t format;
+	if (!reader.Read(magic) || !reader.Read(version) || !reader.Read(format)) { return false; }
+	if (magic != EnvironmentCacheMagic || version != EnvironmentCacheVersion) { return false; }
+	if (static_cast<vk::Format>(format) != SkyboxFormat) { return false; }
+	if (!reader.Read(cached.IrradianceSH)) { return false; }
+
+	const auto ReadCube =
+		[&](uint32_t expectedSize, uint32_t expectedMipCount, std::vector<UploadManager::MipData>& mips) -> bool {
+		uint32_t size, mipCount;
+		if (!reader.Read(size) || !reader.Read(mipCount)) { return false; }
+		if (size != expectedSize || mipCount != expectedMipCount) { return false; }
+
+		mips.resize(mipCount);
+		for (uint32_t mip = 0; mip < mipCount; ++mip) {
+			mips[mip].Size = GetCubeMipSize(size, mip);
+			mips[mip].Data = reader.ReadBytes(mips[mip].Size);
+			if (mips[mip].Data == nullptr) { return false; }
 		}
 
-		const vk::ImageMemoryBarrier barrier(
-			vk::AccessFlagBits::eTransferWrite,
-			vk::AccessFlagBits::eShaderRead,
-			vk::ImageLayout::eTransferDstOptimal,
-			vk::ImageLayout::eShaderReadOnlyOptimal,
-			VK_QUEUE_FAMILY_IGNORED,
-			VK_QUEUE_FAMILY_IGNORED,
-			dstCubeMap->GetImage(),
-			vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, dstCubeMap->GetCreateInfo().MipLevels, 0, 6));
-		cmdBuf->Barrier(
-			vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader, {}, {}, {barrier});
+		return true;
 	};
 
-	ProcessCubeMap(_cubemapProgram, baseHdr, skybox);
+	return ReadCube(SkyboxSize, SkyboxMipLevels, cached.SkyboxMips) &&
+	       ReadCube(SpecularSize, SpecularMipLevels, cached.SpecularMips);
+}
+
+// Checks that a cached environment reads back as it was written, by writing what was read again and comparing the two.
+// The mip levels of each cubemap are read one after another, so they are written again as one block.
+static bool VerifyEnvironmentCache(const std::vector<uint8_t>& data) {
+	CachedEnvironment cached;
+	if (!ParseEnvironmentCache(data, cached)) { return false; }
+
+	const auto GetCubeBytes = [](const std::vector<UploadManager::MipData>& mips) -> vk::DeviceSize {
+		vk::DeviceSize bytes = 0;
+		for (const auto& mip : mips) { bytes += mip.Size; }
+		return bytes;
+	};
+
+	return WriteEnvironmentCache(cached.IrradianceSH,
+	                             cached.SkyboxMips[0].Data,
+	                             GetCubeBytes(cached.SkyboxMips),
+	                             cached.SpecularMips[0].Data,
+	                             GetCubeBytes(cached.SpecularMips)) == data;
+}
 
-	renderTarget.Reset();
+// Samples between mip levels, for reading the skybox at the level of detail each sample covers.
+static Vulkan::SamplerCreateInfo TrilinearClampSamplerCreateInfo() {
+	return Vulkan::SamplerCreateInfo{.MagFilter        = vk::Filter::eLinear,
+	                                 .MinFilter        = vk::Filter::eLinear,
+	                                 .MipmapMode       = vk::SamplerMipmapMode::eLinear,
+	                                 .AddressModeU     = vk::SamplerAddressMode::eClampToEdge,
+	                                 .AddressModeV     = vk::SamplerAddressMode::eClampToEdge,
+	                                 .AddressModeW     = vk::SamplerAddressMode::eClampToEdge,
+	                                 .MipLodBias       = 0.0f,
+	                                 .AnisotropyEnable = VK_FALSE,
+	                                 .MaxAnisotropy    = 1.0f,
+	                                 .MinLod           = 0.0f,
+	                                 .MaxLod           = VK_LOD_CLAMP_NONE,
+	                                 .BorderColor      = vk::BorderColor::eFloatOpaqueWhite};
+}
+
+HdriLoader::HdriLoader(Vulkan::WSI& wsi, ThreadPool& threadPool, UploadManager& uploads)
+		: _wsi(&wsi), _threadPool(&threadPool), _uploads(&uploads) {
+	auto& device       = _wsi->GetDevice();
+	_equirectToCube    = device.RequestProgram(ReadFile("Assets/Shaders/EquirectToCube.comp.glsl"));
+	_downsampleCube    = device.RequestProgram(ReadFile("Assets/Shaders/DownsampleCube.comp.glsl"));
+	_prefilterSpecular = device.RequestProgram(ReadFile("Assets/Shaders/PrefilterSpecular.comp.glsl"));
+	_brdfLutProgram    = device.RequestProgram(ReadFile("Assets/Shaders/BrdfLut.comp.glsl"));
+}
 
-	_wsi->GetDevice().Submit(cmdBuf);
+HdriLoader::~HdriLoader() noexcept {}
 
-	auto sky       = scene.CreateEntity("Sky");
-	auto& cSkybox  = sky.AddComponent<SkyboxComponent>();
-	cSkybox.Skybox = skybox;
+Entity HdriLoader::Load(const std::filesystem::path& hdriPath, Scene& scene) {
+	const auto loadStart = std::chrono::steady_clock::now();
+	const auto hdriFile  = hdriPath.string();
+	auto sky             = scene.CreateEntity("Sky");
+
+	MappedFile hdriMapping(hdriPath);
+	if (!hdriMapping.IsValid()) {
+		Log::Error("HdriLoader", "Failed to open environment {}.", hdriFile);
+		return sky;
+	}
+
+	// The processed environment is cached on disk, keyed by the source file and the resolution it was processed at.
+	const uint64_t cacheKey = AssetCache::Hash(
+		hdriMapping.GetData(), hdriMapping.GetSize(), (uint64_t(EnvironmentCacheVersion) << 32) | SkyboxSize);
+	const auto cachePath = AssetCache::GetPath("Environments", cacheKey, ".env");
+
+	Environment environment;
+	std::vector<uint8_t> cacheData;
+	if (AssetCache::Read(cachePath, cacheData)) { environment = ReadCache(cacheData); }
+	if (environment.Skybox) {
+		Log::Info("HdriLoader", "Using cached environment for {} from {}.", hdriFile, cachePath.string());
+	} else {
+		environment = Convert(hdriMapping.GetData(), hdriMapping.GetSize(), cachePath);
+	}
+
+	if (!environment.Skybox) {
+		Log::Error("HdriLoader", "Failed to load environment {}.", hdriFile);
+		return sky;
+	}
+
+	auto& cSkybox        = sky.AddComponent<SkyboxComponent>();
+	cSkybox.Skybox       = environment.Skybox;
+	cSkybox.Specular     = environment.Specular;
+	cSkybox.BrdfLut      = GetBrdfLut();
+	cSkybox.IrradianceSH = environment.IrradianceSH;
+
+	const std::chrono::duration<double, std::milli> loadTime = std::chrono::steady_clock::now() - loadStart;
+	Log::Info("HdriLoader", "Loaded {} in {:.2f}ms.", hdriFile, loadTime.count());
 
 	return sky;
 }
+
+HdriLoader::Environment HdriLoader::ReadCache(const std::vector<uint8_t>& data) {
+	CachedEnvironment cached;
+	if (!ParseEnvironmentCache(data, cached)) { return {}; }
+
+	// Cached cubemaps are only ever sampled.
+	auto skyboxCI        = CubeImageCreateInfo(SkyboxSize, SkyboxFormat);
+	skyboxCI.Usage       = vk::ImageUsageFlagBits::eSampled;
+	auto specularCI      = CubeImageCreateInfo(SpecularSize, SkyboxFormat);
+	specularCI.Usage     = vk::ImageUsageFlagBits::eSampled;
+	specularCI.MipLevels = SpecularMipLevels;
+
+	return Environment{.Skybox       = _uploads->CreateImage(skyboxCI, cached.SkyboxMips),
+	                   .Specular     = _uploads->CreateImage(specularCI, cached.SpecularMips),
+	                   .IrradianceSH = cached.IrradianceSH};
+}
+
+Vulkan::ImageHandle HdriLoader::UploadEquirect(const uint8_t* hdrData,
+                                               size_t hdrSize,
+                                               SphericalHarmonics::Coefficients& radiance) {
+	const RadianceHdr hdr(hdrData, hdrSize);
+	if (!hdr.IsValid()) { return {}; }
+	const uint32_t width  = hdr.GetWidth();
+	const uint32_t height = hdr.GetHeight();
+
+	auto imageCI          = Vulkan::ImageCreateInfo::Immutable2D(width, height, vk::Format::eE5B9G9R9UfloatPack32, false);
+	imageCI.InitialLayout = vk::ImageLayout::eTransferDstOptimal;
+	imageCI.Usage |= vk::ImageUsageFlagBits::eTransferDst;
+	auto equirect = _wsi->GetDevice().CreateImage(imageCI);
+
+	// Strips are decoded on the thread pool, a few ahead of the one being uploaded, so that only those few are ever held
+	// in memory and the upload streams through the staging ring as they finish. Each strip is also projected onto
+	// spherical harmonics while its texels are at hand, and the strips' projections are summed up here.
+	const uint32_t stripRows   = uint32_t(std::clamp<vk::DeviceSize>(EquirectStripSize / (width * 4), 1, height));
+	const uint32_t stripCount  = (height + stripRows - 1) / stripRows;
+	const uint32_t decodeAhead = std::max(_threadPool->GetThreadCount(), 1u);
+	std::deque<std::future<EquirectStrip>> strips;
+	uint32_t nextStrip = 0;
+	bool failed        = false;
+	for (uint32_t strip = 0; strip < stripCount; ++strip) {
+		for (; !failed && nextStrip < stripCount && nextStrip < strip + decodeAhead; ++nextStrip) {
+			const uint32_t firstRow = nextStrip * stripRows;
+			const uint32_t rowCount = std::min(stripRows, height - firstRow);
+			strips.push_back(_threadPool->Submit([&hdr, firstRow, rowCount]() {
+				EquirectStrip decoded;
+				decoded.Texels.resize(size_t(rowCount) * hdr.GetWidth());
+				if (!hdr.DecodeRows(firstRow, rowCount, decoded.Texels.data())) {
+					decoded.Texels.clear();
+				} else {
+					SphericalHarmonics::ProjectEquirectRows(
+						decoded.Texels.data(), hdr.GetWidth(), hdr.GetHeight(), firstRow, rowCount, decoded.Radiance);
+				}
+
+				return decoded;
+			}));
+		}
+
+		// Every strip has to be waited on before returning, since they reference the decoder.
+		if (strips.empty()) { break; }
+		const auto decoded = strips.front().get();
+		strips.pop_front();
+		if (decoded.Texels.empty()) { failed = true; }
+		if (failed) { continue; }
+		for (size_t i = 0; i < radiance.size(); ++i) { radiance[i] += decoded.Radiance[i]; }
+
+		const uint32_t firstRow = strip * stripRows;
+		const uint32_t rowCount = std::min(stripRows, height - firstRow);
+		const vk::BufferImageCopy region(0,
+		                                 0,
+		                                 0,
+		                                 vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1),
+		                                 vk::Offset3D(0, firstRow, 0),
+		                                 vk::Extent3D(width, rowCount, 1));
+		_uploads->UploadImage(*equirect, region, decoded.Texels.data(), decoded.Texels.size() * sizeof(uint32_t));
+	}
+	if (failed) { return {}; }
+
+	return equirect;
+}
+
+HdriLoader::Environment HdriLoader::Convert(const uint8_t* hdrData,
+                                            size_t hdrSize,
+                                            const std::filesystem::path& cachePath) {
+	auto& device = _wsi->GetDevice();
+
+	// The panorama is uploaded as E5B9G9R9, at a quarter of the size of 32-bit floats, and its diffuse lighting is
+	// projected onto spherical harmonics on the way.
+	SphericalHarmonics::Coefficients radiance = {};
+	auto equirect                             = UploadEquirect(hdrData, hdrSize, radiance);
+	if (!equirect) { return {}; }
+	const auto irradianceSH = SphericalHarmonics::RadianceToIrradiance(radiance);
+
+	// The cubemaps are written directly by compute shaders covering all six faces, so they need no render targets and no
+	// copies.
+	auto skyboxCI = CubeImageCreateInfo(SkyboxSize, SkyboxFormat);
+	skyboxCI.Usage |= vk::ImageUsageFlagBits::eTransferSrc;
+	auto skybox = device.CreateImage(skyboxCI);
+
+	auto specularCI      = CubeImageCreateInfo(SpecularSize, SkyboxFormat);
+	specularCI.MipLevels = SpecularMipLevels;
+	specularCI.Usage |= vk::ImageUsageFlagBits::eTransferSrc;
+	auto specular = device.CreateImage(specularCI);
+
+	// The conversion runs on the graphics queue, so that it is ordered after the upload of the source image.
+	auto cmdBuf = device.RequestCommandBuffer();
+	cmdBuf->ImageBarrier(*equirect,
+	                     vk::ImageLayout::eTransferDstOptimal,
+	                     vk::ImageLayout::eShaderReadOnlyOptimal,
+	                     vk::PipelineStageFlagBits::eTransfer,
+	                     vk::AccessFlagBits::eTransferWrite,
+	                     vk::PipelineStageFlagBits::eComputeShader,
+	                     vk::AccessFlagBits::eShaderRead);
+
+	std::vector<Vulkan::ImageViewHandle> mipViews;
+	const auto SetMipTarget = [&](uint32_t binding, const Vulkan::ImageHandle& image, vk::Format format, uint32_t mip) {
+		const Vulkan::ImageViewCreateInfo viewCI{.Image          = image.Get(),
+		                                         .Format         = format,
+		                                         .BaseMipLevel   = mip,
+		                                         .MipLevels      = 1,
+		                                         .BaseArrayLayer = 0,
+		                                         .ArrayLayers    = 6,
+		                                         .Type           = vk::ImageViewType::e2DArray};
+		mipViews.push_back(device.CreateImageView(viewCI));
+		cmdBuf->SetStorageTexture(0, binding, *mipViews.back());
+	};
+
+	// Every skybox level is averaged from the one above it, since the smaller levels are what the prefiltering below
+	// reads its wider lobes from, and sampling them straight from the panorama would alias. The first dispatch samples
+	// the panorama into the first level and averages it down into the next five, and the second averages the sixth level
+	// down into the last five. The levels below each 32x32 tile are reduced in shared memory, so the whole chain takes
+	// these two dispatches with one barrier between them, rather than a dispatch and a barrier per level.
+	cmdBuf->SetProgram(_equirectToCube);
+	cmdBuf->SetTexture(0, 0, equirect->GetView(), Vulkan::StockSampler::LinearClamp);
+	for (uint32_t mip = 0; mip < 6; ++mip) { SetMipTarget(1 + mip, skybox, skyboxCI.Format, mip); }
+	cmdBuf->PushConstants(&SkyboxSize, 0, sizeof(SkyboxSize));
+	cmdBuf->Dispatch(SkyboxSize / 32, SkyboxSize / 32, 6);
+
+	cmdBuf->ImageBarrier(*skybox,
+	                     vk::ImageLayout::eGeneral,
+	                     vk::ImageLayout::eGeneral,
+	                     vk::PipelineStageFlagBits::eComputeShader,
+	                     vk::AccessFlagBits::eShaderWrite,
+	                     vk::PipelineStageFlagBits::eComputeShader,
+	                     vk::AccessFlagBits::eShaderRead);
+	cmdBuf->SetProgram(_downsampleCube);
+	SetMipTarget(0, skybox, skyboxCI.Format, 5);
+	for (uint32_t mip = 6; mip < skyboxCI.MipLevels; ++mip) { SetMipTarget(mip - 5, skybox, skyboxCI.Format, mip); }
+	cmdBuf->Dispatch(1, 1, 6);
+
+	// The specular cubemap is prefiltered from every mip level of the skybox, one roughness per mip level. Rougher lobes
+	// cover more of the sphere and get more samples, while the mirror-like first level is just a copy.
+	cmdBuf->ImageBarrier(*skybox,
+	                     vk::ImageLayout::eGeneral,
+	                     vk::ImageLayout::eShaderReadOnlyOptimal,
+	                     vk::PipelineStageFlagBits::eComputeShader,
+	                     vk::AccessFlagBits::eShaderWrite,
+	                     vk::PipelineStageFlagBits::eComputeShader,
+	                     vk::AccessFlagBits::eShaderRead);
+	cmdBuf->SetProgram(_prefilterSpecular);
+	cmdBuf->SetTexture(0, 0, skybox->GetView(), device.RequestSampler(TrilinearClampSamplerCreateInfo()));
+	for (uint32_t mip = 0; mip < specularCI.MipLevels; ++mip) {
+		const PrefilterPushConstant pc{.Size        = std::max(specularCI.Width >> mip, 1u),
+		                               .SampleCount = mip == 0 ? 1u : std::min(32u << mip, 1024u),
+		                               .Roughness   = float(mip) / float(specularCI.MipLevels - 1),
+		                               .EnvSize     = float(skyboxCI.Width)};
+		SetMipTarget(1, specular, specularCI.Format, mip);
+		cmdBuf->PushConstants(&pc, 0, sizeof(pc));
+		cmdBuf->Dispatch((pc.Size + 7) / 8, (pc.Size + 7) / 8, 6);
+	}
+
+	// Every mip level of both cubemaps is read back as well, to be written to the cache once the GPU is done.
+	vk::DeviceSize readbackSize      = 0;
+	const auto skyboxCopies          = GetCubeCopies(skyboxCI, readbackSize);
+	const vk::DeviceSize skyboxBytes = readbackSize;
+	const auto specularCopies        = GetCubeCopies(specularCI, readbackSize);
+	auto readback                    = device.CreateBuffer(
+		Vulkan::BufferCreateInfo(Vulkan::BufferDomain::Host, readbackSize, vk::BufferUsageFlagBits::eTransferDst));
+
+	cmdBuf->ImageBarrier(*skybox,
+	                     vk::ImageLayout::eShaderReadOnlyOptimal,
+	                     vk::ImageLayout::eTransferSrcOptimal,
+	                     vk::PipelineStageFlagBits::eComputeShader,
+	                     vk::AccessFlagBits::eShaderRead,
+	                     vk::PipelineStageFlagBits::eTransfer,
+	                     vk::AccessFlagBits::eTransferRead);
+	cmdBuf->ImageBarrier(*specular,
+	                     vk::ImageLayout::eGeneral,
+	                     vk::ImageLayout::eTransferSrcOptimal,
+	                     vk::PipelineStageFlagBits::eComputeShader,
+	                     vk::AccessFlagBits::eShaderWrite,
+	                     vk::PipelineStageFlagBits::eTransfer,
+	                     vk::AccessFlagBits::eTransferRead);
+	cmdBuf->CopyImageToBuffer(*readback, *skybox, skyboxCopies);
+	cmdBuf->CopyImageToBuffer(*readback, *specular, specularCopies);
+	for (const auto& image : {skybox, specular}) {
+		cmdBuf->ImageBarrier(*image,
+		                     vk::ImageLayout::eTransferSrcOptimal,
+		                     vk::ImageLayout::eShaderReadOnlyOptimal,
+		                     vk::PipelineStageFlagBits::eTransfer,
+		                     vk::AccessFlagBits::eTransferRead,
+		                     vk::PipelineStageFlagBits::eFragmentShader | vk::PipelineStageFlagBits::eComputeShader,
+		                     vk::AccessFlagBits::eShaderRead);
+	}
+
+	_uploads->Flush();
+	Vulkan::FenceHandle fence;
+	device.Submit(cmdBuf, &fence);
+	mipViews.clear();
+
+	// Only the first launch with a new environment pays for this wait.
+	fence->Wait();
+	const auto* readbackData = static_cast<const uint8_t*>(readback->Map());
+	const auto cacheData     = WriteEnvironmentCache(
+		irradianceSH, readbackData, skyboxBytes, readbackData + skyboxBytes, readbackSize - skyboxBytes);
+	if (!VerifyEnvironmentCache(cacheData)) {
+		Log::Error("HdriLoader", "Environment cache entry {} does not read back as written.", cachePath.string());
+	} else if (!AssetCache::Write(cachePath, cacheData.data(), cacheData.size())) {
+		Log::Warning("HdriLoader", "Failed to write environment cache entry {}.", cachePath.string());
+	}
+
+	return Environment{.Skybox = skybox, .Specular = specular, .IrradianceSH = irradianceSH};
+}
+
+const Vulkan::ImageHandle& HdriLoader::GetBrdfLut() {
+	if (_brdfLut) { return _brdfLut; }
+
+	auto& device                  = _wsi->GetDevice();
+	auto lutCI                    = Vulkan::ImageCreateInfo::Immutable2D(BrdfLutSize, BrdfLutSize, BrdfLutFormat, false);
+	const vk::DeviceSize lutBytes = vk::DeviceSize(BrdfLutSize) * BrdfLutSize * BrdfLutTexelSize;
+
+	// The table does not depend on the environment, only on the constants it is built with, so its key is fixed.
+	const auto cachePath =
+		AssetCache::GetPath("Environments", (uint64_t(BrdfLutCacheVersion) << 32) | BrdfLutSize, ".lut");
+	std::vector<uint8_t> cacheData;
+	if (AssetCache::Read(cachePath, cacheData)) {
+		AssetCache::Reader reader(cacheData.data(), cacheData.size());
+
+		uint32_t magic, version, size;
+		if (reader.Read(magic) && reader.Read(version) && reader.Read(size) && magic == BrdfLutCacheMagic &&
+		    version == BrdfLutCacheVersion && size == BrdfLutSize) {
+			const UploadManager::MipData lutData{.Data = reader.ReadBytes(lutBytes), .Size = lutBytes};
+			if (lutData.Data) {
+				_brdfLut = _uploads->CreateImage(lutCI, {lutData});
+
+				return _brdfLut;
+			}
+		}
+	}
+
+	lutCI.InitialLayout = vk::ImageLayout::eGeneral;
+	lutCI.Usage |= vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eTransferSrc;
+	_brdfLut      = device.CreateImage(lutCI);
+	auto readback = device.CreateBuffer(
+		Vulkan::BufferCreateInfo(Vulkan::BufferDomain::Host, lutBytes, vk::BufferUsageFlagBits::eTransferDst));
+
+	const BrdfLutPushConstant pc{.Size = BrdfLutSize, .SampleCount = BrdfLutSampleCount};
+	auto cmdBuf = device.RequestCommandBuffer();
+	cmdBuf->SetProgram(_brdfLutProgram);
+	cmdBuf->SetStorageTexture(0, 0, _brdfLut->GetView());
+	cmdBuf->PushConstants(&pc, 0, sizeof(pc));
+	cmdBuf->Dispatch((BrdfLutSize + 7) / 8, (BrdfLutSize + 7) / 8, 1);
+
+	cmdBuf->ImageBarrier(*_brdfLut,
+	                     vk::ImageLayout::eGeneral,
+	                     vk::ImageLayout::eTransferSrcOptimal,
+	                     vk::PipelineStageFlagBits::eComputeShader,
+	                     vk::AccessFlagBits::eShaderWrite,
+	                     vk::PipelineStageFlagBits::eTransfer,
+	                     vk::AccessFlagBits::eTransferRead);
+	const vk::BufferImageCopy copy(0,
+	                               0,
+	                               0,
+	                               vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1),
+	                               vk::Offset3D(0, 0, 0),
+	                               vk::Extent3D(BrdfLutSize, BrdfLutSize, 1));
+	cmdBuf->CopyImageToBuffer(*readback, *_brdfLut, {copy});
+	cmdBuf->ImageBarrier(*_brdfLut,
+	                     vk::ImageLayout::eTransferSrcOptimal,
+	                     vk::ImageLayout::eShaderReadOnlyOptimal,
+	                     vk::PipelineStageFlagBits::eTransfer,
+	                     vk::AccessFlagBits::eTransferRead,
+	                     vk::PipelineStageFlagBits::eFragmentShader,
+	                     vk::AccessFlagBits::eShaderRead);
+
+	Vulkan::FenceHandle fence;
+	device.Submit(cmdBuf, &fence);
+
+	// Built once per cache, so the wait is only paid on the very first launch.
+	fence->Wait();
+	AssetCache::Writer writer;
+	writer.Write(BrdfLutCacheMagic);
+	writer.Write(BrdfLutCacheVersion);
+	writer.Write(BrdfLutSize);
+	writer.Write(readback->Map(), lutBytes);
+	if (!AssetCache::Write(cachePath, writer.GetData().data(), writer.GetData().size())) {
+		Log::Warning("HdriLoader", "Failed to write BRDF lookup table cache entry {}.", cachePath.string());
+	}
+
+	return _brdfLut;
+}
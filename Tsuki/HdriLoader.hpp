@@ -3,16 +3,45 @@
 #include <Scene/Entity.hpp>
 #include <Vulkan/Common.hpp>
 #include <filesystem>
+#include <vector>
+
+#include "SphericalHarmonics.hpp"
+
+class ThreadPool;
+class UploadManager;
 
 class HdriLoader {
  public:
-	HdriLoader(Luna::Vulkan::WSI& wsi);
+	HdriLoader(Luna::Vulkan::WSI& wsi, ThreadPool& threadPool, UploadManager& uploads);
 	~HdriLoader() noexcept;
 
+	// Converts the equirectangular image into a cubemap skybox, a cubemap prefiltered for specular lighting and the
+	// spherical harmonics of its diffuse lighting, or reads them from the cache if it was converted before.
 	Luna::Entity Load(const std::filesystem::path& hdriPath, Luna::Scene& scene);
 
  private:
+	struct Environment {
+		Luna::Vulkan::ImageHandle Skybox;
+		Luna::Vulkan::ImageHandle Specular;
+		SphericalHarmonics::Coefficients IrradianceSH = {};
+	};
+
+	Environment ReadCache(const std::vector<uint8_t>& data);
+	Environment Convert(const uint8_t* hdrData, size_t hdrSize, const std::filesystem::path& cachePath);
+	// Uploads the panorama, and adds the projection of its radiance onto spherical harmonics to radiance.
+	Luna::Vulkan::ImageHandle UploadEquirect(const uint8_t* hdrData,
+	                                         size_t hdrSize,
+	                                         SphericalHarmonics::Coefficients& radiance);
+	// Builds the split-sum BRDF lookup table the first time it is needed, or reads it from the cache.
+	const Luna::Vulkan::ImageHandle& GetBrdfLut();
+
 	Luna::Vulkan::WSI* _wsi;
+	ThreadPool* _threadPool;
+	UploadManager* _uploads;
 
-	Luna::Vulkan::Program* _cubemapProgram = nullptr;
+	Luna::Vulkan::Program* _equirectToCube    = nullptr;
+	Luna::Vulkan::Program* _downsampleCube    = nullptr;
+	Luna::Vulkan::Program* _prefilterSpecular = nullptr;
+	Luna::Vulkan::Program* _brdfLutProgram    = nullptr;
+	Luna::Vulkan::ImageHandle _brdfLut;
 };
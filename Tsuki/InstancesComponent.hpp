@@ -0,0 +1,14 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+
+// Draws the entity's mesh once for every transform, each relative to the entity's own transform. The entity's mesh
+// bounds cover all of its instances, so culling treats them as one object.
+struct InstancesComponent {
+	InstancesComponent()                          = default;
+	InstancesComponent(const InstancesComponent&) = default;
+
+	std::shared_ptr<const std::vector<glm::mat4>> Transforms;
+};
@@ -0,0 +1,59 @@
+#include "MappedFile.hpp"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h>
+
+MappedFile::MappedFile(const std::filesystem::path& path) {
+	HANDLE file = CreateFileW(
+		path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE) { return; }
+	_file = file;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) { return; }
+
+	_mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (_mapping == nullptr) { return; }
+
+	_data = static_cast<const uint8_t*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+	if (_data) { _size = static_cast<size_t>(size.QuadPart); }
+}
+
+MappedFile::~MappedFile() noexcept {
+	if (_data) { UnmapViewOfFile(_data); }
+	if (_mapping) { CloseHandle(_mapping); }
+	if (_file) { CloseHandle(_file); }
+}
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const std::filesystem::path& path) {
+	const int file = open(path.c_str(), O_RDONLY);
+	if (file < 0) { return; }
+
+	struct stat status;
+	if (fstat(file, &status) == 0 && status.st_size > 0) {
+		void* data = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+		if (data != MAP_FAILED) {
+			_data = static_cast<const uint8_t*>(data);
+			_size = static_cast<size_t>(status.st_size);
+		}
+	}
+
+	// The mapping keeps its own reference to the file.
+	close(file);
+}
+
+MappedFile::~MappedFile() noexcept {
+	if (_data) { munmap(const_cast<uint8_t*>(_data), _size); }
+}
+#endif
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+// A read-only memory mapping of a whole file. Pages are read in by the OS as they are touched and can be evicted
+// again under memory pressure, so large files can be read in place without a private copy.
+class MappedFile {
+ public:
+	MappedFile(const std::filesystem::path& path);
+	MappedFile(const MappedFile&)            = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	~MappedFile() noexcept;
+
+	const uint8_t* GetData() const {
+		return _data;
+	}
+	size_t GetSize() const {
+		return _size;
+	}
+	bool IsValid() const {
+		return _data != nullptr;
+	}
+
+ private:
+	const uint8_t* _data = nullptr;
+	size_t _size         = 0;
+#ifdef _WIN32
+	void* _file    = nullptr;
+	void* _mapping = nullptr;
+#endif
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <Assets/Material.hpp>
+#include <Vulkan/Common.hpp>
+#include <memory>
+#include <vector>
+
+struct GeometryAllocation;
+
+struct VertexStream {
+	vk::Format Format = vk::Format::eR32G32B32Sfloat;
+	uint32_t Stride   = sizeof(float) * 3;
+};
+
+struct MeshletRange {
+	uint32_t FirstMeshlet = 0;
+	uint32_t MeshletCount = 0;
+};
+
+// A simplified index list of a submesh, drawn with the submesh's own vertices. FirstIndex is relative to the first
+// index of the submesh, and Error is roughly how far, in model units, the simplified surface strays from the original.
+struct MeshLod {
+	uint32_t FirstIndex = 0;
+	uint32_t IndexCount = 0;
+	float Error         = 0.0f;
+};
+
+// The materials of a model, shared by every mesh loaded from it. Submeshes index it with their MaterialIndex.
+struct MaterialTable {
+	std::vector<Luna::MaterialHandle> Materials;
+};
+
+// Describes how the vertex and index streams of a Mesh are encoded. Quantized assets keep their compact integer formats
+// on the GPU, so the renderer needs to know the format and stride of each stream rather than assuming 32-bit floats.
+struct MeshInfo {
+	// The full submesh counts as the first level of detail.
+	static constexpr uint32_t MaxLodCount = 4;
+
+	VertexStream Position;
+	VertexStream Normal;
+	VertexStream Tangent;
+	VertexStream Bitangent;
+	VertexStream Texcoord0  = {vk::Format::eR32G32Sfloat, sizeof(float) * 2};
+	vk::IndexType IndexType = vk::IndexType::eUint32;
+
+	// Compact meshes store octahedral normals and tangents (with the bitangent sign folded into the tangent), half-float
+	// UVs, and 16-bit positions relative to the bounds of their submesh. They have no bitangent stream.
+	bool Compact = false;
+
+	// The range of the GeometryPool holding this mesh's geometry. Meshes without one draw from their own buffer.
+	std::shared_ptr<const GeometryAllocation> Geometry;
+	// The meshlets of each submesh, relative to the first meshlet of the allocation. Submeshes without indices have none.
+	std::vector<MeshletRange> SubmeshMeshlets;
+	// The levels of detail of each submesh past the first, from finest to coarsest.
+	std::vector<std::vector<MeshLod>> SubmeshLods;
+	// Used in place of the MeshComponent's own materials when set, so that entities sharing a mesh do not each need a
+	// copy of every material handle.
+	std::shared_ptr<const MaterialTable> Materials;
+
+	static MeshInfo CompactLayout() {
+		return MeshInfo{.Position  = {vk::Format::eR16G16B16A16Unorm, sizeof(uint16_t) * 4},
+		                .Normal    = {vk::Format::eR16G16Snorm, sizeof(int16_t) * 2},
+		                .Tangent   = {vk::Format::eR16G16Snorm, sizeof(int16_t) * 2},
+		                .Bitangent = {vk::Format::eUndefined, 0},
+		                .Texcoord0 = {vk::Format::eR16G16Sfloat, sizeof(uint16_t) * 2},
+		                .Compact   = true};
+	}
+};
+
+// Meshes without this component use the default MeshInfo layout.
+struct MeshInfoComponent {
+	MeshInfoComponent()                         = default;
+	MeshInfoComponent(const MeshInfoComponent&) = default;
+
+	std::shared_ptr<const MeshInfo> Info;
+};
@@ -0,0 +1,573 @@
+#include "MeshOptimizer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
+
+namespace MeshOptimizer {
+namespace {
+// Scoring parameters from Tom Forsyth's "Linear-Speed Vertex Cache Optimisation".
+constexpr int ForsythCacheSize           = 32;
+constexpr float ForsythCacheDecayPower   = 1.5f;
+constexpr float ForsythLastTriScore      = 0.75f;
+constexpr float ForsythValenceBoostScale = 2.0f;
+constexpr float ForsythValenceBoostPower = 0.5f;
+
+float ForsythVertexScore(int cachePosition, uint32_t liveTriangles) {
+	if (liveTriangles == 0) { return -1.0f; }
+
+	float score = 0.0f;
+	if (cachePosition >= 0) {
+		if (cachePosition < 3) {
+			score = ForsythLastTriScore;
+		} else {
+			const float scaler = 1.0f / (ForsythCacheSize - 3);
+			score              = std::pow(1.0f - (cachePosition - 3) * scaler, ForsythCacheDecayPower);
+		}
+	}
+	score += ForsythValenceBoostScale * std::pow(static_cast<float>(liveTriangles), -ForsythValenceBoostPower);
+
+	return score;
+}
+
+// A symmetric 4x4 matrix that accumulates the squared distance to a set of planes, as described in Garland and
+// Heckbert's "Surface Simplification Using Quadric Error Metrics".
+struct Quadric {
+	double A00 = 0.0, A01 = 0.0, A02 = 0.0, A11 = 0.0, A12 = 0.0, A22 = 0.0;
+	double B0 = 0.0, B1 = 0.0, B2 = 0.0;
+	double C = 0.0;
+
+	void AddPlane(double a, double b, double c, double d) {
+		A00 += a * a;
+		A01 += a * b;
+		A02 += a * c;
+		A11 += b * b;
+		A12 += b * c;
+		A22 += c * c;
+		B0 += a * d;
+		B1 += b * d;
+		B2 += c * d;
+		C += d * d;
+	}
+
+	void Add(const Quadric& other) {
+		A00 += other.A00;
+		A01 += other.A01;
+		A02 += other.A02;
+		A11 += other.A11;
+		A12 += other.A12;
+		A22 += other.A22;
+		B0 += other.B0;
+		B1 += other.B1;
+		B2 += other.B2;
+		C += other.C;
+	}
+
+	double Evaluate(const float* p) const {
+		const double x = p[0], y = p[1], z = p[2];
+		const double error = A00 * x * x + A11 * y * y + A22 * z * z + 2.0 * (A01 * x * y + A02 * x * z + A12 * y * z) +
+		                     2.0 * (B0 * x + B1 * y + B2 * z) + C;
+
+		return std::max(error, 0.0);
+	}
+};
+
+void TriangleNormal(const float* p0, const float* p1, const float* p2, float* normal) {
+	const float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+	const float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+	normal[0]         = e1[1] * e2[2] - e1[2] * e2[1];
+	normal[1]         = e1[2] * e2[0] - e1[0] * e2[2];
+	normal[2]         = e1[0] * e2[1] - e1[1] * e2[0];
+}
+}  // namespace
+
+float AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize) {
+	if (indexCount < 3) { return 0.0f; }
+
+	// Each vertex remembers the miss counter value at which it entered the cache, which makes FIFO lookups O(1).
+	std::vector<size_t> cacheTimestamps(vertexCount, 0);
+	size_t misses = 0;
+	for (size_t i = 0; i < indexCount; ++i) {
+		const uint32_t index = indices[i];
+		if (cacheTimestamps[index] == 0 || misses + 1 - cacheTimestamps[index] > cacheSize) {
+			++misses;
+			cacheTimestamps[index] = misses;
+		}
+	}
+
+	return static_cast<float>(misses) / static_cast<float>(indexCount / 3);
+}
+
+void OptimizeVertexCache(uint32_t* destination, const uint32_t* indices, size_t indexCount, size_t vertexCount) {
+	const size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0) { return; }
+	const std::vector<uint32_t> source(indices, indices + indexCount);
+
+	// Build the vertex to triangle adjacency.
+	std::vector<uint32_t> liveTriangles(vertexCount, 0);
+	for (size_t i = 0; i < indexCount; ++i) { ++liveTriangles[source[i]]; }
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; ++v) { adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v]; }
+	std::vector<uint32_t> adjacency(indexCount);
+	{
+		std::vector<uint32_t> cursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t t = 0; t < triangleCount; ++t) {
+			for (int k = 0; k < 3; ++k) { adjacency[cursor[source[t * 3 + k]]++] = static_cast<uint32_t>(t); }
+		}
+	}
+
+	std::vector<int> cachePositions(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount);
+	for (size_t v = 0; v < vertexCount; ++v) { vertexScores[v] = ForsythVertexScore(-1, liveTriangles[v]); }
+
+	std::vector<float> triangleScores(triangleCount);
+	std::vector<bool> emitted(triangleCount, false);
+	for (size_t t = 0; t < triangleCount; ++t) {
+		triangleScores[t] =
+			vertexScores[source[t * 3 + 0]] + vertexScores[source[t * 3 + 1]] + vertexScores[source[t * 3 + 2]];
+	}
+
+	std::vector<uint32_t> cache;
+	std::vector<uint32_t> nextCache;
+	cache.reserve(ForsythCacheSize + 3);
+	nextCache.reserve(ForsythCacheSize + 3);
+
+	size_t written   = 0;
+	size_t scanStart = 0;
+	int64_t best     = 0;
+	for (size_t t = 1; t < triangleCount; ++t) {
+		if (triangleScores[t] > triangleScores[best]) { best = static_cast<int64_t>(t); }
+	}
+
+	while (written < triangleCount) {
+		if (best < 0) {
+			// Nothing in the cache has live triangles left, so continue with the next unemitted triangle.
+			while (emitted[scanStart]) { ++scanStart; }
+			best = static_cast<int64_t>(scanStart);
+		}
+
+		const uint32_t* triangle = &source[best * 3];
+		emitted[best]            = true;
+		for (int k = 0; k < 3; ++k) { destination[written * 3 + k] = triangle[k]; }
+		++written;
+
+		// Remove the triangle from the adjacency of its vertices.
+		for (int k = 0; k < 3; ++k) {
+			const uint32_t v = triangle[k];
+			auto* begin      = &adjacency[adjacencyOffsets[v]];
+			auto* end        = begin + liveTriangles[v];
+			auto* it         = std::find(begin, end, static_cast<uint32_t>(best));
+			if (it != end) {
+				std::iter_swap(it, end - 1);
+				--liveTriangles[v];
+			}
+		}
+
+		// Move the triangle's vertices to the front of the LRU cache.
+		nextCache.assign(triangle, triangle + 3);
+		for (const uint32_t v : cache) {
+			if (v != triangle[0] && v != triangle[1] && v != triangle[2]) { nextCache.push_back(v); }
+		}
+		for (size_t i = ForsythCacheSize; i < nextCache.size(); ++i) { cachePositions[nextCache[i]] = -1; }
+		if (nextCache.size() > ForsythCacheSize) { nextCache.resize(ForsythCacheSize); }
+		std::swap(cache, nextCache);
+
+		// Rescore the cached vertices and their triangles, and pick the best of those triangles next.
+		for (size_t i = 0; i < cache.size(); ++i) {
+			cachePositions[cache[i]] = static_cast<int>(i);
+			vertexScores[cache[i]]   = ForsythVertexScore(static_cast<int>(i), liveTriangles[cache[i]]);
+		}
+		best            = -1;
+		float bestScore = -1.0f;
+		for (const uint32_t v : cache) {
+			for (uint32_t a = 0; a < liveTriangles[v]; ++a) {
+				const uint32_t t  = adjacency[adjacencyOffsets[v] + a];
+				const float score = vertexScores[source[t * 3 + 0]] + vertexScores[source[t * 3 + 1]] +
+				                    vertexScores[source[t * 3 + 2]];
+				triangleScores[t] = score;
+				if (score > bestScore) {
+					bestScore = score;
+					best      = t;
+				}
+			}
+		}
+	}
+}
+
+void OptimizeOverdraw(uint32_t* destination,
+                      const uint32_t* indices,
+                      size_t indexCount,
+                      const float* positions,
+                      size_t positionStride,
+                      size_t vertexCount,
+                      float threshold) {
+	const size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0) { return; }
+	const std::vector<uint32_t> source(indices, indices + indexCount);
+	const auto Position = [&](uint32_t v) -> const float* {
+		return reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(positions) + v * positionStride);
+	};
+
+	// Split the triangles into clusters wherever the vertex cache starts over (all three vertices miss). Reordering
+	// whole clusters then barely affects the cache efficiency achieved by OptimizeVertexCache.
+	std::vector<size_t> clusters;
+	{
+		constexpr size_t cacheSize = 16;
+		std::vector<size_t> cacheTimestamps(vertexCount, 0);
+		size_t misses = 0;
+		for (size_t t = 0; t < triangleCount; ++t) {
+			int triangleMisses = 0;
+			for (int k = 0; k < 3; ++k) {
+				const uint32_t v = source[t * 3 + k];
+				if (cacheTimestamps[v] == 0 || misses + 1 - cacheTimestamps[v] > cacheSize) {
+					++misses;
+					++triangleMisses;
+					cacheTimestamps[v] = misses;
+				}
+			}
+			if (t == 0 || triangleMisses == 3) { clusters.push_back(t); }
+		}
+	}
+	if (clusters.size() < 2) {
+		std::copy(source.begin(), source.end(), destination);
+		return;
+	}
+
+	float meshCenter[3] = {0.0f, 0.0f, 0.0f};
+	for (size_t i = 0; i < indexCount; ++i) {
+		const float* p = Position(source[i]);
+		for (int c = 0; c < 3; ++c) { meshCenter[c] += p[c]; }
+	}
+	for (int c = 0; c < 3; ++c) { meshCenter[c] /= static_cast<float>(indexCount); }
+
+	// Sort clusters by how much they face away from the mesh center, so that occluders tend to be drawn first.
+	std::vector<float> sortKeys(clusters.size());
+	for (size_t c = 0; c < clusters.size(); ++c) {
+		const size_t begin = clusters[c];
+		const size_t end   = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+
+		float center[3] = {0.0f, 0.0f, 0.0f};
+		float normal[3] = {0.0f, 0.0f, 0.0f};
+		float area      = 0.0f;
+		for (size_t t = begin; t < end; ++t) {
+			const float* p0 = Position(source[t * 3 + 0]);
+			const float* p1 = Position(source[t * 3 + 1]);
+			const float* p2 = Position(source[t * 3 + 2]);
+
+			const float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+			const float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+			const float n[3]  = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+			const float a     = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+			for (int k = 0; k < 3; ++k) {
+				center[k] += (p0[k] + p1[k] + p2[k]) / 3.0f * a;
+				normal[k] += n[k];
+			}
+			area += a;
+		}
+
+		const float normalLength = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		if (area <= 0.0f || normalLength <= 0.0f) { continue; }
+		float key = 0.0f;
+		for (int k = 0; k < 3; ++k) { key += (center[k] / area - meshCenter[k]) * (normal[k] / normalLength); }
+		sortKeys[c] = key;
+	}
+
+	std::vector<size_t> order(clusters.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sortKeys[a] > sortKeys[b]; });
+
+	std::vector<uint32_t> result;
+	result.reserve(indexCount);
+	for (const size_t c : order) {
+		const size_t begin = clusters[c];
+		const size_t end   = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+		result.insert(result.end(), source.begin() + begin * 3, source.begin() + end * 3);
+	}
+
+	const float acmrBefore = AnalyzeVertexCache(source.data(), indexCount, vertexCount);
+	const float acmrAfter  = AnalyzeVertexCache(result.data(), indexCount, vertexCount);
+	const auto& chosen     = acmrAfter <= acmrBefore * threshold ? result : source;
+	std::copy(chosen.begin(), chosen.end(), destination);
+}
+
+std::vector<uint32_t> OptimizeVertexFetch(uint32_t* indices, size_t indexCount, size_t vertexCount) {
+	constexpr uint32_t Unused = ~0u;
+
+	std::vector<uint32_t> remap(vertexCount, Unused);
+	uint32_t next = 0;
+	for (size_t i = 0; i < indexCount; ++i) {
+		auto& target = remap[indices[i]];
+		if (target == Unused) { target = next++; }
+		indices[i] = target;
+	}
+	for (auto& target : remap) {
+		if (target == Unused) { target = next++; }
+	}
+
+	return remap;
+}
+
+std::vector<Meshlet> BuildMeshlets(const uint32_t* indices,
+                                   size_t indexCount,
+                                   const float* positions,
+                                   size_t positionStride,
+                                   size_t vertexCount,
+                                   size_t maxVertices,
+                                   size_t maxTriangles) {
+	const auto Position = [&](uint32_t v) -> const float* {
+		return reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(positions) + v * positionStride);
+	};
+
+	std::vector<Meshlet> meshlets;
+	const auto Finish = [&](size_t firstIndex, size_t endIndex, const std::vector<uint32_t>& vertices) -> void {
+		Meshlet meshlet    = {};
+		meshlet.FirstIndex = static_cast<uint32_t>(firstIndex);
+		meshlet.IndexCount = static_cast<uint32_t>(endIndex - firstIndex);
+
+		// The bounding sphere is centered on the vertex bounding box, which is close enough for culling.
+		constexpr float Max = std::numeric_limits<float>::max();
+		float boundsMin[3]  = {Max, Max, Max};
+		float boundsMax[3]  = {-Max, -Max, -Max};
+		for (const uint32_t v : vertices) {
+			const float* p = Position(v);
+			for (int c = 0; c < 3; ++c) {
+				boundsMin[c] = std::min(boundsMin[c], p[c]);
+				boundsMax[c] = std::max(boundsMax[c], p[c]);
+			}
+		}
+		for (int c = 0; c < 3; ++c) { meshlet.Center[c] = (boundsMin[c] + boundsMax[c]) * 0.5f; }
+		float radiusSquared = 0.0f;
+		for (const uint32_t v : vertices) {
+			const float* p = Position(v);
+			const float d[3] = {p[0] - meshlet.Center[0], p[1] - meshlet.Center[1], p[2] - meshlet.Center[2]};
+			radiusSquared    = std::max(radiusSquared, d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+		}
+		meshlet.Radius = std::sqrt(radiusSquared);
+
+		// The cone axis is the average triangle normal, and the cutoff is the sine of the widest angle between the axis
+		// and any triangle normal. Clusters spanning close to a hemisphere or more are never cone culled.
+		std::vector<std::array<float, 3>> normals;
+		normals.reserve(meshlet.IndexCount / 3);
+		float axis[3] = {0.0f, 0.0f, 0.0f};
+		for (size_t i = firstIndex; i + 2 < endIndex; i += 3) {
+			const float* p0   = Position(indices[i + 0]);
+			const float* p1   = Position(indices[i + 1]);
+			const float* p2   = Position(indices[i + 2]);
+			const float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+			const float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+			float n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+			const float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			if (length <= 0.0f) { continue; }
+			for (int c = 0; c < 3; ++c) {
+				n[c] /= length;
+				axis[c] += n[c];
+			}
+			normals.push_back({n[0], n[1], n[2]});
+		}
+		const float axisLength = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+		meshlet.ConeCutoff     = 1.0f;
+		if (axisLength > 0.0f && !normals.empty()) {
+			for (int c = 0; c < 3; ++c) { meshlet.ConeAxis[c] = axis[c] / axisLength; }
+			float minDot = 1.0f;
+			for (const auto& n : normals) {
+				minDot = std::min(minDot, n[0] * meshlet.ConeAxis[0] + n[1] * meshlet.ConeAxis[1] + n[2] * meshlet.ConeAxis[2]);
+			}
+			if (minDot > 0.1f) { meshlet.ConeCutoff = std::sqrt(1.0f - minDot * minDot); }
+		}
+
+		meshlets.push_back(meshlet);
+	};
+
+	// Each vertex remembers the last meshlet it was added to, so membership tests are O(1).
+	constexpr uint32_t None = ~0u;
+	std::vector<uint32_t> vertexMeshlet(vertexCount, None);
+	std::vector<uint32_t> vertices;
+	vertices.reserve(maxVertices);
+	size_t firstIndex = 0;
+	for (size_t i = 0; i + 2 < indexCount; i += 3) {
+		const auto meshletIndex = static_cast<uint32_t>(meshlets.size());
+		size_t newVertices      = 0;
+		for (int k = 0; k < 3; ++k) {
+			if (vertexMeshlet[indices[i + k]] != meshletIndex) { ++newVertices; }
+		}
+		if (indices[i + 0] == indices[i + 1] || indices[i + 1] == indices[i + 2] || indices[i + 0] == indices[i + 2]) {
+			newVertices = std::min<size_t>(newVertices, 2);
+		}
+
+		const size_t triangles = (i - firstIndex) / 3;
+		if (vertices.size() + newVertices > maxVertices || triangles + 1 > maxTriangles) {
+			Finish(firstIndex, i, vertices);
+			vertices.clear();
+			firstIndex = i;
+		}
+
+		const auto currentMeshlet = static_cast<uint32_t>(meshlets.size());
+		for (int k = 0; k < 3; ++k) {
+			const uint32_t v = indices[i + k];
+			if (vertexMeshlet[v] != currentMeshlet) {
+				vertexMeshlet[v] = currentMeshlet;
+				vertices.push_back(v);
+			}
+		}
+	}
+	if (!vertices.empty()) { Finish(firstIndex, indexCount / 3 * 3, vertices); }
+
+	return meshlets;
+}
+
+size_t Simplify(uint32_t* destination,
+                const uint32_t* indices,
+                size_t indexCount,
+                const float* positions,
+                size_t positionStride,
+                size_t vertexCount,
+                size_t targetIndexCount,
+                float targetError,
+                float* resultError) {
+	const auto Position = [&](uint32_t v) -> const float* {
+		return reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(positions) + v * positionStride);
+	};
+
+	std::vector<uint32_t> result(indices, indices + indexCount / 3 * 3);
+
+	// Every vertex starts with the planes of the triangles around it.
+	std::vector<Quadric> quadrics(vertexCount);
+	for (size_t i = 0; i < result.size(); i += 3) {
+		const float* p0 = Position(result[i + 0]);
+		float n[3];
+		TriangleNormal(p0, Position(result[i + 1]), Position(result[i + 2]), n);
+		const double length = std::sqrt(double(n[0]) * n[0] + double(n[1]) * n[1] + double(n[2]) * n[2]);
+		if (length <= 0.0) { continue; }
+
+		const double a = n[0] / length, b = n[1] / length, c = n[2] / length;
+		const double d = -(a * p0[0] + b * p0[1] + c * p0[2]);
+		for (int k = 0; k < 3; ++k) { quadrics[result[i + k]].AddPlane(a, b, c, d); }
+	}
+
+	// Vertices on open or non-manifold edges never move. Attribute seams split vertices, so this also keeps seams intact.
+	std::vector<uint8_t> locked(vertexCount, 0);
+	{
+		std::unordered_map<uint64_t, uint32_t> edgeUses;
+		edgeUses.reserve(result.size());
+		const auto EdgeKey = [](uint32_t a, uint32_t b) -> uint64_t {
+			return (uint64_t(std::min(a, b)) << 32) | std::max(a, b);
+		};
+		for (size_t i = 0; i < result.size(); i += 3) {
+			for (int k = 0; k < 3; ++k) { ++edgeUses[EdgeKey(result[i + k], result[i + (k + 1) % 3])]; }
+		}
+		for (const auto& [key, uses] : edgeUses) {
+			if (uses == 2) { continue; }
+			locked[key >> 32]        = 1;
+			locked[key & 0xffffffff] = 1;
+		}
+	}
+
+	struct Collapse {
+		uint32_t From;
+		uint32_t To;
+		double Cost;
+	};
+	std::vector<Collapse> collapses;
+	std::vector<uint32_t> remap(vertexCount);
+	std::vector<uint8_t> touched(vertexCount);
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+	std::vector<uint32_t> adjacency;
+	const double maxCost = double(targetError) * targetError;
+	double error         = 0.0;
+
+	// Each pass collapses the cheapest edges whose neighbourhoods do not overlap, so that costs stay exact within a pass.
+	while (result.size() > targetIndexCount) {
+		std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+		for (const uint32_t v : result) { ++adjacencyOffsets[v + 1]; }
+		std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+		adjacency.resize(result.size());
+		{
+			auto cursor = adjacencyOffsets;
+			for (size_t i = 0; i < result.size(); ++i) { adjacency[cursor[result[i]]++] = static_cast<uint32_t>(i / 3); }
+		}
+
+		// Interior edges are shared by two triangles in opposite directions, so each is considered once.
+		collapses.clear();
+		for (size_t i = 0; i < result.size(); i += 3) {
+			for (int k = 0; k < 3; ++k) {
+				const uint32_t a = result[i + k];
+				const uint32_t b = result[i + (k + 1) % 3];
+				if (a > b || (locked[a] && locked[b])) { continue; }
+
+				Quadric q = quadrics[a];
+				q.Add(quadrics[b]);
+				const double costAB = locked[a] ? std::numeric_limits<double>::max() : q.Evaluate(Position(b));
+				const double costBA = locked[b] ? std::numeric_limits<double>::max() : q.Evaluate(Position(a));
+				if (costAB <= costBA) {
+					collapses.push_back({a, b, costAB});
+				} else {
+					collapses.push_back({b, a, costBA});
+				}
+			}
+		}
+		std::sort(
+			collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.Cost < b.Cost; });
+
+		// Rejects collapses that would turn a triangle around the removed vertex over.
+		const auto Flips = [&](uint32_t from, uint32_t to) -> bool {
+			for (uint32_t a = adjacencyOffsets[from]; a < adjacencyOffsets[from + 1]; ++a) {
+				const uint32_t* triangle = &result[adjacency[a] * 3];
+				if (triangle[0] == to || triangle[1] == to || triangle[2] == to) { continue; }
+
+				const float* before[3] = {Position(triangle[0]), Position(triangle[1]), Position(triangle[2])};
+				const float* after[3]  = {before[0], before[1], before[2]};
+				for (int k = 0; k < 3; ++k) {
+					if (triangle[k] == from) { after[k] = Position(to); }
+				}
+				float nBefore[3], nAfter[3];
+				TriangleNormal(before[0], before[1], before[2], nBefore);
+				TriangleNormal(after[0], after[1], after[2], nAfter);
+				if (nBefore[0] * nAfter[0] + nBefore[1] * nAfter[1] + nBefore[2] * nAfter[2] <= 0.0f) { return true; }
+			}
+
+			return false;
+		};
+
+		// Collapsing an interior edge removes two triangles.
+		const size_t wanted = ((result.size() - targetIndexCount) / 3 + 1) / 2;
+		std::iota(remap.begin(), remap.end(), 0);
+		std::fill(touched.begin(), touched.end(), 0);
+		size_t applied = 0;
+		for (const auto& collapse : collapses) {
+			if (collapse.Cost > maxCost || applied >= wanted) { break; }
+			if (touched[collapse.From] || touched[collapse.To] || Flips(collapse.From, collapse.To)) { continue; }
+
+			remap[collapse.From] = collapse.To;
+			quadrics[collapse.To].Add(quadrics[collapse.From]);
+			for (uint32_t a = adjacencyOffsets[collapse.From]; a < adjacencyOffsets[collapse.From + 1]; ++a) {
+				for (int k = 0; k < 3; ++k) { touched[result[adjacency[a] * 3 + k]] = 1; }
+			}
+			touched[collapse.To] = 1;
+			error                = std::max(error, collapse.Cost);
+			++applied;
+		}
+		if (applied == 0) { break; }
+
+		size_t write = 0;
+		for (size_t i = 0; i < result.size(); i += 3) {
+			const uint32_t a = remap[result[i + 0]];
+			const uint32_t b = remap[result[i + 1]];
+			const uint32_t c = remap[result[i + 2]];
+			if (a == b || b == c || a == c) { continue; }
+			result[write++] = a;
+			result[write++] = b;
+			result[write++] = c;
+		}
+		result.resize(write);
+	}
+
+	std::copy(result.begin(), result.end(), destination);
+	if (resultError) { *resultError = static_cast<float>(std::sqrt(error)); }
+
+	return result.size();
+}
+}  // namespace MeshOptimizer
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A cluster of triangles stored as a contiguous range of the index buffer, with a bounding sphere and a normal cone
+// that are used to cull the whole cluster. A ConeCutoff of 1 means the cluster faces too many ways to be cone culled.
+// The layout matches the std430 layout used by the culling shader.
+struct Meshlet {
+	float Center[3];
+	float Radius;
+	float ConeAxis[3];
+	float ConeCutoff;
+	uint32_t FirstIndex;
+	uint32_t IndexCount;
+	uint32_t Padding[2];
+};
+
+// Load-time optimizations for indexed triangle lists. All functions operate on 32-bit indices and allow the
+// destination to alias the source indices.
+namespace MeshOptimizer {
+// Returns the average cache miss ratio (post-transform vertex shader invocations per triangle) of a FIFO cache.
+float AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = 16);
+
+// Reorders triangles for post-transform vertex cache locality, using Tom Forsyth's linear-speed algorithm.
+void OptimizeVertexCache(uint32_t* destination, const uint32_t* indices, size_t indexCount, size_t vertexCount);
+
+// Reorders clusters of triangles so that outward-facing clusters are drawn first, reducing overdraw. The input should
+// already be vertex cache optimized, and the result is discarded if it raises the ACMR above threshold times the
+// original.
+void OptimizeOverdraw(uint32_t* destination,
+                      const uint32_t* indices,
+                      size_t indexCount,
+                      const float* positions,
+                      size_t positionStride,
+                      size_t vertexCount,
+                      float threshold = 1.05f);
+
+// Builds a vertex remap table (old index to new index) that orders vertices by first use, and rewrites the indices to
+// match. Unreferenced vertices are moved to the end.
+std::vector<uint32_t> OptimizeVertexFetch(uint32_t* indices, size_t indexCount, size_t vertexCount);
+
+// Splits the triangles into meshlets of at most maxVertices unique vertices and maxTriangles triangles, in index buffer
+// order, so the index buffer is left untouched. It should already be vertex cache optimized for compact meshlets.
+std::vector<Meshlet> BuildMeshlets(const uint32_t* indices,
+                                   size_t indexCount,
+                                   const float* positions,
+                                   size_t positionStride,
+                                   size_t vertexCount,
+                                   size_t maxVertices  = 64,
+                                   size_t maxTriangles = 124);
+
+// Reduces the triangle count towards targetIndexCount by collapsing edges in order of quadric error, without moving any
+// vertex, so the result can share the original vertex buffer. Collapses stop once the error would exceed targetError,
+// in position units. Open and non-manifold edges are left in place. Writes the new indices to destination, which must
+// hold indexCount indices, and returns their count. The error of the result is written to resultError if given.
+size_t Simplify(uint32_t* destination,
+                const uint32_t* indices,
+                size_t indexCount,
+                const float* positions,
+                size_t positionStride,
+                size_t vertexCount,
+                size_t targetIndexCount,
+                float targetError,
+                float* resultError = nullptr);
+}  // namespace MeshOptimizer
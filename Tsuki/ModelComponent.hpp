@@ -0,0 +1,14 @@
+#pragma once
+
+#include <memory>
+
+struct LoadedModel;
+
+// Keeps the model an entity was instantiated from resident, along with every mesh, material and texture of it. Each
+// entity of the model holds one, so the model is released once the last of them has been destroyed.
+struct ModelComponent {
+	ModelComponent()                      = default;
+	ModelComponent(const ModelComponent&) = default;
+
+	std::shared_ptr<const LoadedModel> Model;
+};
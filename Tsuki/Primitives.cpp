@@ -2,8 +2,10 @@
 
 #include <Vulkan/Device.hpp>
 
+#include "UploadManager.hpp"
+
 namespace Primitives {
-Luna::IntrusivePtr<Luna::Mesh> Plane(Luna::Vulkan::Device& device) {
+Luna::IntrusivePtr<Luna::Mesh> Plane(Luna::Vulkan::Device& device, UploadManager& uploads) {
 	Luna::Mesh* mesh = new Luna::Mesh();
 
 	const glm::vec3 positions[] = {glm::vec3(-0.5f, 0.0f, -0.5f),
@@ -35,8 +37,9 @@ Luna::IntrusivePtr<Luna::Mesh> Plane(Luna::Vulkan::Device& device) {
 	mesh->Buffer = device.CreateBuffer(
 		Luna::Vulkan::BufferCreateInfo(Luna::Vulkan::BufferDomain::Device,
 	                                 bufferSize,
-	                                 vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eIndexBuffer),
-		buffer.data());
+	                                 vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eIndexBuffer |
+	                                   vk::BufferUsageFlagBits::eTransferDst));
+	uploads.UploadBuffer(*mesh->Buffer, 0, buffer.data(), bufferSize);
 
 	return Luna::IntrusivePtr<Luna::Mesh>(mesh);
 }
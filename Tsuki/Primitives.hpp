@@ -3,6 +3,8 @@
 #include <Assets/Mesh.hpp>
 #include <glm/glm.hpp>
 
+class UploadManager;
+
 namespace Primitives {
-Luna::IntrusivePtr<Luna::Mesh> Plane(Luna::Vulkan::Device& device);
+Luna::IntrusivePtr<Luna::Mesh> Plane(Luna::Vulkan::Device& device, UploadManager& uploads);
 }
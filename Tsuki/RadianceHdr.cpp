@@ -0,0 +1,202 @@
+#include "RadianceHdr.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TSUKI_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// Scanlines of these widths may be run-length encoded, one channel at a time.
+static constexpr uint32_t MinRleWidth = 8;
+static constexpr uint32_t MaxRleWidth = 0x7fff;
+
+// An RGBE texel is mantissa * 2^(e - 136), and an E5B9G9R9 texel mantissa * 2^(exp - 24). With the 8-bit mantissas
+// widened to 9 bits, the exponents differ by 113. Texels too bright for E5B9G9R9 saturate, and those too dim for its
+// exponent have their mantissas shifted down instead.
+static constexpr int ExponentBias = 113;
+
+static uint32_t ConvertTexel(const uint8_t* rgbe) {
+	int exponent = int(rgbe[3]) - ExponentBias;
+	if (exponent > 31) { return 0xffffffffu; }
+
+	uint32_t r = uint32_t(rgbe[0]) << 1;
+	uint32_t g = uint32_t(rgbe[1]) << 1;
+	uint32_t b = uint32_t(rgbe[2]) << 1;
+	if (exponent < 0) {
+		if (exponent < -9) { return 0; }
+		r >>= -exponent;
+		g >>= -exponent;
+		b >>= -exponent;
+		exponent = 0;
+	}
+
+	return r | (g << 9) | (b << 18) | (uint32_t(exponent) << 27);
+}
+
+RadianceHdr::RadianceHdr(const uint8_t* data, size_t size) : _data(data), _size(size) {
+	// The header is a list of lines ending with an empty one, followed by a line giving the orientation and size.
+	size_t offset       = 0;
+	const auto ReadLine = [&]() -> std::string_view {
+		const size_t start = offset;
+		while (offset < _size && _data[offset] != '\n') { ++offset; }
+		const std::string_view line(reinterpret_cast<const char*>(_data + start), offset - start);
+		if (offset < _size) { ++offset; }
+
+		return line;
+	};
+
+	const auto magic = ReadLine();
+	if (magic != "#?RADIANCE" && magic != "#?RGBE") { return; }
+	while (true) {
+		const auto line = ReadLine();
+		if (line.empty()) { break; }
+		if (line.starts_with("FORMAT=") && line != "FORMAT=32-bit_rle_rgbe") { return; }
+		if (offset >= _size) { return; }
+	}
+
+	// Only images stored in rows, left to right, are supported. Those are the only ones in common use.
+	const std::string resolution(ReadLine());
+	char yOrder;
+	int height, width;
+	if (std::sscanf(resolution.c_str(), "%cY %d +X %d", &yOrder, &height, &width) != 3) { return; }
+	if ((yOrder != '-' && yOrder != '+') || width <= 0 || height <= 0) { return; }
+
+	// Rows are stored from the top down, unless the Y axis is flipped.
+	_width = width;
+	std::vector<size_t> scanlines(height);
+	for (int row = 0; row < height; ++row) {
+		scanlines[yOrder == '-' ? height - 1 - row : row] = offset;
+		offset = SkipScanline(offset);
+		if (offset == 0) {
+			_width = 0;
+			return;
+		}
+	}
+
+	_height    = height;
+	_scanlines = std::move(scanlines);
+}
+
+bool RadianceHdr::DecodeRows(uint32_t firstRow, uint32_t rowCount, uint32_t* dst) const {
+	if (firstRow + rowCount > _height) { return false; }
+
+	std::vector<uint8_t> rgbe(size_t(_width) * 4);
+	for (uint32_t row = 0; row < rowCount; ++row) {
+		if (!DecodeScanline(_scanlines[firstRow + row], rgbe.data())) { return false; }
+		ConvertTexels(rgbe.data(), dst + size_t(row) * _width, _width);
+	}
+
+	return true;
+}
+
+void RadianceHdr::ConvertTexels(const uint8_t* rgbe, uint32_t* dst, size_t count) {
+	size_t i = 0;
+#ifdef TSUKI_SSE2
+	const __m128i byteMask = _mm_set1_epi32(0xff);
+	const __m128i bias     = _mm_set1_epi32(ExponentBias);
+	const __m128i maxExp   = _mm_set1_epi32(31);
+	const __m128i floatExp = _mm_set1_epi32(127);
+	for (; i + 4 <= count; i += 4) {
+		const __m128i texels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgbe + i * 4));
+		const __m128i r      = _mm_slli_epi32(_mm_and_si128(texels, byteMask), 1);
+		const __m128i g      = _mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(texels, 8), byteMask), 1);
+		const __m128i b      = _mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(texels, 16), byteMask), 1);
+		const __m128i e      = _mm_sub_epi32(_mm_srli_epi32(texels, 24), bias);
+
+		const __m128i under    = _mm_cmplt_epi32(e, _mm_setzero_si128());
+		const __m128i over     = _mm_cmpgt_epi32(e, maxExp);
+		const __m128i exponent = _mm_andnot_si128(under, e);
+
+		// SSE2 cannot shift each lane by a different amount, so dim texels are scaled by 2^exponent as floats instead,
+		// which is exact for these small integers. Other texels are scaled by 1, and exponents too small for a float give
+		// a scale of 0.
+		__m128i scaleExp   = _mm_add_epi32(_mm_and_si128(e, under), floatExp);
+		scaleExp           = _mm_andnot_si128(_mm_srai_epi32(scaleExp, 31), scaleExp);
+		const __m128 scale = _mm_castsi128_ps(_mm_slli_epi32(scaleExp, 23));
+
+		const __m128i scaledR = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(r), scale));
+		const __m128i scaledG = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(g), scale));
+		const __m128i scaledB = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(b), scale));
+
+		__m128i packed = _mm_or_si128(scaledR, _mm_slli_epi32(scaledG, 9));
+		packed         = _mm_or_si128(packed, _mm_slli_epi32(scaledB, 18));
+		packed         = _mm_or_si128(packed, _mm_slli_epi32(exponent, 27));
+		packed         = _mm_or_si128(packed, over);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), packed);
+	}
+#endif
+	for (; i < count; ++i) { dst[i] = ConvertTexel(rgbe + i * 4); }
+}
+
+bool RadianceHdr::IsRunLengthEncoded(size_t offset) const {
+	if (_width < MinRleWidth || _width > MaxRleWidth || offset + 4 > _size) { return false; }
+	const uint8_t* src = _data + offset;
+
+	return src[0] == 2 && src[1] == 2 && ((uint32_t(src[2]) << 8) | src[3]) == _width;
+}
+
+bool RadianceHdr::DecodeScanline(size_t offset, uint8_t* rgbe) const {
+	const uint8_t* src = _data + offset;
+	if (!IsRunLengthEncoded(offset)) {
+		if (offset + size_t(_width) * 4 > _size) { return false; }
+		memcpy(rgbe, src, size_t(_width) * 4);
+		return true;
+	}
+
+	// Each channel is stored separately, as runs of one repeated value and runs of literal values.
+	const uint8_t* end = _data + _size;
+	src += 4;
+	for (uint32_t channel = 0; channel < 4; ++channel) {
+		uint32_t x = 0;
+		while (x < _width) {
+			if (src >= end) { return false; }
+			const uint32_t count = *src++;
+			if (count > 128) {
+				const uint32_t run = count - 128;
+				if (x + run > _width || src >= end) { return false; }
+				const uint8_t value = *src++;
+				for (uint32_t i = 0; i < run; ++i) { rgbe[(x + i) * 4 + channel] = value; }
+				x += run;
+			} else {
+				if (count == 0 || x + count > _width || src + count > end) { return false; }
+				for (uint32_t i = 0; i < count; ++i) { rgbe[(x + i) * 4 + channel] = src[i]; }
+				src += count;
+				x += count;
+			}
+		}
+	}
+
+	return true;
+}
+
+size_t RadianceHdr::SkipScanline(size_t offset) const {
+	if (!IsRunLengthEncoded(offset)) {
+		const size_t next = offset + size_t(_width) * 4;
+		return next <= _size ? next : 0;
+	}
+
+	offset += 4;
+	for (uint32_t channel = 0; channel < 4; ++channel) {
+		uint32_t x = 0;
+		while (x < _width) {
+			if (offset >= _size) { return 0; }
+			const uint32_t count = _data[offset++];
+			if (count > 128) {
+				x += count - 128;
+				offset += 1;
+			} else {
+				if (count == 0) { return 0; }
+				x += count;
+				offset += count;
+			}
+			if (x > _width || offset > _size) { return 0; }
+		}
+	}
+
+	return offset;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Reads Radiance .hdr images, converting their RGBE texels to the E5B9G9R9 shared exponent format. Both formats share
+// one exponent between three mantissas, so the conversion is exact apart from the dimmest texels, and the image can be
+// uploaded at 4 bytes per texel rather than as 32-bit floats.
+//
+// Only the header is read up front, along with the offset of every scanline, so that ranges of rows can then be
+// decoded independently, on any thread, while the data stays in place.
+class RadianceHdr {
+ public:
+	RadianceHdr(const uint8_t* data, size_t size);
+
+	bool IsValid() const {
+		return _width > 0 && _height > 0;
+	}
+	uint32_t GetWidth() const {
+		return _width;
+	}
+	uint32_t GetHeight() const {
+		return _height;
+	}
+
+	// Decodes rowCount rows into dst, which needs room for rowCount * width texels. Rows are numbered from the bottom
+	// of the image up, the order in which they are sampled by texture coordinates.
+	bool DecodeRows(uint32_t firstRow, uint32_t rowCount, uint32_t* dst) const;
+
+	// Converts count RGBE texels to E5B9G9R9, four at a time where SSE2 is available.
+	static void ConvertTexels(const uint8_t* rgbe, uint32_t* dst, size_t count);
+
+ private:
+	bool IsRunLengthEncoded(size_t offset) const;
+	bool DecodeScanline(size_t offset, uint8_t* rgbe) const;
+	// Returns the offset of the scanline that follows the one at offset, or 0 if the data is malformed.
+	size_t SkipScanline(size_t offset) const;
+
+	const uint8_t* _data;
+	size_t _size;
+	uint32_t _width  = 0;
+	uint32_t _height = 0;
+	// Indexed by row, counting up from the bottom of the image.
+	std::vector<size_t> _scanlines;
+};
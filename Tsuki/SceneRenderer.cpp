@@ -16,14 +16,21 @@
 #include <Vulkan/Image.hpp>
 #include <Vulkan/RenderPass.hpp>
 #include <Vulkan/WSI.hpp>
+#include <algorithm>
+#include <cstring>
+#include <tuple>
 
 #include "DirectionalLightComponent.hpp"
+#include "GeometryPool.hpp"
 #include "IconsFontAwesome6.h"
+#include "InstancesComponent.hpp"
+#include "MeshInfoComponent.hpp"
 #include "SkyboxComponent.hpp"
+#include "UploadManager.hpp"
 
 using namespace Luna;
 
-SceneRenderer::SceneRenderer(Vulkan::WSI& wsi) : _wsi(wsi) {
+SceneRenderer::SceneRenderer(Vulkan::WSI& wsi, UploadManager& uploads) : _wsi(wsi), _uploads(uploads) {
 	ReloadShaders();
 	_sceneImages.resize(wsi.GetImageCount());
 
@@ -123,15 +130,30 @@ Luna::Vulkan::ImageHandle& SceneRenderer::GetImage(uint32_t frameIndex) {
 	return _sceneImages[frameIndex];
 }
 
+// Inserts a preprocessor definition after the #version line of a shader source.
+static std::string DefineMacro(std::string source, const std::string& macro) {
+	const auto lineEnd = source.find('\n');
+	source.insert(lineEnd == std::string::npos ? source.size() : lineEnd + 1, "#define " + macro + "\n");
+
+	return source;
+}
+
 void SceneRenderer::ReloadShaders() {
 	auto* depthPre = _wsi.GetDevice().RequestProgram(ReadFile("Assets/Shaders/DepthPrePass.vert.glsl"),
 	                                                 ReadFile("Assets/Shaders/DepthPrePass.frag.glsl"));
 	if (depthPre) { _depthPre = depthPre; }
 
+	auto* meshletCull = _wsi.GetDevice().RequestProgram(ReadFile("Assets/Shaders/MeshletCull.comp.glsl"));
+	if (meshletCull) { _meshletCull = meshletCull; }
+
 	auto* program =
 		_wsi.GetDevice().RequestProgram(ReadFile("Assets/Shaders/PBR.vert.glsl"), ReadFile("Assets/Shaders/PBR.frag.glsl"));
 	if (program) { _program = program; }
 
+	auto* programCompact = _wsi.GetDevice().RequestProgram(
+		DefineMacro(ReadFile("Assets/Shaders/PBR.vert.glsl"), "COMPACT_VERTEX"), ReadFile("Assets/Shaders/PBR.frag.glsl"));
+	if (programCompact) { _programCompact = programCompact; }
+
 	auto* skybox = _wsi.GetDevice().RequestProgram(ReadFile("Assets/Shaders/Skybox.vert.glsl"),
 	                                               ReadFile("Assets/Shaders/Skybox.frag.glsl"));
 	if (skybox) { _skybox = skybox; }
@@ -168,7 +190,12 @@ void SceneRenderer::Render(Vulkan::CommandBufferHandle& cmd, Luna::Scene& scene,
 		if (!skyboxes.empty()) { skyEntity = Entity(skyboxes.front(), scene); }
 	}
 
-	auto& u = Uniforms(frameIndex);
+	auto& u         = Uniforms(frameIndex);
+	u.InstanceCount = 0;
+	_drawCalls      = 0;
+	_drawnInstances = 0;
+	_culledDraws    = 0;
+	_lodDraws.fill(0);
 
 	// Update Camera buffer.
 	if (cameraEntity) {
@@ -253,6 +280,21 @@ void SceneRenderer::Render(Vulkan::CommandBufferHandle& cmd, Luna::Scene& scene,
 			u.SceneData->Light.Radiance     = glm::vec3(0);
 			u.SceneData->Light.Intensity    = 0;
 		}
+
+		// Diffuse lighting from the environment, or none without one.
+		const auto* cEnvironment = skyEntity ? &skyEntity.GetComponent<SkyboxComponent>() : nullptr;
+		for (size_t i = 0; i < std::size(u.SceneData->IrradianceSH); ++i) {
+			u.SceneData->IrradianceSH[i] = cEnvironment ? glm::vec4(cEnvironment->IrradianceSH[i], 0.0f) : glm::vec4(0.0f);
+		}
+	}
+
+	// Gather the draws of every pass up front, so that meshlets can be culled before the scene render pass begins. The
+	// depth pre-pass and lighting pass must draw identical geometry, so they share one list.
+	DrawList shadowDraws, sceneDraws;
+	if (castShadows) { shadowDraws = GatherDraws(scene, cameraEntity, frameIndex, RenderStage::CascadedShadowMap); }
+	if (cameraEntity) {
+		sceneDraws = GatherDraws(scene, cameraEntity, frameIndex, RenderStage::Lighting);
+		CullMeshlets(cmd, frameIndex, sceneDraws);
 	}
 
 	// Render cascaded shadow map.
@@ -281,7 +323,7 @@ void SceneRenderer::Render(Vulkan::CommandBufferHandle& cmd, Luna::Scene& scene,
 			cmd->SetDepthClamp(true);
 			cmd->SetProgram(_shadows);
 			cmd->PushConstants(&i, sizeof(PushConstant), sizeof(i));
-			RenderMeshes(cmd, scene, cameraEntity, frameIndex, RenderStage::CascadedShadowMap);
+			RenderMeshes(cmd, frameIndex, shadowDraws, RenderStage::CascadedShadowMap);
 			cmd->EndRenderPass();
 		}
 
@@ -360,7 +402,7 @@ void SceneRenderer::Render(Vulkan::CommandBufferHandle& cmd, Luna::Scene& scene,
 
 			cmd->SetOpaqueState();
 			cmd->SetProgram(_depthPre);
-			RenderMeshes(cmd, scene, cameraEntity, frameIndex, RenderStage::DepthPrePass);
+			RenderMeshes(cmd, frameIndex, sceneDraws, RenderStage::DepthPrePass);
 		}
 
 		cmd->NextSubpass();
@@ -390,7 +432,30 @@ void SceneRenderer::Render(Vulkan::CommandBufferHandle& cmd, Luna::Scene& scene,
 			} else {
 				cmd->SetTexture(0, 1, _defaultImages.WhiteCSM->GetView(), sampler);
 			}
-			RenderMeshes(cmd, scene, cameraEntity, frameIndex, RenderStage::Lighting);
+
+			// Without an environment, a black cubemap leaves image-based lighting out.
+			const SkyboxComponent* cEnvironment = skyEntity ? &skyEntity.GetComponent<SkyboxComponent>() : nullptr;
+			if (cEnvironment && cEnvironment->Specular && cEnvironment->BrdfLut) {
+				const Vulkan::SamplerCreateInfo environmentSamplerCI{.MagFilter        = vk::Filter::eLinear,
+				                                                     .MinFilter        = vk::Filter::eLinear,
+				                                                     .MipmapMode       = vk::SamplerMipmapMode::eLinear,
+				                                                     .AddressModeU     = vk::SamplerAddressMode::eClampToEdge,
+				                                                     .AddressModeV     = vk::SamplerAddressMode::eClampToEdge,
+				                                                     .AddressModeW     = vk::SamplerAddressMode::eClampToEdge,
+				                                                     .MipLodBias       = 0.0f,
+				                                                     .AnisotropyEnable = VK_FALSE,
+				                                                     .MaxAnisotropy    = 1.0f,
+				                                                     .MinLod           = 0.0f,
+				                                                     .MaxLod           = VK_LOD_CLAMP_NONE,
+				                                                     .BorderColor      = vk::BorderColor::eFloatOpaqueWhite};
+				cmd->SetTexture(
+					2, 0, cEnvironment->Specular->GetView(), _wsi.GetDevice().RequestSampler(environmentSamplerCI));
+				cmd->SetTexture(2, 1, cEnvironment->BrdfLut->GetView(), Vulkan::StockSampler::LinearClamp);
+			} else {
+				cmd->SetTexture(2, 0, _defaultImages.BlackCube->GetView(), Vulkan::StockSampler::LinearClamp);
+				cmd->SetTexture(2, 1, _defaultImages.Black2D->GetView(), Vulkan::StockSampler::LinearClamp);
+			}
+			RenderMeshes(cmd, frameIndex, sceneDraws, RenderStage::Lighting);
 
 			if (skyEntity) {
 				const auto& cSkybox = skyEntity.GetComponent<SkyboxComponent>();
@@ -451,6 +516,25 @@ void SceneRenderer::SetImageSize(const glm::uvec2& size) {
 	}
 }
 
+// Reserves space for count model matrices in this frame's instance buffer, and returns the index of the first.
+uint32_t SceneRenderer::AllocateInstances(RendererUniforms& u, uint32_t count) {
+	if (u.InstanceCount + count > u.InstanceCapacity) {
+		// Passes recorded earlier this frame keep the old buffer alive, so the new one can start from the beginning.
+		u.InstanceCapacity = std::max({u.InstanceCapacity * 2, count, 1024u});
+		u.InstanceCount    = 0;
+
+		const Vulkan::BufferCreateInfo instancesCI(
+			Vulkan::BufferDomain::Host, sizeof(glm::mat4) * u.InstanceCapacity, vk::BufferUsageFlagBits::eStorageBuffer);
+		u.Instances    = _wsi.GetDevice().CreateBuffer(instancesCI);
+		u.InstanceData = reinterpret_cast<glm::mat4*>(u.Instances->Map());
+	}
+
+	const uint32_t first = u.InstanceCount;
+	u.InstanceCount += count;
+
+	return first;
+}
+
 void SceneRenderer::BindUniforms(Luna::Vulkan::CommandBufferHandle& cmd, uint32_t frameIndex) {
 	auto& u = Uniforms(frameIndex);
 	cmd->SetUniformBuffer(0, 0, *u.Scene);
@@ -595,28 +679,52 @@ void SceneRenderer::PrepareCascades(Luna::Scene& scene,
 	}
 }
 
-void SceneRenderer::RenderMeshes(
-	Vulkan::CommandBufferHandle& cmd, Scene& scene, Entity& cameraEntity, uint32_t frameIndex, RenderStage stage) {
+SceneRenderer::DrawList SceneRenderer::GatherDraws(Scene& scene,
+                                                   Entity& cameraEntity,
+                                                   uint32_t frameIndex,
+                                                   RenderStage stage) {
 	static AABB frozenFrustum;
+	static glm::mat4 frozenViewProjection;
+	static glm::vec3 frozenCameraPosition;
 	AABB cameraFrustum;
 	if (_debugFrustumCull) {
 		cameraFrustum = frozenFrustum;
 	} else {
-		cameraFrustum = GetCameraFrustum(cameraEntity);
-		frozenFrustum = cameraFrustum;
+		const auto& cCamera   = cameraEntity.GetComponent<CameraComponent>();
+		const auto& transform = cameraEntity.GetGlobalTransform();
+		cameraFrustum         = GetCameraFrustum(cameraEntity);
+		frozenFrustum         = cameraFrustum;
+		frozenViewProjection  = cCamera.Camera.GetProjection() * glm::inverse(transform);
+		frozenCameraPosition  = glm::vec3(transform[3]);
 	}
 	const bool frustumCull = stage == RenderStage::DepthPrePass || stage == RenderStage::Lighting;
 
-	cmd->SetVertexAttribute(0, 0, vk::Format::eR32G32B32Sfloat, 0);
-	cmd->SetVertexAttribute(1, 1, vk::Format::eR32G32Sfloat, 0);
-
-	if (stage == RenderStage::Lighting) {
-		cmd->SetVertexAttribute(2, 2, vk::Format::eR32G32B32Sfloat, 0);
-		cmd->SetVertexAttribute(3, 3, vk::Format::eR32G32B32Sfloat, 0);
-		cmd->SetVertexAttribute(4, 4, vk::Format::eR32G32B32Sfloat, 0);
-	}
-
-	BindUniforms(cmd, frameIndex);
+	static const MeshInfo defaultMeshInfo;
+	static const std::vector<MeshLod> noLods;
+
+	// Levels of detail are picked by how many pixels their error would cover on screen. Shadow maps hide more error,
+	// so they use a larger threshold.
+	const auto& cCamera            = cameraEntity.GetComponent<CameraComponent>();
+	const glm::vec3 cameraPosition = glm::vec3(cameraEntity.GetGlobalTransform()[3]);
+	const float viewportHeight     = _drawToSwapchain ? _wsi.GetFramebufferSize().y : _imageSize.y;
+	const float pixelsPerUnit      = 0.5f * viewportHeight * glm::abs(cCamera.Camera.GetProjection()[1][1]);
+	const float lodThreshold       = _lodThreshold * (stage == RenderStage::CascadedShadowMap ? _shadowLodBias : 1.0f);
+	const auto SelectLod =
+		[&](const std::vector<MeshLod>& lods, const AABB& bounds, const glm::mat4& transform) -> uint32_t {
+		if (!_meshLods || lods.empty()) { return 0; }
+
+		const glm::vec3 center = glm::vec3(transform * glm::vec4((bounds.GetMin() + bounds.GetMax()) * 0.5f, 1.0f));
+		float scale            = 0.0f;
+		for (int axis = 0; axis < 3; ++axis) { scale = glm::max(scale, glm::length(glm::vec3(transform[axis]))); }
+		const float radius   = 0.5f * glm::length(bounds.GetMax() - bounds.GetMin()) * scale;
+		const float distance = glm::length(center - cameraPosition) - radius;
+		if (distance <= 0.0f) { return 0; }
+
+		uint32_t lod = 0;
+		while (lod < lods.size() && lods[lod].Error * scale * pixelsPerUnit / distance <= lodThreshold) { ++lod; }
+
+		return lod;
+	};
 
 	const auto Intersect = [](const AABB& a, const AABB& b) -> bool {
 		const auto& aMin = a.GetMin();
@@ -632,6 +740,20 @@ void SceneRenderer::RenderMeshes(
 		return true;
 	};
 
+	// Gather every visible submesh along with the transforms it is drawn with: the entity's own, or one per instance.
+	struct DrawItem {
+		const void* Binding;
+		const Mesh* Source;
+		const MeshInfo* Info;
+		uint32_t SubmeshIndex;
+		uint32_t Lod;
+		Material* SubmeshMaterial;
+		uint32_t FirstTransform;
+		uint32_t TransformCount;
+	};
+	std::vector<DrawItem> drawItems;
+	std::vector<glm::mat4> transforms;
+
 	auto renderables = scene.GetRegistry().view<MeshComponent>();
 	for (auto entityId : renderables) {
 		Entity entity(entityId, scene);
@@ -642,52 +764,321 @@ void SceneRenderer::RenderMeshes(
 		}
 
 		const auto& cMesh = renderables.get<MeshComponent>(entityId);
-		const PushConstant pc{.Model = entity.GetGlobalTransform()};
-		cmd->PushConstants(&pc, 0, sizeof(PushConstant));
+		auto& mesh        = cMesh.Mesh;
+		if (!mesh) { continue; }
 
-		auto& mesh = cMesh.Mesh;
-		if (mesh) {
-			cmd->SetVertexBinding(0, *mesh->Buffer, mesh->PositionOffset, sizeof(glm::vec3), vk::VertexInputRate::eVertex);
-			cmd->SetVertexBinding(1, *mesh->Buffer, mesh->Texcoord0Offset, sizeof(glm::vec2), vk::VertexInputRate::eVertex);
+		const auto* meshInfo = &defaultMeshInfo;
+		if (entity.HasComponent<MeshInfoComponent>()) {
+			const auto& cMeshInfo = entity.GetComponent<MeshInfoComponent>();
+			if (cMeshInfo.Info) { meshInfo = cMeshInfo.Info.get(); }
+		}
 
-			if (stage == RenderStage::Lighting) {
-				cmd->SetVertexBinding(2, *mesh->Buffer, mesh->NormalOffset, sizeof(glm::vec3), vk::VertexInputRate::eVertex);
-				cmd->SetVertexBinding(3, *mesh->Buffer, mesh->TangentOffset, sizeof(glm::vec3), vk::VertexInputRate::eVertex);
-				cmd->SetVertexBinding(4, *mesh->Buffer, mesh->BitangentOffset, sizeof(glm::vec3), vk::VertexInputRate::eVertex);
-			}
+		// Pooled meshes share the buffers of their arena, while other meshes bind their own buffer.
+		const auto* geometry = meshInfo->Geometry.get();
+		const void* binding =
+			geometry ? static_cast<const void*>(geometry->Arena) : static_cast<const void*>(mesh->Buffer.Get());
 
-			cmd->SetIndexBuffer(*mesh->Buffer, mesh->IndexOffset, vk::IndexType::eUint32);
+		// Instanced entities are culled as a whole by the combined bounds of their instances, checked above.
+		const std::vector<glm::mat4>* instances = nullptr;
+		if (entity.HasComponent<InstancesComponent>()) {
+			const auto& cInstances = entity.GetComponent<InstancesComponent>();
+			if (cInstances.Transforms && !cInstances.Transforms->empty()) { instances = cInstances.Transforms.get(); }
+		}
 
-			for (auto& submesh : mesh->Submeshes) {
-				if (frustumCull) {
-					auto submeshBounds = submesh.Bounds;
-					submeshBounds.Transform(pc.Model);
-					if (!Intersect(cameraFrustum, submeshBounds)) { continue; }
+		const auto& materials = meshInfo->Materials ? meshInfo->Materials->Materials : cMesh.Materials;
+		const glm::mat4 model = entity.GetGlobalTransform();
+		for (uint32_t submeshIndex = 0; submeshIndex < mesh->Submeshes.size(); ++submeshIndex) {
+			const auto& submesh = mesh->Submeshes[submeshIndex];
+			if (frustumCull && !instances) {
+				auto submeshBounds = submesh.Bounds;
+				submeshBounds.Transform(model);
+				if (!Intersect(cameraFrustum, submeshBounds)) { continue; }
+			}
+
+			const bool hasMaterial = submesh.MaterialIndex < materials.size() && materials[submesh.MaterialIndex];
+			auto& material         = hasMaterial ? materials[submesh.MaterialIndex] : _nullMaterial;
+			const auto& lods =
+				submeshIndex < meshInfo->SubmeshLods.size() ? meshInfo->SubmeshLods[submeshIndex] : noLods;
+
+			// Instances pick their level of detail individually, and are grouped into one item per level.
+			std::array<std::vector<glm::mat4>, MeshInfo::MaxLodCount> lodTransforms;
+			if (instances) {
+				for (const auto& instance : *instances) {
+					const glm::mat4 transform = model * instance;
+					lodTransforms[SelectLod(lods, submesh.Bounds, transform)].push_back(transform);
 				}
+			} else {
+				lodTransforms[SelectLod(lods, submesh.Bounds, model)].push_back(model);
+			}
+
+			for (uint32_t lod = 0; lod < MeshInfo::MaxLodCount; ++lod) {
+				if (lodTransforms[lod].empty()) { continue; }
+
+				drawItems.push_back({.Binding         = binding,
+				                     .Source          = mesh.Get(),
+				                     .Info            = meshInfo,
+				                     .SubmeshIndex    = submeshIndex,
+				                     .Lod             = lod,
+				                     .SubmeshMaterial = material.Get(),
+				                     .FirstTransform  = static_cast<uint32_t>(transforms.size()),
+				                     .TransformCount  = static_cast<uint32_t>(lodTransforms[lod].size())});
+				transforms.insert(transforms.end(), lodTransforms[lod].begin(), lodTransforms[lod].end());
+			}
+		}
+	}
 
-				const bool hasMaterial =
-					submesh.MaterialIndex < cMesh.Materials.size() && cMesh.Materials[submesh.MaterialIndex];
-				auto& material = hasMaterial ? cMesh.Materials[submesh.MaterialIndex] : _nullMaterial;
-				material->Update(_wsi.GetDevice());
+	DrawList draws;
+	draws.CullViewProjection = frozenViewProjection;
+	draws.CullCameraPosition = frozenCameraPosition;
+	if (drawItems.empty()) { return draws; }
+
+	// Sort so that every instance of a (mesh, submesh, level of detail, material) is adjacent and can be drawn with one
+	// instanced call. Sorting on the geometry binding first keeps vertex and index buffer rebinds to a minimum.
+	std::sort(drawItems.begin(), drawItems.end(), [](const DrawItem& a, const DrawItem& b) {
+		return std::tie(a.Binding, a.Source, a.SubmeshIndex, a.Lod, a.SubmeshMaterial) <
+		       std::tie(b.Binding, b.Source, b.SubmeshIndex, b.Lod, b.SubmeshMaterial);
+	});
+
+	// Model matrices are read by the vertex shaders from the instance buffer, indexed by gl_InstanceIndex.
+	uint32_t totalInstances = 0;
+	for (const auto& item : drawItems) { totalInstances += item.TransformCount; }
+	auto& u            = Uniforms(frameIndex);
+	uint32_t instance  = AllocateInstances(u, totalInstances);
+	draws.Instances    = u.Instances;
+	draws.InstanceData = u.InstanceData;
+
+	for (size_t begin = 0, end = 0; begin < drawItems.size(); begin = end) {
+		const auto& item = drawItems[begin];
+		DrawBatch batch{.Binding         = item.Binding,
+		                .Source          = item.Source,
+		                .Info            = item.Info,
+		                .SubmeshIndex    = item.SubmeshIndex,
+		                .Lod             = item.Lod,
+		                .SubmeshMaterial = item.SubmeshMaterial,
+		                .FirstInstance   = instance,
+		                .InstanceCount   = 0};
+		for (end = begin; end < drawItems.size(); ++end) {
+			const auto& other = drawItems[end];
+			if (other.Source != item.Source || other.SubmeshIndex != item.SubmeshIndex || other.Lod != item.Lod ||
+			    other.SubmeshMaterial != item.SubmeshMaterial) {
+				break;
+			}
+			std::copy_n(&transforms[other.FirstTransform], other.TransformCount, &u.InstanceData[instance]);
+			instance += other.TransformCount;
+			batch.InstanceCount += other.TransformCount;
+		}
+		draws.Batches.push_back(batch);
+	}
+
+	return draws;
+}
 
-				cmd->SetCullMode(material->DualSided ? vk::CullModeFlagBits::eNone : vk::CullModeFlagBits::eBack);
+void SceneRenderer::CullMeshlets(Vulkan::CommandBufferHandle& cmd, uint32_t frameIndex, DrawList& draws) {
+	if (!_meshletCulling || !_meshletCull) { return; }
+
+	// Batches of a single pooled instance are culled per meshlet. Instanced batches would need an output range per
+	// instance, so they are left to the per-submesh culling done while gathering. Meshlets only cover the full level of
+	// detail, as simplified levels are cheap to draw whole.
+	std::vector<MeshletCullJob> jobs;
+	std::vector<vk::DrawIndexedIndirectCommand> commands;
+	std::vector<std::pair<const GeometryPool::Arena*, uint32_t>> arenaJobs;
+	uint32_t culledIndexCount = 0;
+	for (auto& batch : draws.Batches) {
+		const auto* geometry = batch.Info->Geometry.get();
+		if (batch.InstanceCount != 1 || batch.Lod != 0 || !geometry || !geometry->Arena->Meshlets ||
+		    batch.SubmeshIndex >= batch.Info->SubmeshMeshlets.size()) {
+			continue;
+		}
+		const auto& meshlets = batch.Info->SubmeshMeshlets[batch.SubmeshIndex];
+		const auto& submesh  = batch.Source->Submeshes[batch.SubmeshIndex];
+		if (meshlets.MeshletCount == 0 || submesh.IndexCount == 0) { continue; }
+
+		// Cone culling assumes back faces are culled, and that the transform preserves angles and winding.
+		const glm::mat3 model = glm::mat3(draws.InstanceData[batch.FirstInstance]);
+		const float scaleX    = glm::length(model[0]);
+		const bool uniform    = glm::abs(glm::length(model[1]) - scaleX) <= scaleX * 1e-3f &&
+		                        glm::abs(glm::length(model[2]) - scaleX) <= scaleX * 1e-3f;
+		const bool coneCull   = !batch.SubmeshMaterial->DualSided && uniform && glm::determinant(model) > 0.0f;
+
+		if (arenaJobs.empty() || arenaJobs.back().first != geometry->Arena) {
+			arenaJobs.emplace_back(geometry->Arena, static_cast<uint32_t>(jobs.size()));
+		}
+		batch.CulledDraw = static_cast<uint32_t>(commands.size());
+		jobs.push_back({.FirstMeshlet = geometry->FirstMeshlet + meshlets.FirstMeshlet,
+		                .MeshletCount = meshlets.MeshletCount,
+		                .Instance     = batch.FirstInstance,
+		                .Draw         = batch.CulledDraw,
+		                .OutputOffset = culledIndexCount,
+		                .ConeCull     = coneCull ? 1u : 0u});
+		commands.push_back(vk::DrawIndexedIndirectCommand(0,
+		                                                  1,
+		                                                  culledIndexCount,
+		                                                  static_cast<int32_t>(submesh.FirstVertex),
+		                                                  batch.FirstInstance));
+		culledIndexCount += static_cast<uint32_t>(submesh.IndexCount);
+	}
+	_culledDraws = static_cast<uint32_t>(jobs.size());
+	if (jobs.empty()) { return; }
+
+	// Jobs and the initial draw commands are written by the host, while the surviving indices never leave the GPU.
+	auto& u      = Uniforms(frameIndex);
+	auto& device = _wsi.GetDevice();
+	const auto Reserve = [&](Vulkan::BufferHandle& buffer,
+	                         uint32_t& capacity,
+	                         uint32_t count,
+	                         vk::DeviceSize elementSize,
+	                         Vulkan::BufferDomain domain,
+	                         vk::BufferUsageFlags usage) -> void {
+		if (count <= capacity) { return; }
+
+		capacity = std::max(capacity * 2, count);
+		buffer   = device.CreateBuffer(
+			Vulkan::BufferCreateInfo(domain, capacity * elementSize, usage | vk::BufferUsageFlagBits::eStorageBuffer));
+	};
+	const auto jobCount = static_cast<uint32_t>(jobs.size());
+	Reserve(u.CullJobs, u.CullJobCapacity, jobCount, sizeof(MeshletCullJob), Vulkan::BufferDomain::Host, {});
+	Reserve(u.CulledDraws,
+	        u.CulledDrawCapacity,
+	        jobCount,
+	        sizeof(vk::DrawIndexedIndirectCommand),
+	        Vulkan::BufferDomain::Host,
+	        vk::BufferUsageFlagBits::eIndirectBuffer);
+	Reserve(u.CulledIndices,
+	        u.CulledIndexCapacity,
+	        culledIndexCount,
+	        sizeof(uint32_t),
+	        Vulkan::BufferDomain::Device,
+	        vk::BufferUsageFlagBits::eIndexBuffer);
+	memcpy(u.CullJobs->Map(), jobs.data(), jobs.size() * sizeof(MeshletCullJob));
+	memcpy(u.CulledDraws->Map(), commands.data(), commands.size() * sizeof(vk::DrawIndexedIndirectCommand));
+	draws.CulledDraws   = u.CulledDraws;
+	draws.CulledIndices = u.CulledIndices;
+
+	cmd->SetProgram(_meshletCull);
+	cmd->SetStorageBuffer(0, 2, *draws.Instances);
+	cmd->SetStorageBuffer(0, 3, *u.CullJobs);
+	cmd->SetStorageBuffer(0, 6, *u.CulledIndices);
+	cmd->SetStorageBuffer(0, 7, *u.CulledDraws);
+	for (size_t i = 0; i < arenaJobs.size(); ++i) {
+		const auto* arena    = arenaJobs[i].first;
+		const uint32_t begin = arenaJobs[i].second;
+		const uint32_t end   = i + 1 < arenaJobs.size() ? arenaJobs[i + 1].second : jobCount;
+		const MeshletCullPushConstant push{
+			.ViewProjection = draws.CullViewProjection,
+			.CameraPosition = glm::vec4(draws.CullCameraPosition, 1.0f),
+			.FirstJob       = begin,
+			.ShortIndices   = arena->Layout.IndexType == vk::IndexType::eUint16 ? 1u : 0u};
+		cmd->SetStorageBuffer(0, 4, *arena->Meshlets);
+		cmd->SetStorageBuffer(0, 5, *arena->Indices);
+		cmd->PushConstants(&push, 0, sizeof(push));
+		cmd->Dispatch(end - begin, 1, 1);
+	}
 
-				cmd->SetUniformBuffer(1, 0, *material->DataBuffer);
-				SetTexture(cmd, 1, 1, material->Albedo, _defaultImages.White2D);
+	const vk::MemoryBarrier barrier(vk::AccessFlagBits::eShaderWrite,
+	                                vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eIndexRead);
+	cmd->Barrier(vk::PipelineStageFlagBits::eComputeShader,
+	             vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eVertexInput,
+	             {barrier},
+	             {},
+	             {});
+}
 
-				if (stage == RenderStage::Lighting) {
-					SetTexture(cmd, 1, 2, material->Normal, _defaultImages.Normal2D);
-					SetTexture(cmd, 1, 3, material->PBR, _defaultImages.White2D);
-					SetTexture(cmd, 1, 4, material->Emissive, _defaultImages.Black2D);
-				}
+void SceneRenderer::RenderMeshes(Vulkan::CommandBufferHandle& cmd,
+                                 uint32_t frameIndex,
+                                 const DrawList& draws,
+                                 RenderStage stage) {
+	if (draws.Batches.empty()) { return; }
 
-				if (submesh.IndexCount > 0) {
-					cmd->DrawIndexed(submesh.IndexCount, 1, submesh.FirstIndex, submesh.FirstVertex, 0);
-				} else {
-					cmd->Draw(submesh.VertexCount, 1, submesh.FirstVertex, 0);
-				}
+	BindUniforms(cmd, frameIndex);
+	cmd->SetStorageBuffer(0, 2, *draws.Instances);
+
+	const void* boundGeometry = nullptr;
+	std::tuple<const Vulkan::Buffer*, vk::DeviceSize, vk::IndexType> boundIndices;
+	for (const auto& batch : draws.Batches) {
+		const auto& mesh     = *batch.Source;
+		const auto* meshInfo = batch.Info;
+		const auto* geometry = meshInfo->Geometry.get();
+		const auto& submesh  = mesh.Submeshes[batch.SubmeshIndex];
+		auto* material       = batch.SubmeshMaterial;
+		const bool culled    = batch.CulledDraw != DrawBatch::NotCulled;
+
+		if (stage == RenderStage::Lighting) { cmd->SetProgram(meshInfo->Compact ? _programCompact : _program); }
+
+		if (batch.Binding != boundGeometry) {
+			boundGeometry = batch.Binding;
+
+			const auto BindStream = [&](uint32_t location, const VertexStream& stream, size_t streamIndex) {
+				const vk::DeviceSize offsets[] = {
+					mesh.PositionOffset, mesh.NormalOffset, mesh.TangentOffset, mesh.BitangentOffset, mesh.Texcoord0Offset};
+				const auto& buffer = geometry ? *geometry->Arena->Streams[streamIndex] : *mesh.Buffer;
+				cmd->SetVertexAttribute(location, location, stream.Format, 0);
+				cmd->SetVertexBinding(
+					location, buffer, geometry ? 0 : offsets[streamIndex], stream.Stride, vk::VertexInputRate::eVertex);
+			};
+			BindStream(0, meshInfo->Position, 0);
+			BindStream(1, meshInfo->Texcoord0, 4);
+			if (stage == RenderStage::Lighting) {
+				BindStream(2, meshInfo->Normal, 1);
+				BindStream(3, meshInfo->Tangent, 2);
+				if (!meshInfo->Compact) { BindStream(4, meshInfo->Bitangent, 3); }
 			}
 		}
+
+		// Meshlet-culled batches draw the surviving 32-bit indices, written to one buffer for the whole frame.
+		std::tuple<const Vulkan::Buffer*, vk::DeviceSize, vk::IndexType> indices;
+		if (culled) {
+			indices = {draws.CulledIndices.Get(), 0, vk::IndexType::eUint32};
+		} else if (geometry) {
+			indices = {geometry->Arena->Indices.Get(), 0, meshInfo->IndexType};
+		} else {
+			indices = {mesh.Buffer.Get(), mesh.IndexOffset, meshInfo->IndexType};
+		}
+		if (std::get<0>(indices) && indices != boundIndices) {
+			boundIndices = indices;
+			cmd->SetIndexBuffer(*std::get<0>(indices), std::get<1>(indices), std::get<2>(indices));
+		}
+
+		material->Update(_wsi.GetDevice());
+		cmd->SetCullMode(material->DualSided ? vk::CullModeFlagBits::eNone : vk::CullModeFlagBits::eBack);
+
+		// Compact positions are stored relative to the bounds of their submesh.
+		PushConstant pc;
+		if (meshInfo->Compact) {
+			pc.PositionOffset = glm::vec4(submesh.Bounds.GetMin(), 0.0f);
+			pc.PositionScale  = glm::vec4(submesh.Bounds.GetMax() - submesh.Bounds.GetMin(), 0.0f);
+		}
+		cmd->PushConstants(&pc, 0, sizeof(PushConstant));
+
+		cmd->SetUniformBuffer(1, 0, *material->DataBuffer);
+		SetTexture(cmd, 1, 1, material->Albedo, _defaultImages.White2D);
+
+		if (stage == RenderStage::Lighting) {
+			SetTexture(cmd, 1, 2, material->Normal, _defaultImages.Normal2D);
+			SetTexture(cmd, 1, 3, material->PBR, _defaultImages.White2D);
+			SetTexture(cmd, 1, 4, material->Emissive, _defaultImages.Black2D);
+		}
+
+		if (culled) {
+			cmd->DrawIndexedIndirect(*draws.CulledDraws,
+			                         batch.CulledDraw * sizeof(vk::DrawIndexedIndirectCommand),
+			                         1,
+			                         sizeof(vk::DrawIndexedIndirectCommand));
+		} else if (batch.Lod > 0) {
+			const auto& lod = meshInfo->SubmeshLods[batch.SubmeshIndex][batch.Lod - 1];
+			cmd->DrawIndexed(lod.IndexCount,
+			                 batch.InstanceCount,
+			                 submesh.FirstIndex + lod.FirstIndex,
+			                 submesh.FirstVertex,
+			                 batch.FirstInstance);
+		} else if (submesh.IndexCount > 0) {
+			cmd->DrawIndexed(
+				submesh.IndexCount, batch.InstanceCount, submesh.FirstIndex, submesh.FirstVertex, batch.FirstInstance);
+		} else {
+			cmd->Draw(submesh.VertexCount, batch.InstanceCount, submesh.FirstVertex, batch.FirstInstance);
+		}
+		++_drawCalls;
+		_drawnInstances += batch.InstanceCount;
+		_lodDraws[batch.Lod] += batch.InstanceCount;
 	}
 }
 
@@ -709,6 +1100,26 @@ void SceneRenderer::SetTexture(Luna::Vulkan::CommandBufferHandle& cmd,
 void SceneRenderer::ShowSettings() {
 	if (ImGui::Begin("Renderer")) {
 		ImGui::Checkbox("Freeze Frustum", &_debugFrustumCull);
+		ImGui::Text("Draw Calls: %u (%u instances)", _drawCalls, _drawnInstances);
+		ImGui::Checkbox("Meshlet Culling", &_meshletCulling);
+		ImGui::Text("Meshlet Culled Draws: %u", _culledDraws);
+
+		if (ImGui::CollapsingHeader(ICON_FA_CUBES " Level of Detail")) {
+			ImGui::Checkbox("Mesh LODs", &_meshLods);
+			ImGui::SliderFloat("Error Threshold (px)", &_lodThreshold, 0.25f, 16.0f, "%.2f");
+			ImGui::SliderFloat("Shadow Bias", &_shadowLodBias, 1.0f, 16.0f, "%.1fx");
+			ImGui::Text("Instances per LOD: %u / %u / %u / %u", _lodDraws[0], _lodDraws[1], _lodDraws[2], _lodDraws[3]);
+		}
+
+		if (ImGui::CollapsingHeader(ICON_FA_UPLOAD " Uploads")) {
+			constexpr double MiB = 1024.0 * 1024.0;
+			ImGui::Text("Throughput: %.1f MB/s", _uploads.GetThroughput() / MiB);
+			ImGui::Text("Queued: %zu images (%.1f MB)", _uploads.GetQueuedImageCount(), _uploads.GetQueuedSize() / MiB);
+			int budget = static_cast<int>(_uploads.GetFrameBudget() / (1024 * 1024));
+			if (ImGui::SliderInt("Frame Budget (MB)", &budget, 1, 256)) {
+				_uploads.SetFrameBudget(vk::DeviceSize(budget) * 1024 * 1024);
+			}
+		}
 
 		if (ImGui::CollapsingHeader(ICON_FA_MOON " Shadows", ImGuiTreeNodeFlags_DefaultOpen)) {
 			if (ImGui::BeginTable("LightComponent_Properties", 2, ImGuiTableFlags_BordersInnerV)) {
@@ -1,19 +1,26 @@
 #pragma once
 
 #include <Assets/Material.hpp>
+#include <Assets/Mesh.hpp>
 #include <Assets/Texture.hpp>
 #include <Scene/Entity.hpp>
 #include <Utility/AABB.hpp>
 #include <Vulkan/Common.hpp>
+#include <array>
 #include <glm/glm.hpp>
+#include <vector>
+
+#include "MeshInfoComponent.hpp"
 
 namespace Luna {
 class Scene;
 }
 
+class UploadManager;
+
 class SceneRenderer {
  public:
-	SceneRenderer(Luna::Vulkan::WSI& wsi);
+	SceneRenderer(Luna::Vulkan::WSI& wsi, UploadManager& uploads);
 	~SceneRenderer() noexcept;
 
 	Luna::Vulkan::ImageHandle& GetImage(uint32_t frameIndex);
@@ -47,10 +54,13 @@ class SceneRenderer {
 		int CastShadows;
 		int SoftShadows;
 		int DebugShowCascades;
+		// Padded to vec4 for std140.
+		glm::vec4 IrradianceSH[9];
 	};
 
 	struct PushConstant {
-		glm::mat4 Model;
+		glm::vec4 PositionOffset = glm::vec4(0.0f);
+		glm::vec4 PositionScale  = glm::vec4(1.0f);
 	};
 
 	struct DefaultImages {
@@ -66,17 +76,77 @@ class SceneRenderer {
 
 	struct RendererUniforms {
 		Luna::Vulkan::BufferHandle Scene;
+		// Model matrices of every instance drawn this frame, shared by all passes.
+		Luna::Vulkan::BufferHandle Instances;
+
+		SceneData* SceneData      = nullptr;
+		glm::mat4* InstanceData   = nullptr;
+		uint32_t InstanceCapacity = 0;
+		uint32_t InstanceCount    = 0;
+
+		// Meshlet culling jobs, the indirect draw of each culled batch, and the indices of the meshlets that survived.
+		Luna::Vulkan::BufferHandle CullJobs;
+		Luna::Vulkan::BufferHandle CulledDraws;
+		Luna::Vulkan::BufferHandle CulledIndices;
+		uint32_t CullJobCapacity     = 0;
+		uint32_t CulledDrawCapacity  = 0;
+		uint32_t CulledIndexCapacity = 0;
+	};
 
-		SceneData* SceneData = nullptr;
+	// One draw call covering every instance of a submesh with a given material.
+	struct DrawBatch {
+		static constexpr uint32_t NotCulled = ~0u;
+
+		const void* Binding;
+		const Luna::Mesh* Source;
+		const MeshInfo* Info;
+		uint32_t SubmeshIndex;
+		uint32_t Lod;
+		Luna::Material* SubmeshMaterial;
+		uint32_t FirstInstance;
+		uint32_t InstanceCount;
+		// The indirect draw of a batch culled per meshlet on the GPU.
+		uint32_t CulledDraw = NotCulled;
 	};
 
+	struct DrawList {
+		std::vector<DrawBatch> Batches;
+		Luna::Vulkan::BufferHandle Instances;
+		const glm::mat4* InstanceData = nullptr;
+		Luna::Vulkan::BufferHandle CulledDraws;
+		Luna::Vulkan::BufferHandle CulledIndices;
+		// The view the draws were culled for on the CPU, which may be frozen for debugging, for culling meshlets with.
+		glm::mat4 CullViewProjection = glm::mat4(1.0f);
+		glm::vec3 CullCameraPosition = glm::vec3(0.0f);
+	};
+
+	// Matches the layout of MeshletCull.comp.glsl.
+	struct MeshletCullJob {
+		uint32_t FirstMeshlet;
+		uint32_t MeshletCount;
+		uint32_t Instance;
+		uint32_t Draw;
+		uint32_t OutputOffset;
+		uint32_t ConeCull;
+		uint32_t Padding[2] = {};
+	};
+	struct MeshletCullPushConstant {
+		glm::mat4 ViewProjection;
+		glm::vec4 CameraPosition;
+		uint32_t FirstJob;
+		uint32_t ShortIndices;
+	};
+
+	uint32_t AllocateInstances(RendererUniforms& u, uint32_t count);
+
 	void BindUniforms(Luna::Vulkan::CommandBufferHandle& cmd, uint32_t frameIndex);
 	Luna::AABB GetCameraFrustum(Luna::Entity& cameraEntity);
 	void PrepareCascades(Luna::Scene& scene, Luna::Entity& cameraEntity, Luna::Entity& sunEntity, uint32_t frameIndex);
+	void CullMeshlets(Luna::Vulkan::CommandBufferHandle& cmd, uint32_t frameIndex, DrawList& draws);
+	DrawList GatherDraws(Luna::Scene& scene, Luna::Entity& cameraEntity, uint32_t frameIndex, RenderStage stage);
 	void RenderMeshes(Luna::Vulkan::CommandBufferHandle& cmd,
-	                  Luna::Scene& scene,
-	                  Luna::Entity& cameraEntity,
 	                  uint32_t frameIndex,
+	                  const DrawList& draws,
 	                  RenderStage stage);
 	void SetTexture(Luna::Vulkan::CommandBufferHandle& cmd,
 	                uint32_t set,
@@ -86,14 +156,17 @@ class SceneRenderer {
 	RendererUniforms& Uniforms(uint32_t frameIndex);
 
 	Luna::Vulkan::WSI& _wsi;
+	UploadManager& _uploads;
 	DefaultImages _defaultImages;
 	Luna::MaterialHandle _nullMaterial;
-	Luna::Vulkan::Program* _depthPre = nullptr;
-	Luna::Vulkan::Program* _program  = nullptr;
-	Luna::Vulkan::Program* _shadows  = nullptr;
-	Luna::Vulkan::Program* _skybox   = nullptr;
-	bool _drawToSwapchain            = true;
-	glm::uvec2 _imageSize            = glm::uvec2(0);
+	Luna::Vulkan::Program* _depthPre       = nullptr;
+	Luna::Vulkan::Program* _meshletCull    = nullptr;
+	Luna::Vulkan::Program* _program        = nullptr;
+	Luna::Vulkan::Program* _programCompact = nullptr;
+	Luna::Vulkan::Program* _shadows        = nullptr;
+	Luna::Vulkan::Program* _skybox         = nullptr;
+	bool _drawToSwapchain                  = true;
+	glm::uvec2 _imageSize                  = glm::uvec2(0);
 	std::vector<Luna::Vulkan::ImageHandle> _sceneImages;
 	Luna::Vulkan::ImageHandle _shadowMap;
 	std::vector<Luna::Vulkan::ImageViewHandle> _shadowCascades;
@@ -105,6 +178,16 @@ class SceneRenderer {
 	bool _debugCSM           = false;
 	bool _debugCSMSplit      = false;
 	bool _debugFrustumCull   = false;
+	bool _meshletCulling     = true;
+	bool _meshLods           = true;
+	float _lodThreshold      = 1.0f;
+	float _shadowLodBias     = 4.0f;
 	bool _usePersistentDepth = false;
 	Luna::Vulkan::ImageHandle _persistentDepth;
+
+	// Statistics
+	uint32_t _drawCalls      = 0;
+	uint32_t _drawnInstances = 0;
+	uint32_t _culledDraws    = 0;
+	std::array<uint32_t, MeshInfo::MaxLodCount> _lodDraws = {};
 };
@@ -2,9 +2,17 @@
 
 #include <Vulkan/Common.hpp>
 
+#include "SphericalHarmonics.hpp"
+
 struct SkyboxComponent {
 	SkyboxComponent()                       = default;
 	SkyboxComponent(const SkyboxComponent&) = default;
 
 	Luna::Vulkan::ImageHandle Skybox;
+	// Image-based lighting: the skybox prefiltered for specular reflections of increasing roughness in each mip level,
+	// and the split-sum BRDF lookup table.
+	Luna::Vulkan::ImageHandle Specular;
+	Luna::Vulkan::ImageHandle BrdfLut;
+	// Diffuse lighting from the environment, already convolved. See SphericalHarmonics::RadianceToIrradiance.
+	SphericalHarmonics::Coefficients IrradianceSH = {};
 };
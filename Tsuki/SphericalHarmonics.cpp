@@ -0,0 +1,94 @@
+#include "SphericalHarmonics.hpp"
+
+#include <cmath>
+#include <glm/gtc/constants.hpp>
+#include <vector>
+
+namespace SphericalHarmonics {
+namespace {
+constexpr float Y00 = 0.282095f;  // L00
+constexpr float Y1  = 0.488603f;  // L1-1, L10, L11
+constexpr float Y2  = 1.092548f;  // L2-2, L2-1, L21
+constexpr float Y20 = 0.315392f;  // L20
+constexpr float Y22 = 0.546274f;  // L22
+
+// The value each E5B9G9R9 exponent scales the 9-bit mantissas by.
+const std::array<float, 32> ExponentScales = []() {
+	std::array<float, 32> scales;
+	for (int exponent = 0; exponent < 32; ++exponent) { scales[exponent] = std::ldexp(1.0f, exponent - 15 - 9); }
+
+	return scales;
+}();
+}  // namespace
+
+void ProjectEquirectRows(const uint32_t* texels,
+                         uint32_t width,
+                         uint32_t height,
+                         uint32_t firstRow,
+                         uint32_t rowCount,
+                         Coefficients& radiance) {
+	// The same mapping EquirectToCube samples the panorama with: columns go around the vertical (Y) axis starting from
+	// -X, and rows go from the bottom to the top.
+	std::vector<float> cosPhi(width), sinPhi(width);
+	for (uint32_t x = 0; x < width; ++x) {
+		const float phi = ((float(x) + 0.5f) / float(width) - 0.5f) * glm::two_pi<float>();
+		cosPhi[x]       = std::cos(phi);
+		sinPhi[x]       = std::sin(phi);
+	}
+
+	for (uint32_t row = 0; row < rowCount; ++row) {
+		const uint32_t* rowTexels = texels + size_t(row) * width;
+		const float theta         = ((float(firstRow + row) + 0.5f) / float(height) - 0.5f) * glm::pi<float>();
+		const float cosTheta      = std::cos(theta);
+		const float sinTheta      = std::sin(theta);
+
+		// The height of the direction is the same along a row, so every basis function factors into a term of the row and
+		// a term of the column. Each row is reduced to six sums of its texels weighted by column terms, which is all the
+		// coefficients need, and leaves the inner loop without any branches or trigonometry.
+		glm::vec3 sum(0.0f), sumCos(0.0f), sumSin(0.0f), sumCosCos(0.0f), sumSinCos(0.0f), sumSinSin(0.0f);
+		for (uint32_t x = 0; x < width; ++x) {
+			const uint32_t texel     = rowTexels[x];
+			const float scale        = ExponentScales[texel >> 27];
+			const glm::vec3 color    = glm::vec3(texel & 0x1ff, (texel >> 9) & 0x1ff, (texel >> 18) & 0x1ff) * scale;
+			const glm::vec3 colorCos = color * cosPhi[x];
+			const glm::vec3 colorSin = color * sinPhi[x];
+
+			sum += color;
+			sumCos += colorCos;
+			sumSin += colorSin;
+			sumCosCos += colorCos * cosPhi[x];
+			sumSinCos += colorSin * cosPhi[x];
+			sumSinSin += colorSin * sinPhi[x];
+		}
+
+		// Each texel covers a solid angle that shrinks towards the poles.
+		const float weight = (glm::two_pi<float>() / float(width)) * (glm::pi<float>() / float(height)) * cosTheta;
+		const float cos2   = cosTheta * cosTheta;
+		radiance[0] += sum * (weight * Y00);
+		radiance[1] += sum * (weight * Y1 * sinTheta);
+		radiance[2] += sumSin * (weight * Y1 * cosTheta);
+		radiance[3] += sumCos * (weight * Y1 * cosTheta);
+		radiance[4] += sumCos * (weight * Y2 * cosTheta * sinTheta);
+		radiance[5] += sumSin * (weight * Y2 * cosTheta * sinTheta);
+		radiance[6] += (sumSinSin * (3.0f * cos2) - sum) * (weight * Y20);
+		radiance[7] += sumSinCos * (weight * Y2 * cos2);
+		radiance[8] += (sumCosCos * cos2 - sum * (sinTheta * sinTheta)) * (weight * Y22);
+	}
+}
+
+Coefficients RadianceToIrradiance(const Coefficients& radiance) {
+	// The cosine lobe scales each band by Pi, 2Pi/3 and Pi/4, which leaves 1, 2/3 and 1/4 once divided by Pi.
+	constexpr float Band1 = 2.0f / 3.0f;
+	constexpr float Band2 = 1.0f / 4.0f;
+
+	return Coefficients{radiance[0] * Y00,
+	                    radiance[1] * (Band1 * Y1),
+	                    radiance[2] * (Band1 * Y1),
+	                    radiance[3] * (Band1 * Y1),
+	                    radiance[4] * (Band2 * Y2),
+	                    radiance[5] * (Band2 * Y2),
+	                    radiance[6] * (Band2 * Y20),
+	                    radiance[7] * (Band2 * Y2),
+	                    radiance[8] * (Band2 * Y22)};
+}
+}  // namespace SphericalHarmonics
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+// Diffuse lighting from an environment as third-order (nine coefficient) spherical harmonics, so that it can be
+// evaluated per pixel with a handful of multiply-adds instead of sampling a convolved irradiance cubemap.
+namespace SphericalHarmonics {
+// Coefficients of the bands in order: L00, L1-1, L10, L11, L2-2, L2-1, L20, L21, L22.
+using Coefficients = std::array<glm::vec3, 9>;
+
+// Adds rows of an equirectangular E5B9G9R9 panorama to the projection of its radiance. Rows are numbered in the order
+// the image is stored and sampled in, with the first row at the bottom of the sphere.
+void ProjectEquirectRows(const uint32_t* texels,
+                         uint32_t width,
+                         uint32_t height,
+                         uint32_t firstRow,
+                         uint32_t rowCount,
+                         Coefficients& radiance);
+
+// Convolves projected radiance with the cosine lobe and divides it by Pi, with the constants of each basis function
+// folded in. Evaluating the result for a normal (see PBR.frag.glsl) gives the diffuse lighting of a white surface.
+Coefficients RadianceToIrradiance(const Coefficients& radiance);
+}  // namespace SphericalHarmonics
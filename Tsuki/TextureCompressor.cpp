@@ -0,0 +1,405 @@
+#include "TextureCompressor.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+
+namespace TextureCompressor {
+namespace {
+struct ColorBlock {
+	float Texels[16][4];
+};
+
+// Lookup tables for sRGB <-> linear conversion, built on first use.
+struct SrgbTables {
+	SrgbTables() {
+		for (int i = 0; i < 256; ++i) {
+			const float c = i / 255.0f;
+			ToLinear[i]   = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+		}
+		for (int i = 0; i < 4096; ++i) {
+			const float l = i / 4095.0f;
+			const float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+			ToSrgb[i]     = static_cast<uint8_t>(std::clamp(c * 255.0f + 0.5f, 0.0f, 255.0f));
+		}
+	}
+
+	float ToLinear[256];
+	uint8_t ToSrgb[4096];
+};
+
+const SrgbTables& GetSrgbTables() {
+	static const SrgbTables tables;
+	return tables;
+}
+
+// Finds the dominant direction of the texels in the first N channels, using a few rounds of power iteration.
+template <int N>
+void PrincipalAxis(const ColorBlock& block, float mean[N], float axis[N]) {
+	for (int c = 0; c < N; ++c) {
+		mean[c] = 0.0f;
+		for (int i = 0; i < 16; ++i) { mean[c] += block.Texels[i][c]; }
+		mean[c] /= 16.0f;
+	}
+
+	float cov[N][N] = {};
+	for (int i = 0; i < 16; ++i) {
+		float d[N];
+		for (int c = 0; c < N; ++c) { d[c] = block.Texels[i][c] - mean[c]; }
+		for (int a = 0; a < N; ++a) {
+			for (int b = 0; b < N; ++b) { cov[a][b] += d[a] * d[b]; }
+		}
+	}
+
+	for (int c = 0; c < N; ++c) { axis[c] = 1.0f; }
+	for (int iter = 0; iter < 8; ++iter) {
+		float next[N] = {};
+		for (int a = 0; a < N; ++a) {
+			for (int b = 0; b < N; ++b) { next[a] += cov[a][b] * axis[b]; }
+		}
+		float length = 0.0f;
+		for (int c = 0; c < N; ++c) { length += next[c] * next[c]; }
+		length = std::sqrt(length);
+		if (length < 1e-6f) { break; }
+		for (int c = 0; c < N; ++c) { axis[c] = next[c] / length; }
+	}
+}
+
+// Fits a pair of endpoints along the principal axis of the texels.
+template <int N>
+void FitEndpoints(const ColorBlock& block, float e0[N], float e1[N]) {
+	float mean[N], axis[N];
+	PrincipalAxis<N>(block, mean, axis);
+
+	float tMin = 0.0f, tMax = 0.0f;
+	for (int i = 0; i < 16; ++i) {
+		float t = 0.0f;
+		for (int c = 0; c < N; ++c) { t += (block.Texels[i][c] - mean[c]) * axis[c]; }
+		tMin = std::min(tMin, t);
+		tMax = std::max(tMax, t);
+	}
+
+	for (int c = 0; c < N; ++c) {
+		e0[c] = std::clamp(mean[c] + axis[c] * tMin, 0.0f, 255.0f);
+		e1[c] = std::clamp(mean[c] + axis[c] * tMax, 0.0f, 255.0f);
+	}
+}
+
+class BitWriter {
+ public:
+	BitWriter(uint8_t* data, size_t size) : _data(data) {
+		memset(_data, 0, size);
+	}
+
+	void Write(uint32_t value, uint32_t bits) {
+		for (uint32_t b = 0; b < bits; ++b, ++_position) {
+			if ((value >> b) & 1) { _data[_position >> 3] |= 1 << (_position & 7); }
+		}
+	}
+
+ private:
+	uint8_t* _data;
+	uint32_t _position = 0;
+};
+
+uint16_t PackRgb565(const float color[3]) {
+	const uint32_t r = static_cast<uint32_t>(color[0] * 31.0f / 255.0f + 0.5f);
+	const uint32_t g = static_cast<uint32_t>(color[1] * 63.0f / 255.0f + 0.5f);
+	const uint32_t b = static_cast<uint32_t>(color[2] * 31.0f / 255.0f + 0.5f);
+
+	return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+void UnpackRgb565(uint16_t packed, int color[3]) {
+	const int r = (packed >> 11) & 31;
+	const int g = (packed >> 5) & 63;
+	const int b = packed & 31;
+	color[0]    = (r << 3) | (r >> 2);
+	color[1]    = (g << 2) | (g >> 4);
+	color[2]    = (b << 3) | (b >> 2);
+}
+
+void EncodeBC1Block(const ColorBlock& block, uint8_t* out) {
+	float e0[3], e1[3];
+	FitEndpoints<3>(block, e0, e1);
+
+	uint16_t c0 = PackRgb565(e1);
+	uint16_t c1 = PackRgb565(e0);
+	if (c0 < c1) { std::swap(c0, c1); }
+
+	uint32_t indices = 0;
+	if (c0 != c1) {
+		int palette[4][3];
+		UnpackRgb565(c0, palette[0]);
+		UnpackRgb565(c1, palette[1]);
+		for (int c = 0; c < 3; ++c) {
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+
+		for (int i = 0; i < 16; ++i) {
+			float bestError = 1e30f;
+			uint32_t best   = 0;
+			for (uint32_t p = 0; p < 4; ++p) {
+				float error = 0.0f;
+				for (int c = 0; c < 3; ++c) {
+					const float d = block.Texels[i][c] - palette[p][c];
+					error += d * d;
+				}
+				if (error < bestError) {
+					bestError = error;
+					best      = p;
+				}
+			}
+			indices |= best << (i * 2);
+		}
+	}
+
+	memcpy(out + 0, &c0, 2);
+	memcpy(out + 2, &c1, 2);
+	memcpy(out + 4, &indices, 4);
+}
+
+void EncodeBC4Block(const ColorBlock& block, int channel, uint8_t* out) {
+	float minValue = 255.0f, maxValue = 0.0f;
+	for (int i = 0; i < 16; ++i) {
+		minValue = std::min(minValue, block.Texels[i][channel]);
+		maxValue = std::max(maxValue, block.Texels[i][channel]);
+	}
+
+	const int a0 = static_cast<int>(maxValue + 0.5f);
+	const int a1 = static_cast<int>(minValue + 0.5f);
+	uint64_t indices = 0;
+	if (a0 > a1) {
+		int palette[8] = {a0, a1};
+		for (int p = 2; p < 8; ++p) { palette[p] = ((8 - p) * a0 + (p - 1) * a1) / 7; }
+
+		for (int i = 0; i < 16; ++i) {
+			float bestError = 1e30f;
+			uint64_t best   = 0;
+			for (uint64_t p = 0; p < 8; ++p) {
+				const float error = std::abs(block.Texels[i][channel] - palette[p]);
+				if (error < bestError) {
+					bestError = error;
+					best      = p;
+				}
+			}
+			indices |= best << (i * 3);
+		}
+	}
+
+	out[0] = static_cast<uint8_t>(a0);
+	out[1] = static_cast<uint8_t>(a1);
+	for (int b = 0; b < 6; ++b) { out[2 + b] = static_cast<uint8_t>(indices >> (b * 8)); }
+}
+
+// BC7 mode 6: a single subset with 7.7.7.7 RGBA endpoints, a unique p-bit per endpoint and 4-bit indices.
+constexpr int BC7Weights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+struct BC7Endpoint {
+	int Quantized[4];
+	int PBit;
+	int Value[4];
+};
+
+BC7Endpoint QuantizeBC7Endpoint(const float endpoint[4]) {
+	BC7Endpoint best{};
+	float bestError = 1e30f;
+	for (int p = 0; p < 2; ++p) {
+		BC7Endpoint candidate{.PBit = p};
+		float error = 0.0f;
+		for (int c = 0; c < 4; ++c) {
+			candidate.Quantized[c] = std::clamp(static_cast<int>((endpoint[c] - p) / 2.0f + 0.5f), 0, 127);
+			candidate.Value[c]     = (candidate.Quantized[c] << 1) | p;
+			const float d          = candidate.Value[c] - endpoint[c];
+			error += d * d;
+		}
+		if (error < bestError) {
+			bestError = error;
+			best      = candidate;
+		}
+	}
+
+	return best;
+}
+
+float SelectBC7Indices(const ColorBlock& block, const BC7Endpoint& e0, const BC7Endpoint& e1, int indices[16]) {
+	int palette[16][4];
+	for (int w = 0; w < 16; ++w) {
+		for (int c = 0; c < 4; ++c) {
+			palette[w][c] = ((64 - BC7Weights[w]) * e0.Value[c] + BC7Weights[w] * e1.Value[c] + 32) >> 6;
+		}
+	}
+
+	float totalError = 0.0f;
+	for (int i = 0; i < 16; ++i) {
+		float bestError = 1e30f;
+		for (int w = 0; w < 16; ++w) {
+			float error = 0.0f;
+			for (int c = 0; c < 4; ++c) {
+				const float d = block.Texels[i][c] - palette[w][c];
+				error += d * d;
+			}
+			if (error < bestError) {
+				bestError  = error;
+				indices[i] = w;
+			}
+		}
+		totalError += bestError;
+	}
+
+	return totalError;
+}
+
+void EncodeBC7Block(const ColorBlock& block, uint8_t* out) {
+	float e0[4], e1[4];
+	FitEndpoints<4>(block, e0, e1);
+
+	BC7Endpoint q0 = QuantizeBC7Endpoint(e0);
+	BC7Endpoint q1 = QuantizeBC7Endpoint(e1);
+	int indices[16];
+	float error = SelectBC7Indices(block, q0, q1, indices);
+
+	// Refine the endpoints once with a least-squares fit against the chosen weights.
+	{
+		float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+		float ax[4] = {}, bx[4] = {};
+		for (int i = 0; i < 16; ++i) {
+			const float b = BC7Weights[indices[i]] / 64.0f;
+			const float a = 1.0f - b;
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			for (int c = 0; c < 4; ++c) {
+				ax[c] += a * block.Texels[i][c];
+				bx[c] += b * block.Texels[i][c];
+			}
+		}
+
+		const float det = aa * bb - ab * ab;
+		if (std::abs(det) > 1e-6f) {
+			float r0[4], r1[4];
+			for (int c = 0; c < 4; ++c) {
+				r0[c] = std::clamp((ax[c] * bb - bx[c] * ab) / det, 0.0f, 255.0f);
+				r1[c] = std::clamp((bx[c] * aa - ax[c] * ab) / det, 0.0f, 255.0f);
+			}
+
+			const BC7Endpoint refined0 = QuantizeBC7Endpoint(r0);
+			const BC7Endpoint refined1 = QuantizeBC7Endpoint(r1);
+			int refinedIndices[16];
+			const float refinedError = SelectBC7Indices(block, refined0, refined1, refinedIndices);
+			if (refinedError < error) {
+				q0 = refined0;
+				q1 = refined1;
+				std::copy(refinedIndices, refinedIndices + 16, indices);
+			}
+		}
+	}
+
+	// The anchor index only stores 3 bits, so its high bit must be zero.
+	if (indices[0] & 8) {
+		std::swap(q0, q1);
+		for (int i = 0; i < 16; ++i) { indices[i] = 15 - indices[i]; }
+	}
+
+	BitWriter writer(out, 16);
+	writer.Write(1 << 6, 7);
+	for (int c = 0; c < 4; ++c) {
+		writer.Write(q0.Quantized[c], 7);
+		writer.Write(q1.Quantized[c], 7);
+	}
+	writer.Write(q0.PBit, 1);
+	writer.Write(q1.PBit, 1);
+	writer.Write(indices[0], 3);
+	for (int i = 1; i < 16; ++i) { writer.Write(indices[i], 4); }
+}
+}  // namespace
+
+std::vector<MipLevel> GenerateMipChain(const uint8_t* rgba, uint32_t width, uint32_t height, bool srgb) {
+	const auto& tables = GetSrgbTables();
+
+	std::vector<MipLevel> mips;
+	mips.push_back(MipLevel{.Width = width, .Height = height, .Data = std::vector<uint8_t>(rgba, rgba + width * height * 4)});
+
+	while (width > 1 || height > 1) {
+		const auto& src       = mips.back();
+		const uint32_t mipW   = std::max(1u, width / 2);
+		const uint32_t mipH   = std::max(1u, height / 2);
+		std::vector<uint8_t> dst(mipW * mipH * 4);
+
+		for (uint32_t y = 0; y < mipH; ++y) {
+			for (uint32_t x = 0; x < mipW; ++x) {
+				const uint32_t x0 = std::min(x * 2, width - 1);
+				const uint32_t x1 = std::min(x * 2 + 1, width - 1);
+				const uint32_t y0 = std::min(y * 2, height - 1);
+				const uint32_t y1 = std::min(y * 2 + 1, height - 1);
+				const uint8_t* texels[4] = {&src.Data[(y0 * width + x0) * 4],
+				                            &src.Data[(y0 * width + x1) * 4],
+				                            &src.Data[(y1 * width + x0) * 4],
+				                            &src.Data[(y1 * width + x1) * 4]};
+
+				uint8_t* out = &dst[(y * mipW + x) * 4];
+				for (int c = 0; c < 4; ++c) {
+					if (srgb && c < 3) {
+						float sum = 0.0f;
+						for (int t = 0; t < 4; ++t) { sum += tables.ToLinear[texels[t][c]]; }
+						out[c] = tables.ToSrgb[static_cast<int>(sum * 0.25f * 4095.0f + 0.5f)];
+					} else {
+						const int sum = texels[0][c] + texels[1][c] + texels[2][c] + texels[3][c];
+						out[c]        = static_cast<uint8_t>((sum + 2) / 4);
+					}
+				}
+			}
+		}
+
+		width  = mipW;
+		height = mipH;
+		mips.push_back(MipLevel{.Width = width, .Height = height, .Data = std::move(dst)});
+	}
+
+	return mips;
+}
+
+size_t GetCompressedSize(uint32_t width, uint32_t height, BlockFormat format) {
+	const size_t blocks = static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4);
+
+	return blocks * (format == BlockFormat::BC1 ? 8 : 16);
+}
+
+std::vector<uint8_t> Compress(const uint8_t* rgba, uint32_t width, uint32_t height, BlockFormat format) {
+	const uint32_t blocksX = (width + 3) / 4;
+	const uint32_t blocksY = (height + 3) / 4;
+	const size_t blockSize = format == BlockFormat::BC1 ? 8 : 16;
+
+	std::vector<uint8_t> compressed(GetCompressedSize(width, height, format));
+	ColorBlock block;
+	for (uint32_t by = 0; by < blocksY; ++by) {
+		for (uint32_t bx = 0; bx < blocksX; ++bx) {
+			// Gather the 4x4 block, replicating edge texels for images that are not a multiple of 4 in size.
+			for (uint32_t i = 0; i < 16; ++i) {
+				const uint32_t x     = std::min(bx * 4 + (i % 4), width - 1);
+				const uint32_t y     = std::min(by * 4 + (i / 4), height - 1);
+				const uint8_t* texel = &rgba[(y * width + x) * 4];
+				for (int c = 0; c < 4; ++c) { block.Texels[i][c] = texel[c]; }
+			}
+
+			uint8_t* out = &compressed[(by * blocksX + bx) * blockSize];
+			switch (format) {
+				case BlockFormat::BC1:
+					EncodeBC1Block(block, out);
+					break;
+				case BlockFormat::BC5:
+					EncodeBC4Block(block, 0, out);
+					EncodeBC4Block(block, 1, out + 8);
+					break;
+				case BlockFormat::BC7:
+					EncodeBC7Block(block, out);
+					break;
+			}
+		}
+	}
+
+	return compressed;
+}
+}  // namespace TextureCompressor
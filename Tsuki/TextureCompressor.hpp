@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// CPU encoders for the BCn block-compressed formats, used to build the on-disk texture cache.
+namespace TextureCompressor {
+enum class BlockFormat {
+	BC1,  // RGB, 4 bits per texel.
+	BC5,  // Two independent channels (RG), 8 bits per texel. Used for tangent-space normal maps.
+	BC7   // RGBA, 8 bits per texel.
+};
+
+struct MipLevel {
+	uint32_t Width  = 0;
+	uint32_t Height = 0;
+	std::vector<uint8_t> Data;
+};
+
+// Builds a full RGBA8 mip chain down to 1x1 using a box filter. sRGB data is filtered in linear space.
+std::vector<MipLevel> GenerateMipChain(const uint8_t* rgba, uint32_t width, uint32_t height, bool srgb);
+
+size_t GetCompressedSize(uint32_t width, uint32_t height, BlockFormat format);
+std::vector<uint8_t> Compress(const uint8_t* rgba, uint32_t width, uint32_t height, BlockFormat format);
+}  // namespace TextureCompressor
@@ -0,0 +1,83 @@
+#include "TextureTranscoder.hpp"
+
+#include <basisu_transcoder.h>
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+
+namespace TextureTranscoder {
+namespace {
+constexpr uint8_t Ktx2Identifier[12] = {0xab, 0x4b, 0x54, 0x58, 0x20, 0x32, 0x30, 0xbb, 0x0d, 0x0a, 0x1a, 0x0a};
+
+// Sets up the transcoder's global tables, which has to happen once before any texture is transcoded.
+void InitTranscoder() {
+	static std::once_flag initialized;
+	std::call_once(initialized, []() { basist::basisu_transcoder_init(); });
+}
+
+bool OpenTexture(basist::ktx2_transcoder& transcoder, const uint8_t* data, size_t size) {
+	if (size < sizeof(Ktx2Identifier) || memcmp(data, Ktx2Identifier, sizeof(Ktx2Identifier)) != 0) { return false; }
+
+	InitTranscoder();
+	if (!transcoder.init(data, static_cast<uint32_t>(size))) { return false; }
+
+	// Array textures and cubemaps are not used by materials.
+	return transcoder.get_layers() <= 1 && transcoder.get_faces() == 1 && transcoder.get_width() > 0 &&
+	       transcoder.get_height() > 0;
+}
+
+// ETC1S normal maps keep Y in their alpha slice, which the BC5 transcoder reads as the second channel.
+basist::transcoder_texture_format GetTargetFormat(std::optional<TextureCompressor::BlockFormat> format) {
+	if (!format) { return basist::transcoder_texture_format::cTFRGBA32; }
+	switch (*format) {
+		case TextureCompressor::BlockFormat::BC1:
+			return basist::transcoder_texture_format::cTFBC1_RGB;
+		case TextureCompressor::BlockFormat::BC5:
+			return basist::transcoder_texture_format::cTFBC5_RG;
+		case TextureCompressor::BlockFormat::BC7:
+		default:
+			return basist::transcoder_texture_format::cTFBC7_RGBA;
+	}
+}
+}  // namespace
+
+std::optional<Info> GetInfo(const uint8_t* data, size_t size) {
+	basist::ktx2_transcoder transcoder;
+	if (!OpenTexture(transcoder, data, size)) { return std::nullopt; }
+
+	return Info{
+		.Width = transcoder.get_width(), .Height = transcoder.get_height(), .LevelCount = transcoder.get_levels()};
+}
+
+std::vector<TextureCompressor::MipLevel> Transcode(const uint8_t* data,
+                                                   size_t size,
+                                                   std::optional<TextureCompressor::BlockFormat> format,
+                                                   bool normalMap,
+                                                   uint32_t levelCount) {
+	basist::ktx2_transcoder transcoder;
+	if (!OpenTexture(transcoder, data, size) || !transcoder.start_transcoding()) { return {}; }
+
+	const auto targetFormat     = GetTargetFormat(format);
+	const uint32_t bytesPerUnit = basist::basis_get_bytes_per_block_or_pixel(targetFormat);
+
+	std::vector<TextureCompressor::MipLevel> mips(std::min(levelCount, transcoder.get_levels()));
+	for (uint32_t level = 0; level < mips.size(); ++level) {
+		auto& mip  = mips[level];
+		mip.Width  = std::max(transcoder.get_width() >> level, 1u);
+		mip.Height = std::max(transcoder.get_height() >> level, 1u);
+
+		// Block formats are sized in 4x4 blocks, and RGBA in pixels.
+		const uint32_t units = format ? ((mip.Width + 3) / 4) * ((mip.Height + 3) / 4) : mip.Width * mip.Height;
+		mip.Data.resize(size_t(units) * bytesPerUnit);
+		if (!transcoder.transcode_image_level(level, 0, 0, mip.Data.data(), units, targetFormat)) { return {}; }
+
+		// RGBA keeps the alpha slice where it is, so Y is moved into green for the shader and the BC5 encoder.
+		if (!format && normalMap && transcoder.is_etc1s()) {
+			for (size_t pixel = 0; pixel < mip.Data.size(); pixel += 4) { mip.Data[pixel + 1] = mip.Data[pixel + 3]; }
+		}
+	}
+
+	return mips;
+}
+}  // namespace TextureTranscoder
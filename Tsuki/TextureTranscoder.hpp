@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "TextureCompressor.hpp"
+
+// Transcodes KTX2 textures supercompressed with Basis Universal (ETC1S or UASTC) straight into a block format, so they
+// are never decoded to RGBA or compressed on the CPU.
+namespace TextureTranscoder {
+struct Info {
+	uint32_t Width      = 0;
+	uint32_t Height     = 0;
+	uint32_t LevelCount = 0;
+};
+
+// Returns the size of a KTX2 texture, or nothing if data is not a 2D Basis Universal KTX2 texture.
+std::optional<Info> GetInfo(const uint8_t* data, size_t size);
+
+// Transcodes up to levelCount mip levels into format, or into RGBA8 if no format is given. Returns no levels if the
+// texture cannot be transcoded. Normal maps come out with X and Y in the first two channels, as BC5 holds them.
+std::vector<TextureCompressor::MipLevel> Transcode(const uint8_t* data,
+                                                   size_t size,
+                                                   std::optional<TextureCompressor::BlockFormat> format,
+                                                   bool normalMap,
+                                                   uint32_t levelCount = UINT32_MAX);
+}  // namespace TextureTranscoder
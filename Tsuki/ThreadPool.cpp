@@ -0,0 +1,44 @@
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(uint32_t threadCount) {
+	if (threadCount == 0) { threadCount = std::max(1u, std::thread::hardware_concurrency()); }
+
+	_threads.reserve(threadCount);
+	for (uint32_t i = 0; i < threadCount; ++i) { _threads.emplace_back(&ThreadPool::WorkerLoop, this); }
+}
+
+ThreadPool::~ThreadPool() noexcept {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopping = true;
+	}
+	_jobAvailable.notify_all();
+
+	for (auto& thread : _threads) { thread.join(); }
+}
+
+void ThreadPool::Enqueue(std::function<void()>&& job) {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_jobs.push(std::move(job));
+	}
+	_jobAvailable.notify_one();
+}
+
+void ThreadPool::WorkerLoop() {
+	while (true) {
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_jobAvailable.wait(lock, [this]() { return _stopping || !_jobs.empty(); });
+			if (_stopping && _jobs.empty()) { return; }
+
+			job = std::move(_jobs.front());
+			_jobs.pop();
+		}
+
+		job();
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+class ThreadPool {
+ public:
+	// A thread count of 0 will create one worker per hardware thread.
+	ThreadPool(uint32_t threadCount = 0);
+	ThreadPool(const ThreadPool&)            = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+	~ThreadPool() noexcept;
+
+	uint32_t GetThreadCount() const {
+		return static_cast<uint32_t>(_threads.size());
+	}
+
+	template <typename Fn>
+	auto Submit(Fn&& fn) -> std::future<std::invoke_result_t<Fn>> {
+		using Result = std::invoke_result_t<Fn>;
+
+		auto task   = std::make_shared<std::packaged_task<Result()>>(std::forward<Fn>(fn));
+		auto future = task->get_future();
+		Enqueue([task]() { (*task)(); });
+
+		return future;
+	}
+
+ private:
+	void Enqueue(std::function<void()>&& job);
+	void WorkerLoop();
+
+	std::vector<std::thread> _threads;
+	std::queue<std::function<void()>> _jobs;
+	std::mutex _mutex;
+	std::condition_variable _jobAvailable;
+	bool _stopping = false;
+};
@@ -14,21 +14,30 @@
 #include <Vulkan/WSI.hpp>
 #include <glm/gtx/euler_angles.hpp>
 
+#include "AssetRegistry.hpp"
 #include "DirectionalLightComponent.hpp"
+#include "GeometryPool.hpp"
 #include "GltfLoader.hpp"
 #include "HdriLoader.hpp"
 #include "Primitives.hpp"
 #include "SceneHierarchyPanel.hpp"
 #include "SceneRenderer.hpp"
 #include "SkyboxComponent.hpp"
+#include "ThreadPool.hpp"
 #include "UI.hpp"
+#include "UploadManager.hpp"
 
 void Tsuki::Start() {
+	_threadPool    = std::make_unique<ThreadPool>();
+	_uploadManager = std::make_unique<UploadManager>(*_wsi);
+	_assetRegistry = std::make_unique<AssetRegistry>();
+	_geometryPool  = std::make_unique<GeometryPool>(*_wsi, *_uploadManager);
 	_imguiRenderer = std::make_unique<Luna::ImGuiRenderer>(*_wsi);
 	_scene         = std::make_shared<Luna::Scene>();
-	_gltfLoader    = std::make_unique<GltfLoader>(*_wsi);
-	_hdriLoader    = std::make_unique<HdriLoader>(*_wsi);
-	_sceneRenderer = std::make_unique<SceneRenderer>(*_wsi);
+	_gltfLoader =
+		std::make_unique<GltfLoader>(*_wsi, *_threadPool, *_geometryPool, *_uploadManager, *_assetRegistry);
+	_hdriLoader    = std::make_unique<HdriLoader>(*_wsi, *_threadPool, *_uploadManager);
+	_sceneRenderer = std::make_unique<SceneRenderer>(*_wsi, *_uploadManager);
 	_scenePanel    = std::make_unique<SceneHierarchyPanel>(_scene);
 	StyleImGui();
 
@@ -90,8 +99,9 @@ void Tsuki::Start() {
 	}
 
 	{
-		auto model = _gltfLoader->Load("Assets/Models/Sponza/Sponza.gltf", *_scene);
-		model.Translate(glm::vec3(0.0f, -1.0f, 0.0f));
+		auto model = _gltfLoader->LoadAsync("Assets/Models/Sponza/Sponza.gltf", *_scene, {.CompactVertices = true});
+		model.Root.Translate(glm::vec3(0.0f, -1.0f, 0.0f));
+		_sceneLoad = model.Progress;
 	}
 
 	if (false) {
@@ -99,7 +109,7 @@ void Tsuki::Start() {
 		plane.Translate(glm::vec3(0, -2.0f, 0));
 		plane.Scale(10.0f);
 		auto& planeMesh = plane.AddComponent<Luna::MeshComponent>();
-		planeMesh.Mesh  = Primitives::Plane(_wsi->GetDevice());
+		planeMesh.Mesh  = Primitives::Plane(_wsi->GetDevice(), *_uploadManager);
 	}
 }
 
@@ -142,12 +152,23 @@ void Tsuki::Update(float dt) {
 		}
 	}
 
+	_gltfLoader->Update();
+	_uploadManager->NextFrame();
+	_geometryPool->NextFrame();
 	_wsi->BeginFrame();
 	auto cmd = device.RequestCommandBuffer();
 	_imguiRenderer->BeginFrame();
 
 	ImGui::ShowDemoWindow();
 
+	if (_sceneLoad && !_sceneLoad->Finished) {
+		if (ImGui::Begin("Loading")) {
+			ImGui::TextUnformatted(_sceneLoad->Name.c_str());
+			ImGui::ProgressBar(_sceneLoad->GetFraction());
+		}
+		ImGui::End();
+	}
+
 	_sceneRenderer->SetImageSize(_wsi->GetFramebufferSize());
 	_sceneRenderer->ShowSettings();
 	_sceneRenderer->Render(cmd, *_scene, _wsi->GetAcquiredIndex());
@@ -5,10 +5,15 @@
 #include <Scene/Scene.hpp>
 #include <memory>
 
+class AssetRegistry;
+class GeometryPool;
 class GltfLoader;
+struct GltfLoadProgress;
 class HdriLoader;
 class SceneHierarchyPanel;
 class SceneRenderer;
+class ThreadPool;
+class UploadManager;
 
 namespace Luna {
 class ImGuiRenderer;
@@ -23,12 +28,17 @@ class Tsuki : public Luna::Application {
  private:
 	void StyleImGui();
 
+	std::unique_ptr<ThreadPool> _threadPool;
+	std::unique_ptr<UploadManager> _uploadManager;
+	std::unique_ptr<AssetRegistry> _assetRegistry;
+	std::unique_ptr<GeometryPool> _geometryPool;
 	std::unique_ptr<Luna::ImGuiRenderer> _imguiRenderer;
 	std::shared_ptr<Luna::Scene> _scene;
 	std::unique_ptr<GltfLoader> _gltfLoader;
 	std::unique_ptr<HdriLoader> _hdriLoader;
 	std::unique_ptr<SceneRenderer> _sceneRenderer;
 	std::unique_ptr<SceneHierarchyPanel> _scenePanel;
+	std::shared_ptr<const GltfLoadProgress> _sceneLoad;
 
 	bool _mouseControl = false;
 };
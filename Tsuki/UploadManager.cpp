@@ -0,0 +1,311 @@
+#include "UploadManager.hpp"
+
+#include <Vulkan/Buffer.hpp>
+#include <Vulkan/CommandBuffer.hpp>
+#include <Vulkan/Device.hpp>
+#include <Vulkan/Fence.hpp>
+#include <Vulkan/Image.hpp>
+#include <Vulkan/Semaphore.hpp>
+#include <Vulkan/WSI.hpp>
+#include <algorithm>
+#include <cstring>
+
+using namespace Luna;
+
+// Staged data is aligned for buffer to image copies of every format used, the largest texel block being 16 bytes.
+static constexpr vk::DeviceSize StagingAlignment = 16;
+
+static uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+UploadManager::UploadManager(Vulkan::WSI& wsi, vk::DeviceSize ringSize) : _wsi(&wsi) {
+	_ringSize    = AlignUp(ringSize, StagingAlignment);
+	_ring        = _wsi->GetDevice().CreateBuffer(
+		Vulkan::BufferCreateInfo(Vulkan::BufferDomain::Host, _ringSize, vk::BufferUsageFlagBits::eTransferSrc));
+	_ringData    = reinterpret_cast<uint8_t*>(_ring->Map());
+	_windowStart = std::chrono::steady_clock::now();
+}
+
+UploadManager::~UploadManager() noexcept {
+	// Staging memory and fences may only be released once the GPU has finished every batch that uses them.
+	Submit();
+	for (auto& batch : _inFlight) {
+		if (batch.TransferFence) { batch.TransferFence->Wait(); }
+		if (batch.GraphicsFence) { batch.GraphicsFence->Wait(); }
+	}
+	_inFlight.clear();
+}
+
+void UploadManager::UploadBuffer(const Vulkan::Buffer& buffer,
+                                 vk::DeviceSize offset,
+                                 const void* data,
+                                 vk::DeviceSize size) {
+	if (size == 0) { return; }
+
+	const auto staged = StageOrWait({MipData{.Data = data, .Size = size}});
+	if (!_transferCmd) {
+		_transferCmd = _wsi->GetDevice().RequestCommandBuffer(Vulkan::CommandBufferType::AsyncTransfer);
+	}
+	_transferCmd->CopyBuffer(buffer, offset, *staged.Buffer, staged.Offsets[0], size);
+	_batch.Bytes += size;
+}
+
+void UploadManager::CopyBuffer(const Vulkan::Buffer& dst,
+                               vk::DeviceSize dstOffset,
+                               const Vulkan::Buffer& src,
+                               vk::DeviceSize srcOffset,
+                               vk::DeviceSize size) {
+	if (size == 0) { return; }
+
+	if (!_transferCmd) {
+		_transferCmd = _wsi->GetDevice().RequestCommandBuffer(Vulkan::CommandBufferType::AsyncTransfer);
+	}
+
+	// Earlier uploads may have written to either buffer, and later ones may write over what this copies.
+	const vk::MemoryBarrier barrier(vk::AccessFlagBits::eTransferWrite,
+	                                vk::AccessFlagBits::eTransferRead | vk::AccessFlagBits::eTransferWrite);
+	_transferCmd->Barrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer, {barrier}, {}, {});
+	_transferCmd->CopyBuffer(dst, dstOffset, src, srcOffset, size);
+	_transferCmd->Barrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer, {barrier}, {}, {});
+}
+
+Vulkan::ImageHandle UploadManager::CreateImage(const Vulkan::ImageCreateInfo& createInfo,
+                                               const std::vector<MipData>& mips) {
+	return RecordImage(createInfo, mips, StageOrWait(mips));
+}
+
+void UploadManager::UploadImage(const Vulkan::Image& image,
+                                const vk::BufferImageCopy& region,
+                                const void* data,
+                                vk::DeviceSize size) {
+	if (size == 0) { return; }
+
+	const auto staged = StageOrWait({MipData{.Data = data, .Size = size}});
+
+	if (!_graphicsCmd) { _graphicsCmd = _wsi->GetDevice().RequestCommandBuffer(); }
+	auto copy         = region;
+	copy.bufferOffset = staged.Offsets[0];
+	_graphicsCmd->CopyBufferToImage(image, *staged.Buffer, {copy});
+	_batch.Bytes += size;
+}
+
+void UploadManager::CreateImageAsync(const Vulkan::ImageCreateInfo& createInfo,
+                                     std::vector<MipData> mips,
+                                     std::shared_ptr<const void> owner,
+                                     ImageCallback onReady) {
+	QueuedImage queued{
+		.CreateInfo = createInfo, .Mips = std::move(mips), .Owner = std::move(owner), .OnReady = std::move(onReady)};
+	for (const auto& mip : queued.Mips) { queued.Size += mip.Size; }
+	_queuedSize += queued.Size;
+	_queuedImages.push_back(std::move(queued));
+}
+
+void UploadManager::QueueCallback(std::function<void()>&& callback) {
+	_queuedImages.push_back(QueuedImage{.Callback = std::move(callback)});
+}
+
+void UploadManager::NextFrame() {
+	Retire();
+
+	// Queued images are staged in order until the budget runs out, but at least one is staged each frame so that images
+	// larger than the budget still make progress.
+	std::vector<std::function<void()>> ready;
+	vk::DeviceSize frameSize = 0;
+	while (!_queuedImages.empty()) {
+		auto& queued = _queuedImages.front();
+		if (queued.CreateInfo) {
+			if (frameSize > 0 && frameSize + queued.Size > _frameBudget) { break; }
+			const auto staged = Stage(queued.Mips);
+			if (!staged) { break; }
+
+			auto image = RecordImage(*queued.CreateInfo, queued.Mips, *staged);
+			frameSize += queued.Size;
+			_queuedSize -= queued.Size;
+			ready.push_back([image, onReady = std::move(queued.OnReady)]() { onReady(image); });
+		} else {
+			ready.push_back(std::move(queued.Callback));
+		}
+		_queuedImages.pop_front();
+	}
+
+	Submit();
+	for (auto& callback : ready) { callback(); }
+}
+
+void UploadManager::Flush() {
+	Submit();
+}
+
+std::optional<UploadManager::Staged> UploadManager::Stage(const std::vector<MipData>& pieces) {
+	Staged staged;
+	vk::DeviceSize size = 0;
+	for (const auto& piece : pieces) {
+		staged.Offsets.push_back(size);
+		size = AlignUp(size + piece.Size, StagingAlignment);
+	}
+
+	// Data that could never fit in the ring always gets a staging buffer of its own.
+	uint8_t* dst              = nullptr;
+	vk::DeviceSize baseOffset = 0;
+	const auto ringOffset     = size <= _ringSize ? AllocateRing(size) : std::nullopt;
+	if (ringOffset) {
+		staged.Buffer = _ring.Get();
+		dst           = _ringData + *ringOffset;
+		baseOffset    = *ringOffset;
+	} else if (size > _ringSize) {
+		auto buffer = _wsi->GetDevice().CreateBuffer(
+			Vulkan::BufferCreateInfo(Vulkan::BufferDomain::Host, size, vk::BufferUsageFlagBits::eTransferSrc));
+		staged.Buffer = buffer.Get();
+		dst           = reinterpret_cast<uint8_t*>(buffer->Map());
+		_batch.Staging.push_back(std::move(buffer));
+	} else {
+		return std::nullopt;
+	}
+
+	for (size_t i = 0; i < pieces.size(); ++i) {
+		if (pieces[i].Size > 0) { memcpy(dst + staged.Offsets[i], pieces[i].Data, pieces[i].Size); }
+		staged.Offsets[i] += baseOffset;
+	}
+
+	return staged;
+}
+
+UploadManager::Staged UploadManager::StageOrWait(const std::vector<MipData>& pieces) {
+	auto staged = Stage(pieces);
+	while (!staged) {
+		WaitForRing();
+		staged = Stage(pieces);
+	}
+
+	return std::move(*staged);
+}
+
+std::optional<uint64_t> UploadManager::AllocateRing(vk::DeviceSize size) {
+	// An empty ring starts over at its beginning, so that anything up to the size of the ring fits once it has drained.
+	if (_ringHead == _ringTail) {
+		_ringHead = (_ringHead + _ringSize - 1) / _ringSize * _ringSize;
+		_ringTail = _ringHead;
+	}
+
+	// The head and tail only ever grow, and are wrapped into the ring when used. Allocations that would straddle the end
+	// of the ring start over at its beginning instead.
+	uint64_t start = AlignUp(_ringHead, StagingAlignment);
+	if (start % _ringSize + size > _ringSize) { start += _ringSize - start % _ringSize; }
+	if (start + size - _ringTail > _ringSize) { return std::nullopt; }
+
+	_ringHead = start + size;
+
+	return start % _ringSize;
+}
+
+Vulkan::ImageHandle UploadManager::RecordImage(const Vulkan::ImageCreateInfo& createInfo,
+                                               const std::vector<MipData>& mips,
+                                               const Staged& staged) {
+	auto& device = _wsi->GetDevice();
+
+	// Layouts are transitioned here, rather than by the device when the image is created.
+	auto imageCI          = createInfo;
+	imageCI.InitialLayout = vk::ImageLayout::eUndefined;
+	imageCI.MipLevels     = static_cast<uint32_t>(mips.size());
+	imageCI.Usage |= vk::ImageUsageFlagBits::eTransferDst;
+	auto image = device.CreateImage(imageCI);
+
+	if (!_graphicsCmd) { _graphicsCmd = device.RequestCommandBuffer(); }
+
+	const vk::ImageSubresourceRange range(vk::ImageAspectFlagBits::eColor, 0, imageCI.MipLevels, 0, imageCI.ArrayLayers);
+	const vk::ImageMemoryBarrier toTransfer({},
+	                                        vk::AccessFlagBits::eTransferWrite,
+	                                        vk::ImageLayout::eUndefined,
+	                                        vk::ImageLayout::eTransferDstOptimal,
+	                                        VK_QUEUE_FAMILY_IGNORED,
+	                                        VK_QUEUE_FAMILY_IGNORED,
+	                                        image->GetImage(),
+	                                        range);
+	_graphicsCmd->Barrier(
+		vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, {}, {}, {toTransfer});
+
+	std::vector<vk::BufferImageCopy> copies(mips.size());
+	for (uint32_t mip = 0; mip < mips.size(); ++mip) {
+		copies[mip] = vk::BufferImageCopy(
+			staged.Offsets[mip],
+			0,
+			0,
+			vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, mip, 0, imageCI.ArrayLayers),
+			vk::Offset3D(0, 0, 0),
+			vk::Extent3D(std::max(imageCI.Width >> mip, 1u), std::max(imageCI.Height >> mip, 1u), 1));
+		_batch.Bytes += mips[mip].Size;
+	}
+	_graphicsCmd->CopyBufferToImage(*image, *staged.Buffer, copies);
+
+	const vk::ImageMemoryBarrier toShader(vk::AccessFlagBits::eTransferWrite,
+	                                      vk::AccessFlagBits::eShaderRead,
+	                                      vk::ImageLayout::eTransferDstOptimal,
+	                                      vk::ImageLayout::eShaderReadOnlyOptimal,
+	                                      VK_QUEUE_FAMILY_IGNORED,
+	                                      VK_QUEUE_FAMILY_IGNORED,
+	                                      image->GetImage(),
+	                                      range);
+	_graphicsCmd->Barrier(vk::PipelineStageFlagBits::eTransfer,
+	                      vk::PipelineStageFlagBits::eFragmentShader | vk::PipelineStageFlagBits::eComputeShader,
+	                      {},
+	                      {},
+	                      {toShader});
+
+	return image;
+}
+
+void UploadManager::Retire() {
+	// Batches finish in the order they were submitted, so the ring is released from its tail.
+	while (!_inFlight.empty()) {
+		auto& batch = _inFlight.front();
+		if (batch.TransferFence && !batch.TransferFence->TryWait(0)) { break; }
+		if (batch.GraphicsFence && !batch.GraphicsFence->TryWait(0)) { break; }
+
+		_ringTail = batch.RingEnd;
+		_windowBytes += batch.Bytes;
+		_inFlight.pop_front();
+	}
+
+	const auto now                             = std::chrono::steady_clock::now();
+	const std::chrono::duration<double> window = now - _windowStart;
+	if (window.count() >= 0.5) {
+		_throughput  = _windowBytes / window.count();
+		_windowBytes = 0;
+		_windowStart = now;
+	}
+}
+
+void UploadManager::WaitForRing() {
+	Submit();
+	if (_inFlight.empty()) { return; }
+
+	auto& oldest = _inFlight.front();
+	if (oldest.TransferFence) { oldest.TransferFence->Wait(); }
+	if (oldest.GraphicsFence) { oldest.GraphicsFence->Wait(); }
+	Retire();
+}
+
+void UploadManager::Submit() {
+	if (!_transferCmd && !_graphicsCmd) { return; }
+
+	auto& device   = _wsi->GetDevice();
+	_batch.RingEnd = _ringHead;
+	if (_transferCmd) {
+		// Uploaded buffers are read as vertex and index buffers, and by the culling shader.
+		std::vector<Vulkan::SemaphoreHandle> semaphores(1);
+		device.Submit(_transferCmd, &_batch.TransferFence, &semaphores);
+		device.AddWaitSemaphore(Vulkan::CommandBufferType::Generic,
+		                        semaphores[0],
+		                        vk::PipelineStageFlagBits::eVertexInput | vk::PipelineStageFlagBits::eComputeShader,
+		                        true);
+		_transferCmd.Reset();
+	}
+	if (_graphicsCmd) {
+		device.Submit(_graphicsCmd, &_batch.GraphicsFence);
+		_graphicsCmd.Reset();
+	}
+
+	_inFlight.push_back(std::move(_batch));
+	_batch = {};
+}
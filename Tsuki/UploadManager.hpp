@@ -0,0 +1,147 @@
+#pragma once
+
+#include <Vulkan/Common.hpp>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <vector>
+
+// Moves data from the CPU into device buffers and images through one persistent, host-visible staging ring, instead of
+// a staging buffer and submission per resource. Copies are recorded into a batch that is submitted once per frame, and
+// each batch's staging space is reused once the fences of that batch have signalled.
+//
+// Buffer copies run on the dedicated transfer queue when the device has one. Luna shares buffers between queue
+// families, so the graphics queue only has to wait on a semaphore before using them. Images are not shared, so their
+// copies and layout transitions are recorded on the graphics queue instead, which avoids queue ownership transfers.
+//
+// Buffer uploads and CreateImage happen in the next batch, since their callers use the resource straight away. When the
+// ring is too full for them, they wait for earlier batches to finish, and only data larger than the whole ring gets a
+// staging buffer of its own. Images queued with CreateImageAsync are spread across frames, so that no frame uploads
+// more than the budget.
+class UploadManager {
+ public:
+	static constexpr vk::DeviceSize DefaultRingSize    = 64ull * 1024 * 1024;
+	static constexpr vk::DeviceSize DefaultFrameBudget = 16ull * 1024 * 1024;
+
+	struct MipData {
+		const void* Data    = nullptr;
+		vk::DeviceSize Size = 0;
+	};
+	using ImageCallback = std::function<void(Luna::Vulkan::ImageHandle image)>;
+
+	UploadManager(Luna::Vulkan::WSI& wsi, vk::DeviceSize ringSize = DefaultRingSize);
+	UploadManager(const UploadManager&)            = delete;
+	UploadManager& operator=(const UploadManager&) = delete;
+	~UploadManager() noexcept;
+
+	// Copies size bytes of data into buffer, which needs to allow transfers to it. The data is staged before returning.
+	void UploadBuffer(const Luna::Vulkan::Buffer& buffer, vk::DeviceSize offset, const void* data, vk::DeviceSize size);
+	// Copies between two device buffers, after every upload queued before it.
+	void CopyBuffer(const Luna::Vulkan::Buffer& dst,
+	                vk::DeviceSize dstOffset,
+	                const Luna::Vulkan::Buffer& src,
+	                vk::DeviceSize srcOffset,
+	                vk::DeviceSize size);
+
+	// Creates an image with one mip level per entry of mips, tightly packed, and stages it before returning. The image
+	// is left in ShaderReadOnlyOptimal layout, and may be used by graphics work submitted after the next batch.
+	Luna::Vulkan::ImageHandle CreateImage(const Luna::Vulkan::ImageCreateInfo& createInfo,
+	                                      const std::vector<MipData>& mips);
+	// Copies tightly packed texels into one region of an existing image, which must be in TransferDstOptimal layout when
+	// the batch runs. The data is staged before returning, so large images can be streamed through the ring in pieces
+	// without ever holding all of them.
+	void UploadImage(const Luna::Vulkan::Image& image,
+	                 const vk::BufferImageCopy& region,
+	                 const void* data,
+	                 vk::DeviceSize size);
+	// Queues an image to be created and uploaded within the frame budget. The mip data must stay alive until onReady
+	// is called, which owner can be used for. onReady is called from NextFrame, once the copy has been recorded.
+	void CreateImageAsync(const Luna::Vulkan::ImageCreateInfo& createInfo,
+	                      std::vector<MipData> mips,
+	                      std::shared_ptr<const void> owner,
+	                      ImageCallback onReady);
+	// Calls callback from NextFrame once every image queued before it is ready.
+	void QueueCallback(std::function<void()>&& callback);
+
+	// Retires finished batches, stages queued images up to the frame budget, and submits the batch. Call once per frame,
+	// before recording any graphics work that uses the uploads.
+	void NextFrame();
+	// Submits the current batch immediately, for graphics work submitted before the next frame.
+	void Flush();
+
+	vk::DeviceSize GetFrameBudget() const {
+		return _frameBudget;
+	}
+	void SetFrameBudget(vk::DeviceSize budget) {
+		_frameBudget = budget;
+	}
+
+	// Bytes per second copied by batches retired over the last half second.
+	double GetThroughput() const {
+		return _throughput;
+	}
+	size_t GetQueuedImageCount() const {
+		return _queuedImages.size();
+	}
+	vk::DeviceSize GetQueuedSize() const {
+		return _queuedSize;
+	}
+
+ private:
+	struct QueuedImage {
+		std::optional<Luna::Vulkan::ImageCreateInfo> CreateInfo;
+		std::vector<MipData> Mips;
+		vk::DeviceSize Size = 0;
+		std::shared_ptr<const void> Owner;
+		ImageCallback OnReady;
+		std::function<void()> Callback;
+	};
+
+	struct Batch {
+		Luna::Vulkan::FenceHandle TransferFence;
+		Luna::Vulkan::FenceHandle GraphicsFence;
+		uint64_t RingEnd     = 0;
+		vk::DeviceSize Bytes = 0;
+		// Uploads larger than the whole ring get staging buffers of their own, released with the batch.
+		std::vector<Luna::Vulkan::BufferHandle> Staging;
+	};
+
+	struct Staged {
+		const Luna::Vulkan::Buffer* Buffer = nullptr;
+		std::vector<vk::DeviceSize> Offsets;
+	};
+
+	// Copies each piece of data into the ring, or into a staging buffer of its own if the ring could never hold it.
+	// Returns nothing if the ring is too full for now.
+	std::optional<Staged> Stage(const std::vector<MipData>& pieces);
+	// Stages the data like Stage, waiting for earlier batches to free up the ring as often as it takes.
+	Staged StageOrWait(const std::vector<MipData>& pieces);
+	std::optional<uint64_t> AllocateRing(vk::DeviceSize size);
+	Luna::Vulkan::ImageHandle RecordImage(const Luna::Vulkan::ImageCreateInfo& createInfo,
+	                                      const std::vector<MipData>& mips,
+	                                      const Staged& staged);
+	void Retire();
+	// Submits the current batch and waits for the oldest one in flight, to free up its part of the ring.
+	void WaitForRing();
+	void Submit();
+
+	Luna::Vulkan::WSI* _wsi;
+	Luna::Vulkan::BufferHandle _ring;
+	uint8_t* _ringData          = nullptr;
+	vk::DeviceSize _ringSize    = 0;
+	uint64_t _ringHead          = 0;
+	uint64_t _ringTail          = 0;
+	vk::DeviceSize _frameBudget = DefaultFrameBudget;
+	vk::DeviceSize _queuedSize  = 0;
+	Luna::Vulkan::CommandBufferHandle _transferCmd;
+	Luna::Vulkan::CommandBufferHandle _graphicsCmd;
+	Batch _batch;
+	std::deque<Batch> _inFlight;
+	std::deque<QueuedImage> _queuedImages;
+	vk::DeviceSize _windowBytes = 0;
+	std::chrono::steady_clock::time_point _windowStart;
+	double _throughput = 0.0;
+};